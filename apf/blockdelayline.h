@@ -31,17 +31,107 @@
 #define APF_BLOCKDELAYLINE_H
 
 #include <algorithm>  // for std::max()
+#include <cmath>  // for std::floor()
 #include <vector>  // default container
 
+#ifdef __SSE__
+#include <xmmintrin.h>  // for _mm_prefetch()
+#endif
+
 #include "apf/iterator.h"  // for circular_iterator, stride_iterator
 
 namespace apf
 {
 
+namespace internal
+{
+  /// Storage granularity of a BlockDelayLine container (if available).
+  /// @see MirroredBuffer::granularity()
+  template<typename C>
+  auto container_granularity(int) -> decltype(C::granularity())
+  {
+    return C::granularity();
+  }
+
+  template<typename C>
+  typename C::size_type container_granularity(long) { return 1; }
+
+  /// @b true if the container is mirrored. @see MirroredBuffer::mirrored()
+  template<typename C>
+  auto container_is_mirrored(const C& c, int) -> decltype(c.mirrored())
+  {
+    return c.mirrored();
+  }
+
+  template<typename C>
+  bool container_is_mirrored(const C&, long) { return false; }
+}
+
+/** Linear interpolation between two neighbouring samples.
+ * Interpolation policy for BlockDelayLine::read_block_fractional() and
+ * BlockDelayLine::read_block_ramp().
+ * @tparam T floating point type
+ **/
+template<typename T>
+struct linear_interpolation
+{
+  /// Delay of the first tap relative to the integer part of the delay
+  static constexpr int first_tap = 0;
+  /// Number of taps
+  static constexpr int taps = 2;
+
+  /// Calculate coefficients. @param frac fractional part [0, 1) of the delay
+  /// @param[out] h array of @c taps coefficients
+  static void coefficients(T frac, T* h)
+  {
+    h[0] = T(1) - frac;
+    h[1] = frac;
+  }
+};
+
+/** 3rd order Lagrange interpolation.
+ * The two samples to the left and to the right of the desired position are
+ * used.
+ * Interpolation policy for BlockDelayLine::read_block_fractional() and
+ * BlockDelayLine::read_block_ramp().
+ * @tparam T floating point type
+ **/
+template<typename T>
+struct lagrange_interpolation
+{
+  /// Delay of the first tap relative to the integer part of the delay
+  static constexpr int first_tap = -1;
+  /// Number of taps
+  static constexpr int taps = 4;
+
+  /// Calculate coefficients. @param frac fractional part [0, 1) of the delay
+  /// @param[out] h array of @c taps coefficients
+  static void coefficients(T frac, T* h)
+  {
+    // delay relative to the first tap
+    const T d = frac + T(1);
+    const T d1 = d - T(1), d2 = d - T(2), d3 = d - T(3);
+    const T sixth = T(1) / T(6), half = T(1) / T(2);
+
+    h[0] = -d1 * d2 * d3 * sixth;
+    h[1] =  d  * d2 * d3 * half;
+    h[2] = -d  * d1 * d3 * half;
+    h[3] =  d  * d1 * d2 * sixth;
+  }
+};
+
 /** Block-based delay line.
  * This is a "write once, read many times" delay line.
  * The write operation is simple and fast.
  * The desired delay is specified at the more flexible read operation.
+ * @tparam Container Storage for the samples. If it provides the member
+ *   functions @c granularity() (static) and @c mirrored(), like
+ *   MirroredBuffer, the number of blocks is rounded up to a multiple of the
+ *   granularity and -- if the storage is actually mirrored -- all reads from
+ *   contiguous blocks are done without wrap-around handling.
+ *   If rounding would more than double the size of a larger delay line
+ *   (which happens with block sizes that have few factors of 2), the size is
+ *   not rounded and the storage is not mirrored.
  **/
 template<typename T, typename Container = std::vector<T>>
 class BlockDelayLine
@@ -89,6 +179,44 @@ class BlockDelayLine
     template<typename Iterator>
     bool read_block(Iterator destination, size_type delay, T weight) const;
 
+    /// Read several blocks ("taps") with individual delays and weights.
+    /// @see _read_blocks()
+    template<typename DelayIterator, typename WeightIterator
+      , typename DestinationIterator>
+    bool read_blocks(DelayIterator first, DelayIterator last
+        , WeightIterator weights, DestinationIterator destinations) const
+    {
+      return this->_read_blocks(first, last, weights, destinations, 0);
+    }
+
+    /// State of a first-order allpass (Thiran) interpolator.
+    /// Each reading tap needs its own state object, which must be kept from
+    /// one block to the next.
+    struct allpass_state
+    {
+      T input = T();  ///< last input sample
+      T output = T();  ///< last output sample (without weighting)
+    };
+
+    template<typename Interpolator>
+    bool fractional_delay_is_valid(T delay) const;
+
+    template<typename Interpolator, typename Iterator>
+    bool read_block_fractional(Iterator destination, T delay
+        , T weight = T(1)) const;
+
+    template<typename Interpolator, typename Iterator>
+    bool read_block_ramp(Iterator destination, T delay_begin, T delay_end
+        , T weight = T(1)) const;
+
+    template<typename Iterator>
+    bool read_block_allpass(Iterator destination, T delay
+        , allpass_state& state, T weight = T(1)) const;
+
+    template<typename Iterator>
+    bool read_block_allpass(Iterator destination, T delay_begin, T delay_end
+        , allpass_state& state, T weight = T(1)) const;
+
     pointer get_write_pointer() const;
 
     circulator get_read_circulator(size_type delay = 0) const;
@@ -97,15 +225,70 @@ class BlockDelayLine
     /// Get a circular iterator to the sample with time 0
     circulator _get_data_circulator() const { return _data_circulator; }
 
+    template<typename DelayIterator, typename WeightIterator
+      , typename DestinationIterator>
+    bool _read_blocks(DelayIterator first, DelayIterator last
+        , WeightIterator weights, DestinationIterator destinations
+        , difference_type offset) const;
+
     const size_type _block_size;  ///< Size of read/write blocks
 
   private:
+    static size_type _storage_blocks(size_type block_size
+        , size_type max_delay);
+
+    /// Like apf::transform(), but a single range if _data is mirrored.
+    template<typename Out, typename F>
+    Out _transform(circulator first, difference_type n, Out result, F f) const
+    {
+      if (_mirrored)
+      {
+        auto begin = first.base();
+        return std::transform(begin, begin + n, result, f);
+      }
+      return apf::transform(first, first + n, result, f);
+    }
+
+    /// Like apf::copy(), but a single range if _data is mirrored.
+    template<typename Out>
+    Out _copy(circulator first, difference_type n, Out result) const
+    {
+      if (_mirrored)
+      {
+        auto begin = first.base();
+        return std::copy(begin, begin + n, result);
+      }
+      return apf::copy(first, first + n, result);
+    }
+
+    /// Split delay into integer part and fractional part
+    static difference_type _split_delay(T delay, T& frac)
+    {
+      auto integer = std::floor(delay);
+      frac = delay - integer;
+      return static_cast<difference_type>(integer);
+    }
+
+    /// Index (into _data) of the sample with time 0 minus @p delay.
+    /// @p delay may be in the range from -size to (2 * size - 1).
+    size_type _index(difference_type delay) const
+    {
+      auto size = static_cast<difference_type>(_data.size());
+      auto index = (_get_data_circulator().base() - _data.begin()) - delay;
+      if (index < 0) index += size;
+      else if (index >= size) index -= size;
+      return static_cast<size_type>(index);
+    }
+
     const size_type _max_delay;  ///< Maximum delay
 
     const size_type _number_of_blocks; ///< No\. of blocks needed for storage
 
     Container _data;  ///< Internal storage for sample data
 
+    /// @b true if _data can be read beyond its end. @see MirroredBuffer
+    const bool _mirrored;
+
     /// Circular iterator which iterates over each sample
     circulator _data_circulator;
 
@@ -122,13 +305,9 @@ BlockDelayLine<T, Container>::BlockDelayLine(size_type block_size
     , size_type max_delay)
   : _block_size(block_size)
   , _max_delay(max_delay)
-  // Minimum number of blocks is 2, even if _max_delay is 0.
-  // With only one block the circular iterators r and (r + _block_size) would be
-  // equal and the read...() functions wouldn't work.
-  // But anyway, who wants a delay line with no delay? Kind of useless ...
-  , _number_of_blocks(
-      std::max(size_type(2), (_max_delay + 2 * _block_size - 1) / _block_size))
+  , _number_of_blocks(_storage_blocks(_block_size, _max_delay))
   , _data(_number_of_blocks * _block_size)  // initialized with default ctor T()
+  , _mirrored(internal::container_is_mirrored(_data, 0))
   , _data_circulator(_data.begin(), _data.end())
   , _block_circulator(
       _data_circulator, static_cast<difference_type>(_block_size))
@@ -136,6 +315,35 @@ BlockDelayLine<T, Container>::BlockDelayLine(size_type block_size
   assert(_block_size >= 1);
 }
 
+/// Number of blocks needed for storage.
+template<typename T, typename Container>
+typename BlockDelayLine<T, Container>::size_type
+BlockDelayLine<T, Container>::_storage_blocks(size_type block_size
+    , size_type max_delay)
+{
+  // Minimum number of blocks is 2, even if max_delay is 0.
+  // With only one block the circular iterators r and (r + block_size) would be
+  // equal and the read...() functions wouldn't work.
+  // But anyway, who wants a delay line with no delay? Kind of useless ...
+  auto blocks
+    = std::max(size_type(2), (max_delay + 2 * block_size - 1) / block_size);
+
+  // For mirroring, the total size must be a multiple of the container's
+  // granularity, i.e. the number of blocks must be a multiple of step.
+  const auto granularity = static_cast<size_type>(
+      internal::container_granularity<Container>(0));
+  auto a = granularity, b = block_size;
+  while (b != 0) { auto r = a % b; a = b; b = r; }  // greatest common divisor
+  const auto step = granularity / a;
+  const auto rounded = (blocks + step - 1) / step * step;
+
+  // Block sizes with few factors of 2 (e.g. 441) would need a lot more
+  // memory.  In that case the size is not rounded and the container falls
+  // back to non-mirrored storage.  Small delay lines are always rounded.
+  return (rounded <= 2 * blocks || rounded * block_size <= 4 * granularity)
+    ? rounded : blocks;
+}
+
 /** Write a block of data to the delay line.
  * Before writing, the read and write pointers are advanced to the next block.
  * If you don't want to use this function, you can also call advance(), get the
@@ -170,9 +378,8 @@ BlockDelayLine<T, Container>::read_block(Iterator destination, size_type delay)
   // TODO: try to get a more meaningful error message if source is not a random
   // access iterator (e.g. when using a std::list)
   if (!this->delay_is_valid(delay)) return false;
-  circulator source = this->get_read_circulator(delay);
-  std::copy(source, source + static_cast<difference_type>(_block_size)
-      , destination);
+  _copy(this->get_read_circulator(delay)
+      , static_cast<difference_type>(_block_size), destination);
   return true;
 }
 
@@ -184,9 +391,249 @@ BlockDelayLine<T, Container>::read_block(Iterator destination
     , size_type delay, T weight) const
 {
   if (!this->delay_is_valid(delay)) return false;
-  circulator source = this->get_read_circulator(delay);
-  std::transform(source, source + static_cast<difference_type>(_block_size)
-      , destination, [weight] (T in) { return in * weight; });
+  _transform(this->get_read_circulator(delay)
+      , static_cast<difference_type>(_block_size), destination
+      , [weight] (T in) { return in * weight; });
+  return true;
+}
+
+/** Read several blocks of data with individual delays and weights.
+ * This is much faster than calling read_block() for each tap.
+ * The source block of each tap is split into (at most) two contiguous ranges
+ * of the internal storage (see circular_iterator::spans()), or a single range
+ * if the storage is mirrored (see MirroredBuffer).
+ * While one tap is copied, the beginning of the next one is prefetched.
+ * @param first Iterator to the first delay (in samples)
+ * @param last Past-the-end iterator of the delays
+ * @param weights Iterator to the weights, one for each delay. If a weight is
+ *   exactly 1, the data is copied without multiplication.
+ * @param destinations Iterator to the destination iterators (e.g. an array of
+ *   pointers), one for each delay
+ * @param offset Added to each delay
+ * @return @b true if all delays were valid. Taps with invalid delays are
+ *   skipped, their destinations are not written.
+ **/
+template<typename T, typename Container>
+template<typename DelayIterator, typename WeightIterator
+  , typename DestinationIterator>
+bool
+BlockDelayLine<T, Container>::_read_blocks(DelayIterator first
+    , DelayIterator last, WeightIterator weights
+    , DestinationIterator destinations, difference_type offset) const
+{
+  bool all_valid = true;
+  const auto max_delay = static_cast<difference_type>(_max_delay);
+
+  auto get_delay = [offset] (DelayIterator it)
+  {
+    return static_cast<difference_type>(*it) + offset;
+  };
+
+  for (; first != last; ++first, ++weights, ++destinations)
+  {
+    auto delay = get_delay(first);
+    if (delay < 0 || delay > max_delay)
+    {
+      all_valid = false;
+      continue;
+    }
+
+    auto source = this->get_read_circulator(static_cast<size_type>(delay));
+
+#ifdef __SSE__
+    auto next = first;
+    if (++next != last)
+    {
+      auto next_delay = get_delay(next);
+      if (next_delay >= 0 && next_delay <= max_delay)
+      {
+        _mm_prefetch(reinterpret_cast<const char*>(&_data[_index(next_delay)])
+            , _MM_HINT_T0);
+      }
+    }
+#endif
+
+    auto weight = static_cast<T>(*weights);
+    auto length = static_cast<difference_type>(_block_size);
+    if (weight == T(1))
+    {
+      _copy(source, length, *destinations);
+    }
+    else
+    {
+      _transform(source, length, *destinations
+          , [weight] (T in) { return in * weight; });
+    }
+  }
+  return all_valid;
+}
+
+/** Check if a non-integer delay is valid for a given interpolation.
+ * All taps of the interpolator must lie between 0 and @c max_delay.
+ * @tparam Interpolator Interpolation policy, e.g. linear_interpolation
+ * @param delay Desired delay in samples
+ * @return @b true if @p delay is valid.
+ **/
+template<typename T, typename Container>
+template<typename Interpolator>
+bool
+BlockDelayLine<T, Container>::fractional_delay_is_valid(T delay) const
+{
+  T frac;
+  auto first = _split_delay(delay, frac) + Interpolator::first_tap;
+  auto last = first + Interpolator::taps - 1;
+  return first >= 0 && last <= static_cast<difference_type>(_max_delay);
+}
+
+/** Read a block of data with a non-integer delay.
+ * The delay is constant during the whole block.
+ * Each tap of the interpolator is read as a separate block, all blocks are
+ * accumulated in @p destination.
+ * @tparam Interpolator Interpolation policy, e.g. linear_interpolation or
+ *   lagrange_interpolation
+ * @param destination Iterator to destination, must be a forward iterator
+ * @param delay Delay in samples, see fractional_delay_is_valid()
+ * @param weight Each element is multiplied by this factor
+ * @return @b true on success
+ **/
+template<typename T, typename Container>
+template<typename Interpolator, typename Iterator>
+bool
+BlockDelayLine<T, Container>::read_block_fractional(Iterator destination
+    , T delay, T weight) const
+{
+  if (!this->template fractional_delay_is_valid<Interpolator>(delay))
+  {
+    return false;
+  }
+  T frac;
+  auto first = _split_delay(delay, frac) + Interpolator::first_tap;
+  T h[Interpolator::taps];
+  Interpolator::coefficients(frac, h);
+
+  auto length = static_cast<difference_type>(_block_size);
+  auto source = this->get_read_circulator(static_cast<size_type>(first));
+  auto coefficient = weight * h[0];
+  _transform(source, length, destination
+      , [coefficient] (T in) { return in * coefficient; });
+  for (int tap = 1; tap < Interpolator::taps; ++tap)
+  {
+    --source;
+    coefficient = weight * h[tap];
+    _transform(source, length, make_accumulating_iterator(destination)
+        , [coefficient] (T in) { return in * coefficient; });
+  }
+  return true;
+}
+
+/** Read a block of data with a time-varying non-integer delay.
+ * The delay changes linearly from @p delay_begin (at the first sample of the
+ * block) towards @p delay_end.
+ * @p delay_end itself is reached at the first sample of the following block,
+ * i.e. if the next block is read with a ramp starting at @p delay_end, the
+ * delay changes smoothly across block boundaries.
+ * @tparam Interpolator Interpolation policy, e.g. linear_interpolation or
+ *   lagrange_interpolation
+ * @param destination Iterator to destination
+ * @param delay_begin Delay in samples at the beginning of the block
+ * @param delay_end Delay in samples at the beginning of the next block
+ * @param weight Each element is multiplied by this factor
+ * @return @b true on success, i.e. if both @p delay_begin and @p delay_end are
+ *   valid. @see fractional_delay_is_valid()
+ **/
+template<typename T, typename Container>
+template<typename Interpolator, typename Iterator>
+bool
+BlockDelayLine<T, Container>::read_block_ramp(Iterator destination
+    , T delay_begin, T delay_end, T weight) const
+{
+  if (!this->template fractional_delay_is_valid<Interpolator>(delay_begin)
+      || !this->template fractional_delay_is_valid<Interpolator>(delay_end))
+  {
+    return false;
+  }
+
+  const T increment = (delay_end - delay_begin) / static_cast<T>(_block_size);
+  T h[Interpolator::taps];
+  T frac;
+
+  for (size_type i = 0; i < _block_size; ++i)
+  {
+    auto delay = delay_begin + static_cast<T>(i) * increment;
+    auto first = _split_delay(delay, frac) + Interpolator::first_tap;
+    Interpolator::coefficients(frac, h);
+    auto index = _index(first - static_cast<difference_type>(i));
+
+    T result = T();
+    for (int tap = 0; tap < Interpolator::taps; ++tap)
+    {
+      result += h[tap] * _data[index];
+      index = (index == 0) ? _data.size() - 1 : index - 1;
+    }
+    *destination = result * weight;
+    ++destination;
+  }
+  return true;
+}
+
+/** Read a block of data with a non-integer delay using an allpass filter.
+ * @see read_block_allpass(Iterator, T, T, allpass_state&, T) const
+ **/
+template<typename T, typename Container>
+template<typename Iterator>
+bool
+BlockDelayLine<T, Container>::read_block_allpass(Iterator destination
+    , T delay, allpass_state& state, T weight) const
+{
+  return this->read_block_allpass(destination, delay, delay, state, weight);
+}
+
+/** Read a block of data with a (time-varying) non-integer delay using a
+ * first-order allpass (Thiran) interpolator.
+ * In contrast to linear and Lagrange interpolation, the magnitude response is
+ * flat, but the interpolator has an internal state.
+ * The fractional part of the delay is kept between 0.5 and 1.5 for a
+ * well-behaved phase delay, therefore the minimum delay is 0.5 samples.
+ * The delay changes linearly from @p delay_begin to @p delay_end, as in
+ * read_block_ramp().
+ * @param destination Iterator to destination
+ * @param delay_begin Delay in samples at the beginning of the block
+ * @param delay_end Delay in samples at the beginning of the next block
+ * @param state Filter state, must be kept for the next block
+ * @param weight Each element is multiplied by this factor
+ * @return @b true on success
+ **/
+template<typename T, typename Container>
+template<typename Iterator>
+bool
+BlockDelayLine<T, Container>::read_block_allpass(Iterator destination
+    , T delay_begin, T delay_end, allpass_state& state, T weight) const
+{
+  // The integer part of (delay - 0.5) must be between 0 and max_delay
+  const T half = T(1) / T(2);
+  const auto limit = static_cast<T>(_max_delay) + T(1) + half;
+  if (delay_begin < half || delay_end < half
+      || delay_begin >= limit || delay_end >= limit)
+  {
+    return false;
+  }
+
+  const T increment = (delay_end - delay_begin) / static_cast<T>(_block_size);
+  T frac;
+
+  for (size_type i = 0; i < _block_size; ++i)
+  {
+    auto delay = delay_begin + static_cast<T>(i) * increment;
+    auto integer = _split_delay(delay - half, frac);
+    frac += half;  // now between 0.5 and 1.5
+    auto a = (T(1) - frac) / (T(1) + frac);
+    auto input = _data[_index(integer - static_cast<difference_type>(i))];
+    auto output = a * (input - state.output) + state.input;
+    state.input = input;
+    state.output = output;
+    *destination = output * weight;
+    ++destination;
+  }
   return true;
 }
 
@@ -302,6 +749,64 @@ class NonCausalBlockDelayLine : private BlockDelayLine<T, Container>
           , static_cast<size_type>(delay + _initial_delay), weight);
     }
 
+    /// @see BlockDelayLine::read_blocks()
+    template<typename DelayIterator, typename WeightIterator
+      , typename DestinationIterator>
+    bool read_blocks(DelayIterator first, DelayIterator last
+        , WeightIterator weights, DestinationIterator destinations) const
+    {
+      return this->_read_blocks(first, last, weights, destinations
+          , _initial_delay);
+    }
+
+    using typename _base::allpass_state;
+
+    /// @see BlockDelayLine::fractional_delay_is_valid()
+    template<typename Interpolator>
+    bool fractional_delay_is_valid(T delay) const
+    {
+      return _base::template fractional_delay_is_valid<Interpolator>(
+          delay + static_cast<T>(_initial_delay));
+    }
+
+    /// @see BlockDelayLine::read_block_fractional()
+    template<typename Interpolator, typename Iterator>
+    bool read_block_fractional(Iterator destination, T delay
+        , T weight = T(1)) const
+    {
+      return _base::template read_block_fractional<Interpolator>(destination
+          , delay + static_cast<T>(_initial_delay), weight);
+    }
+
+    /// @see BlockDelayLine::read_block_ramp()
+    template<typename Interpolator, typename Iterator>
+    bool read_block_ramp(Iterator destination, T delay_begin, T delay_end
+        , T weight = T(1)) const
+    {
+      return _base::template read_block_ramp<Interpolator>(destination
+          , delay_begin + static_cast<T>(_initial_delay)
+          , delay_end + static_cast<T>(_initial_delay), weight);
+    }
+
+    /// @see BlockDelayLine::read_block_allpass()
+    template<typename Iterator>
+    bool read_block_allpass(Iterator destination, T delay
+        , allpass_state& state, T weight = T(1)) const
+    {
+      return _base::read_block_allpass(destination
+          , delay + static_cast<T>(_initial_delay), state, weight);
+    }
+
+    /// @see BlockDelayLine::read_block_allpass()
+    template<typename Iterator>
+    bool read_block_allpass(Iterator destination, T delay_begin, T delay_end
+        , allpass_state& state, T weight = T(1)) const
+    {
+      return _base::read_block_allpass(destination
+          , delay_begin + static_cast<T>(_initial_delay)
+          , delay_end + static_cast<T>(_initial_delay), state, weight);
+    }
+
     /// @see BlockDelayLine::get_read_circulator()
     circulator get_read_circulator(difference_type delay = 0) const
     {
@@ -31,17 +31,29 @@
 #define APF_CONVOLVER_H
 
 #include <algorithm>  // for std::transform()
+#include <array>
+#include <atomic>
 #include <functional>  // for std::bind()
 #include <cassert>
+#include <thread>
+#include <vector>
+#include <utility>  // for std::pair
 
 #ifdef __SSE__
 #include <xmmintrin.h>  // for SSE instrinsics
 #endif
 
 #include "apf/math.h"
+#ifdef APF_CONVOLVER_BUILTIN_FFT
+#include "apf/fft.h"  // for fft::real_fft
+#else
 #include "apf/fftwtools.h"  // for fftw_allocator and fftw traits
-#include "apf/container.h"  // for fixed_vector, fixed_list
+#endif
+#include "apf/container.h"  // for fixed_vector
+#include "apf/directionindex.h"
+#include "apf/numa.h"  // for numa_allocator
 #include "apf/iterator.h"  // for make_*_iterator()
+#include "apf/threadtools.h"  // for Semaphore
 
 namespace apf
 {
@@ -54,11 +66,26 @@ namespace apf
  *
  * Uses (uniformly) partitioned convolution.
  *
+ * The FFT backend is selected at compile time: By default, FFTW is used.
+ * If @c APF_CONVOLVER_BUILTIN_FFT is defined, the header-only fft::real_fft
+ * is used instead, which doesn't need FFTW but only supports block sizes
+ * which are powers of 2.
+ * Each backend has its own inline namespace, because the layout of the
+ * classes depends on it.  Thus, translation units using different backends
+ * can be linked into the same program.
+ *
  * TODO: describe thread (un)safety
  **/
 namespace conv
 {
 
+#ifdef APF_CONVOLVER_BUILTIN_FFT
+inline namespace builtin_fft_backend
+#else
+inline namespace fftw_backend
+#endif
+{
+
 /// Calculate necessary number of partitions for a given filter length
 static size_t min_partitions(size_t block_size, size_t filter_size)
 {
@@ -67,11 +94,247 @@ static size_t min_partitions(size_t block_size, size_t filter_size)
   return (filter_size + block_size - 1) / block_size;
 }
 
+namespace internal
+{
+
+#ifdef APF_CONVOLVER_BUILTIN_FFT
+
+/// FFT backend using fft::real_fft, which directly uses the sorted format.
+struct builtin_fft
+{
+  template<typename T>
+  using allocator = fft::aligned_allocator<T>;
+
+  /// In-place FFT of @p howmany consecutive partitions.
+  class forward
+  {
+    public:
+      forward(size_t partition_size, size_t howmany, float*)
+        : _fft(partition_size)
+        , _howmany(howmany)
+      {}
+
+      void operator()(float* first) const
+      {
+        for (size_t i = 0; i < _howmany; ++i)
+        {
+          _fft.forward(first + i * _fft.size());
+        }
+      }
+
+      /// Re-entrant version, @p scratch is one partition (aligned)
+      void operator()(float* first, float* scratch) const
+      {
+        for (size_t i = 0; i < _howmany; ++i)
+        {
+          _fft.forward(first + i * _fft.size(), scratch);
+        }
+      }
+
+    private:
+      fft::real_fft _fft;
+      const size_t _howmany;
+  };
+
+  /// In-place inverse FFT (not normalized).
+  class inverse
+  {
+    public:
+      inverse(size_t partition_size, float*) : _fft(partition_size) {}
+
+      void operator()(float* data) const { _fft.inverse(data); }
+
+    private:
+      fft::real_fft _fft;
+  };
+};
+
+using fft_backend = builtin_fft;
+
+#else
+
+void sort_coefficients(float* data, float* buffer, size_t partition_size);
+void unsort_coefficients(float* data, float* buffer, size_t partition_size);
+
+/** FFT backend using FFTW.
+ * The half-complex coefficients are sorted after the FFT and un-sorted before
+ * the IFFT.
+ * @note FFT plans are not re-entrant except when using FFTW_THREADSAFE!
+ *   Even then, the single-argument operator() of forward and inverse is not
+ *   re-entrant, because it sorts the coefficients in internal scratch memory
+ *   (like fft::real_fft).  The forward overload with external scratch memory
+ *   is re-entrant.
+ * @note Once a plan of a certain size exists, creating further plans
+ * is very fast because "wisdom" is shared (and therefore the creation of
+ * plans is not thread-safe).
+ * It is not necessary to re-use plans in other convolver instances.
+ **/
+struct fftw_fft
+{
+  template<typename T>
+  using allocator = fftw_allocator<T>;
+
+  using plan_ptr = std::unique_ptr<fftw<float>::scoped_plan>;
+
+  /// In-place FFT of @p howmany consecutive partitions.
+  class forward
+  {
+    public:
+      /// @param planning_space memory with the alignment of the actual data
+      forward(size_t partition_size, size_t howmany, float* planning_space);
+
+      void operator()(float* first) const;
+      void operator()(float* first, float* scratch) const;
+
+    private:
+      const size_t _partition_size;
+      const size_t _howmany;
+      plan_ptr _plan;
+      mutable fixed_vector<float> _buffer;  ///< for sort_coefficients()
+  };
+
+  /// In-place inverse FFT (not normalized).
+  class inverse
+  {
+    public:
+      inverse(size_t partition_size, float* planning_space);
+
+      void operator()(float* data) const;
+
+    private:
+      const size_t _partition_size;
+      plan_ptr _plan;
+      mutable fixed_vector<float> _buffer;  ///< for unsort_coefficients()
+  };
+};
+
+fftw_fft::forward::forward(size_t partition_size, size_t howmany
+    , float* planning_space)
+  : _partition_size(partition_size)
+  , _howmany(howmany)
+  , _buffer(partition_size)
+{
+  int n = int(partition_size);
+  auto kind = FFTW_R2HC;
+  _plan.reset(new fftw<float>::scoped_plan(fftw<float>::plan_many_r2r
+        , 1, &n, int(howmany)
+        , planning_space, nullptr, 1, n
+        , planning_space, nullptr, 1, n
+        , &kind, FFTW_PATIENT));
+}
+
+void
+fftw_fft::forward::operator()(float* first) const
+{
+  (*this)(first, _buffer.data());
+}
+
+/// Re-entrant version, @p scratch is one partition
+void
+fftw_fft::forward::operator()(float* first, float* scratch) const
+{
+  fftw<float>::execute_r2r(*_plan, first, first);
+  for (size_t i = 0; i < _howmany; ++i)
+  {
+    sort_coefficients(first + i * _partition_size, scratch, _partition_size);
+  }
+}
+
+fftw_fft::inverse::inverse(size_t partition_size, float* planning_space)
+  : _partition_size(partition_size)
+  , _plan(new fftw<float>::scoped_plan(fftw<float>::plan_r2r_1d
+        , int(partition_size), planning_space, planning_space
+        , FFTW_HC2R, FFTW_PATIENT))
+  , _buffer(partition_size)
+{}
+
+void
+fftw_fft::inverse::operator()(float* data) const
+{
+  unsort_coefficients(data, _buffer.data(), _partition_size);
+  fftw<float>::execute_r2r(*_plan, data, data);
+}
+
+/** Sort the FFT coefficients to be in proper place for the efficient
+ * multiplication of the spectra.
+ * @param buffer temporary memory of @p partition_size elements
+ **/
+void
+sort_coefficients(float* data, float* buffer, size_t partition_size)
+{
+  size_t base = 8;
+
+  buffer[0] = data[0];
+  buffer[1] = data[1];
+  buffer[2] = data[2];
+  buffer[3] = data[3];
+  buffer[4] = data[partition_size / 2];
+  buffer[5] = data[partition_size - 1];
+  buffer[6] = data[partition_size - 2];
+  buffer[7] = data[partition_size - 3];
+
+  for (size_t i = 0; i < (partition_size / 8-1); i++)
+  {
+    for (size_t ii = 0; ii < 4; ii++)
+    {
+      buffer[base+ii] = data[base/2+ii];
+    }
+
+    for (size_t ii = 0; ii < 4; ii++)
+    {
+      buffer[base+4+ii] = data[partition_size-base/2-ii];
+    }
+
+    base += 8;
+  }
+
+  std::copy(buffer, buffer + partition_size, data);
+}
+
+/// Inverse of sort_coefficients().
+void
+unsort_coefficients(float* data, float* buffer, size_t partition_size)
+{
+  size_t base = 8;
+
+  buffer[0]                  = data[0];
+  buffer[1]                  = data[1];
+  buffer[2]                  = data[2];
+  buffer[3]                  = data[3];
+  buffer[partition_size / 2] = data[4];
+  buffer[partition_size - 1] = data[5];
+  buffer[partition_size - 2] = data[6];
+  buffer[partition_size - 3] = data[7];
+
+  for (size_t i = 0; i < (partition_size / 8-1); i++)
+  {
+    for (size_t ii = 0; ii < 4; ii++)
+    {
+      buffer[base/2+ii] = data[base+ii];
+    }
+
+    for (size_t ii = 0; ii < 4; ii++)
+    {
+      buffer[partition_size-base/2-ii] = data[base+4+ii];
+    }
+
+    base += 8;
+  }
+
+  std::copy(buffer, buffer + partition_size, data);
+}
+
+using fft_backend = fftw_fft;
+
+#endif
+
+}  // namespace internal
+
 /// Two blocks of time-domain or FFT (half-complex) data.
-struct fft_node : fixed_vector<float, fftw_allocator<float>>
+struct fft_node : fixed_vector<float, internal::fft_backend::allocator<float>>
 {
   explicit fft_node(size_t n)
-    : fixed_vector<float, fftw_allocator<float>>(n)
+    : fixed_vector<float, internal::fft_backend::allocator<float>>(n)
     , zero(true)
   {}
 
@@ -102,6 +365,75 @@ struct fft_node : fixed_vector<float, fftw_allocator<float>>
   bool zero;
 };
 
+/** Ring buffer of FFT blocks (partitions) in one contiguous memory area.
+ * The partitions are accessed by their age, index 0 is the most recent one.
+ * The @c zero flags (see fft_node::zero) are stored separately.
+ **/
+class fft_ring
+{
+  public:
+    /// @param numa_node NUMA node where the memory is allocated, -1 means no
+    ///   specific node, see numa_allocator and MimoProcessor::thread_node().
+    fft_ring(size_t partitions_, size_t partition_size_, int numa_node = -1)
+      : _partition_size(partition_size_)
+      , _stride(partition_size_)
+      , _storage(partitions_ * partition_size_, 0.0f
+          , numa_allocator<float>(numa_node))
+      , _data(_storage.data())
+      , _zero(partitions_, true)
+    {
+      assert(partitions_ > 0);
+    }
+
+    /// Constructor using external memory, which must be aligned like
+    /// memory from fft_backend::allocator.  The partitions are @p stride
+    /// floats apart.
+    fft_ring(size_t partitions_, size_t partition_size_, float* data
+        , size_t stride)
+      : _partition_size(partition_size_)
+      , _stride(stride)
+      , _data(data)
+      , _zero(partitions_, true)
+    {
+      assert(partitions_ > 0);
+      assert(stride >= partition_size_);
+    }
+
+    size_t size() const { return _zero.size(); }
+    size_t partition_size() const { return _partition_size; }
+
+    /// NUMA node of the memory, -1 if unspecified (or external memory).
+    int numa_node() const { return _storage.get_allocator().node; }
+
+    float* data(size_t n) { return _data + _offset(n); }
+    const float* data(size_t n) const { return _data + _offset(n); }
+
+    /// @see fft_node::zero
+    bool zero(size_t n) const { return _zero[_index(n)]; }
+    void set_zero(size_t n, bool value) { _zero[_index(n)] = value; }
+
+    /// The oldest partition becomes the most recent one.
+    void rotate() { _first = _first ? _first - 1 : this->size() - 1; }
+
+  private:
+    size_t _index(size_t n) const
+    {
+      assert(n < this->size());
+      auto i = _first + n;
+      return i < this->size() ? i : i - this->size();
+    }
+
+    size_t _offset(size_t n) const { return _index(n) * _stride; }
+
+    const size_t _partition_size;
+    const size_t _stride;
+    /// Page-aligned (which is enough for fft_backend::allocator), may be empty
+    fixed_vector<float, numa_allocator<float>> _storage;
+    float* _data;
+    std::vector<bool> _zero;
+    size_t _first = 0;  ///< Storage index of the most recent partition
+};
+
 /// Container holding a number of FFT blocks.
 struct Filter : fixed_vector<fft_node>
 {
@@ -120,8 +452,94 @@ struct Filter : fixed_vector<fft_node>
   size_t block_size() const { return this->front().size() / 2; }
   size_t partition_size() const { return this->front().size(); }
   size_t partitions() const { return this->size(); }
+
+  size_t truncate(float threshold_db);
+
+  size_t active_partitions() const;
+  size_t effective_partitions() const;
+
+  static float energy(const fft_node& partition);
 };
 
+/** Skip partitions with negligible energy.
+ * Measured impulse responses often have long tails far below audibility,
+ * which cost as much as the rest of the filter.  Partitions whose energy
+ * (relative to the energy of the strongest partition) is below
+ * @p threshold_db are marked as zero (see fft_node::zero) and therefore
+ * skipped by the convolution.  Their coefficients are left unchanged.
+ * The number of partitions needed for the convolution can be reduced to
+ * effective_partitions(), StaticConvolver does this by default.  With other
+ * Output%s, the zero partitions are still skipped, and if all tail partitions
+ * of a two-stage convolution are zero, its background thread is idle.
+ * @param threshold_db threshold in dB, e.g. -100.  Note that the error can be
+ *   larger than that if many partitions are skipped.
+ * @return number of skipped partitions (not counting the ones which were
+ *   already zero)
+ **/
+size_t
+Filter::truncate(float threshold_db)
+{
+  float peak = 0.0f;
+  for (const auto& partition: *this)
+  {
+    if (!partition.zero) peak = std::max(peak, energy(partition));
+  }
+
+  auto threshold = peak * std::pow(10.0f, threshold_db / 10.0f);
+  size_t skipped = 0;
+  for (auto& partition: *this)
+  {
+    if (!partition.zero && energy(partition) < threshold)
+    {
+      partition.zero = true;
+      ++skipped;
+    }
+  }
+  return skipped;
+}
+
+/// Number of partitions which are not zero, i.e. which actually need to be
+/// multiplied in each block.
+size_t
+Filter::active_partitions() const
+{
+  return static_cast<size_t>(std::count_if(this->begin(), this->end()
+        , [](const fft_node& partition) { return !partition.zero; }));
+}
+
+/// Number of partitions up to the last one which is not zero.
+/// If the filter is used with fewer partitions, nothing is lost.
+size_t
+Filter::effective_partitions() const
+{
+  size_t n = this->partitions();
+  while (n > 0 && (*this)[n - 1].zero) --n;
+  return n;
+}
+
+/** Energy of one partition (in the sorted format, see fft::real_fft).
+ * Because of Parseval's theorem, this is proportional to the energy of the
+ * time-domain signal.
+ **/
+float
+Filter::energy(const fft_node& partition)
+{
+  if (partition.zero) return 0.0f;
+
+  const float* data = partition.data();
+  // DC and Nyquist only appear once in the full spectrum, all others twice
+  float sum = 0.5f * (data[0] * data[0] + data[4] * data[4]);
+  for (size_t i = 1; i < 4; ++i)
+  {
+    sum += data[i] * data[i] + data[i + 4] * data[i + 4];
+  }
+  for (size_t i = 8; i < partition.size(); ++i)
+  {
+    sum += data[i] * data[i];
+  }
+  return 2.0f * sum / float(partition.size());
+}
+
 /// Forward-FFT-related functions
 class TransformBase
 {
@@ -141,22 +559,22 @@ class TransformBase
     TransformBase(TransformBase&&) = default;
     ~TransformBase() = default;
 
-    using scoped_plan = fftw<float>::scoped_plan;
-    using plan_ptr = std::unique_ptr<scoped_plan>;
+    using plan_ptr = std::unique_ptr<internal::fft_backend::forward>;
 
     plan_ptr _create_plan(float* array) const;
 
-    /// In-place FFT
-    void _fft(float* first) const
-    {
-      fftw<float>::execute_r2r(*_fft_plan, first, first);
-      _sort_coefficients(first);
-    }
+    /// In-place FFT, the result is in the sorted format
+    void _fft(float* first) const { (*_fft_plan)(first); }
 
     plan_ptr _fft_plan;
 
   private:
-    void _sort_coefficients(float* first) const;
+    using scratch_t
+      = fixed_vector<float, internal::fft_backend::allocator<float>>;
+
+    template<typename In>
+    In _prepare_partition(In first, In last, fft_node& partition
+        , scratch_t& scratch) const;
 
     const size_t _block_size;
     const size_t _partition_size;
@@ -172,23 +590,24 @@ TransformBase::TransformBase(size_t block_size_)
   }
 }
 
-/** Create in-place FFT plan for halfcomplex data format.
- * @note FFT plans are not re-entrant except when using FFTW_THREADSAFE!
- * @note Once a plan of a certain size exists, creating further plans
- * is very fast because "wisdom" is shared (and therefore the creation of
- * plans is not thread-safe).
- * It is not necessary to re-use plans in other convolver instances.
-  **/
+/** Create in-place FFT plan.
+ * @param array memory with the alignment of the actual data (only used by
+ *   some backends for planning)
+ * @see internal::fftw_fft
+ **/
 TransformBase::plan_ptr
 TransformBase::_create_plan(float* array) const
 {
-  return plan_ptr(new scoped_plan(fftw<float>::plan_r2r_1d, int(_partition_size)
-      , array, array, FFTW_R2HC, FFTW_PATIENT));
+  return plan_ptr(new internal::fft_backend::forward(_partition_size, 1
+        , array));
 }
 
 /** %Transform time-domain samples.
  * If there are too few input samples, the rest is zero-padded, if there are
  * too few blocks in the container @p c, the rest of the samples is ignored.
+ * The FFT uses scratch memory which is allocated here, therefore this can be
+ * called concurrently with Input::add_block() on the same object (but it is
+ * not realtime-safe).
  * @param first Iterator to first time-domain sample
  * @param last Past-the-end iterator
  * @param[out] filter Target container
@@ -197,14 +616,16 @@ template<typename In>
 void
 TransformBase::prepare_filter(In first, In last, Filter& filter) const
 {
+  scratch_t scratch(_partition_size);
   for (auto& partition: filter)
   {
-    first = this->prepare_partition(first, last, partition);
+    first = _prepare_partition(first, last, partition, scratch);
   }
 }
 
 /** FFT of one block.
  * If there are too few coefficients, the rest is zero-padded.
+ * Like prepare_filter(), this allocates its own scratch memory.
  * @param first Iterator to first coefficient
  * @param last Past-the-end iterator
  * @param[out] partition Target partition
@@ -215,6 +636,15 @@ TransformBase::prepare_filter(In first, In last, Filter& filter) const
 template<typename In>
 In
 TransformBase::prepare_partition(In first, In last, fft_node& partition) const
+{
+  scratch_t scratch(_partition_size);
+  return _prepare_partition(first, last, partition, scratch);
+}
+
+template<typename In>
+In
+TransformBase::_prepare_partition(In first, In last, fft_node& partition
+    , scratch_t& scratch) const
 {
   assert(std::distance(partition.begin(), partition.end())
       == static_cast<fft_node::difference_type>(_partition_size));
@@ -233,56 +663,19 @@ TransformBase::prepare_partition(In first, In last, fft_node& partition) const
   {
     std::copy(first, first + chunk, partition.begin());
     std::fill(partition.begin() + chunk, partition.end(), 0.0f); // zero padding
-    _fft(partition.data());
+    (*_fft_plan)(partition.data(), scratch.data());
     partition.zero = false;
   }
   return first + chunk;
 }
 
-/** Sort the FFT coefficients to be in proper place for the efficient
- * multiplication of the spectra.
- **/
-void
-TransformBase::_sort_coefficients(float* data) const
-{
-  auto buffer = fixed_vector<float>(_partition_size);
-
-  size_t base = 8;
-
-  buffer[0] = data[0];
-  buffer[1] = data[1];
-  buffer[2] = data[2];
-  buffer[3] = data[3];
-  buffer[4] = data[_block_size];
-  buffer[5] = data[_partition_size - 1];
-  buffer[6] = data[_partition_size - 2];
-  buffer[7] = data[_partition_size - 3];
-
-  for (size_t i = 0; i < (_partition_size / 8-1); i++)
-  {
-    for (size_t ii = 0; ii < 4; ii++)
-    {
-      buffer[base+ii] = data[base/2+ii];
-    }
-
-    for (size_t ii = 0; ii < 4; ii++)
-    {
-      buffer[base+4+ii] = data[_partition_size-base/2-ii];
-    }
-
-    base += 8;
-  }
-
-  std::copy(buffer.begin(), buffer.end(), data);
-}
-
 /// Helper class to prepare filters
 struct Transform : TransformBase
 {
   Transform(size_t block_size_)
     : TransformBase(block_size_)
   {
-    // Temporary memory area for FFTW planning routines
+    // Temporary memory area for FFT planning routines
     fft_node planning_space(this->partition_size());
     _fft_plan = _create_plan(planning_space.data());
   }
@@ -307,86 +700,716 @@ struct Input : TransformBase
 {
   /// @param block_size_ audio block size
   /// @param partitions_ number of partitions
-  Input(size_t block_size_, size_t partitions_)
+  /// @param numa_node NUMA node for the input spectra, see fft_ring
+  Input(size_t block_size_, size_t partitions_, int numa_node = -1)
     : TransformBase(block_size_)
-    // One additional list element for preparing the upcoming partition:
-    , spectra(partitions_ + 1, this->partition_size())
+    // One additional partition for preparing the upcoming partition:
+    , spectra(partitions_ + 1, this->partition_size(), numa_node)
   {
     assert(partitions_ > 0);
 
-    _fft_plan = _create_plan(spectra.front().data());
-  }
+    // All partitions have the same alignment, one plan can be used for all
+    _fft_plan = _create_plan(spectra.data(0));
+  }
+
+  template<typename In>
+  void add_block(In first);
+
+  size_t partitions() const { return spectra.size() - 1; }
+
+  /// Spectra of the partitions (double-blocks) of the input signal to be
+  /// convolved. The first element is the most recent signal chunk.
+  fft_ring spectra;
+
+  private:
+    friend class MultiInput;
+
+    /// Constructor for MultiInput, the spectra are stored in external memory.
+    Input(size_t block_size_, size_t partitions_, float* data, size_t stride)
+      : TransformBase(block_size_)
+      , spectra(partitions_ + 1, this->partition_size(), data, stride)
+    {
+      assert(partitions_ > 0);
+      _fft_plan = _create_plan(spectra.data(0));
+    }
+
+    template<typename In>
+    void _add_time_data(In first);
+};
+
+/** Add a block of time-domain input samples.
+ * @param first Iterator to first sample.
+ * @tparam In Forward iterator
+ **/
+template<typename In>
+void
+Input::add_block(In first)
+{
+  _add_time_data(first);
+
+  if (this->spectra.zero(0))
+  {
+    // Nothing to be done, FFT of zero is also zero
+  }
+  else
+  {
+    _fft(this->spectra.data(0));
+  }
+}
+
+/// Rotate the spectra and store the new samples, everything but the FFT.
+template<typename In>
+void
+Input::_add_time_data(In first)
+{
+  In last = first;
+  std::advance(last, static_cast<std::ptrdiff_t>(this->block_size()));
+
+  // rotate buffers (this->spectra.size() is always at least 2)
+  this->spectra.rotate();
+
+  const size_t next = this->partitions();
+  auto current_data = this->spectra.data(0);
+  auto offset = this->block_size();
+
+  if (math::has_only_zeros(first, last))
+  {
+    this->spectra.set_zero(next, true);
+
+    if (this->spectra.zero(0))
+    {
+      // Nothing to be done, actual data is ignored
+    }
+    else
+    {
+      // If first half is not zero, second half must be filled with zeros
+      std::fill(current_data + offset, current_data + 2 * offset, 0.0f);
+    }
+  }
+  else
+  {
+    if (this->spectra.zero(0))
+    {
+      // First half must be actually filled with zeros
+      std::fill(current_data, current_data + offset, 0.0f);
+    }
+
+    // Copy data to second half of the current partition
+    std::copy(first, last, current_data + offset);
+    this->spectra.set_zero(0, false);
+    // Copy data to first half of the upcoming partition
+    std::copy(first, last, this->spectra.data(next));
+    this->spectra.set_zero(next, false);
+  }
+}
+
+/** %Input stage for several channels, transformed with one batched FFT.
+ * All channels have the same block size and number of partitions.
+ * Their spectra are interleaved partition by partition in one memory area,
+ * so that the most recent partitions of all channels are contiguous and can
+ * be transformed with a single batched FFT (e.g. @c fftw_plan_many_r2r()).
+ * This saves the per-call overhead of many small FFTs.
+ *
+ * Each channel is a normal Input, which can be used with Output and
+ * StaticOutput (but its add_block() must not be called).
+ **/
+class MultiInput
+{
+  public:
+    MultiInput(size_t block_size_, size_t partitions_, size_t channels_);
+
+    template<typename In>
+    void add_blocks(In first);
+
+    size_t channels() const { return _channels.size(); }
+
+    /// Access to a single channel, e.g. for constructing an Output.
+    const Input& operator[](size_t channel) const
+    {
+      assert(channel < this->channels());
+      return _channels[channel];
+    }
+
+  private:
+    fixed_vector<float, internal::fft_backend::allocator<float>> _data;
+    std::vector<Input> _channels;
+    internal::fft_backend::forward _plan;
+};
+
+MultiInput::MultiInput(size_t block_size_, size_t partitions_
+    , size_t channels_)
+  // One additional partition for preparing the upcoming partition:
+  : _data((partitions_ + 1) * channels_ * 2 * block_size_)
+  , _plan(2 * block_size_, channels_, _data.data())
+{
+  assert(channels_ > 0);
+
+  auto partition_size = 2 * block_size_;
+  auto stride = channels_ * partition_size;
+
+  _channels.reserve(channels_);
+  for (size_t i = 0; i < channels_; ++i)
+  {
+    _channels.push_back(Input(block_size_, partitions_
+          , _data.data() + i * partition_size, stride));
+  }
+}
+
+/** Add a block of time-domain input samples to each channel.
+ * @param first Iterator to the per-channel iterators (e.g. an array of
+ *   @c float*) pointing to the first sample of each channel.
+ *   channels() iterators are used.
+ * @tparam In Forward iterator
+ **/
+template<typename In>
+void
+MultiInput::add_blocks(In first)
+{
+  size_t active = 0;
+  for (auto& channel: _channels)
+  {
+    channel._add_time_data(*first++);
+    if (!channel.spectra.zero(0)) ++active;
+  }
+
+  if (active == 0) return;
+
+  if (2 * active < this->channels())
+  {
+    // If most channels are silent, transforming them all is a waste
+    for (auto& channel: _channels)
+    {
+      if (!channel.spectra.zero(0)) channel._fft(channel.spectra.data(0));
+    }
+    return;
+  }
+
+  // The channels' rings rotate in lockstep, their current partitions are
+  // contiguous.  Silent channels are transformed, too, but not used.
+  _plan(_channels.front().spectra.data(0));
+}
+
+namespace internal
+{
+
+#ifdef __SSE__
+/// Complex multiply-accumulate of 4 sorted coefficients (see bruteconv_4).
+inline void
+multiply_accumulate(const float* signal, const float* filter
+    , __m128& real, __m128& imag)
+{
+  // load real and imaginary parts of signal and filter
+  __m128 sigr = _mm_load_ps(signal);
+  __m128 sigi = _mm_load_ps(signal + 4);
+  __m128 filtr = _mm_load_ps(filter);
+  __m128 filti = _mm_load_ps(filter + 4);
+
+  // multiply and subtract
+  real = _mm_add_ps(real
+      , _mm_sub_ps(_mm_mul_ps(sigr, filtr), _mm_mul_ps(sigi, filti)));
+
+  // multiply and add
+  imag = _mm_add_ps(imag
+      , _mm_add_ps(_mm_mul_ps(sigr, filti), _mm_mul_ps(sigi, filtr)));
+}
+#endif
+
+/** Complex multiplication of a range of input and filter partitions.
+ * The products are summed up into one spectrum.
+ * OutputBase uses one of these for each part of a split convolution.
+ *
+ * The (input, filter) pairs are collected with gather() and multiplied with
+ * accumulate(), these steps may happen in different threads (see tail_stage).
+ **/
+class spectrum_accumulator
+{
+  public:
+    using filter_ptrs_t = fixed_vector<const fft_node*>;
+
+    /// Accumulate the partitions [first, last).
+    spectrum_accumulator(size_t first, size_t last)
+      : _first(first)
+      , _last(last)
+      , _active(last - first)
+      , _active_partitions(0)
+    {
+      assert(first < last);
+    }
+
+    void operator()(const fft_ring& input, const filter_ptrs_t& filters
+        , fft_node& result)
+    {
+      this->gather(input, filters);
+      this->accumulate(result);
+    }
+
+    void gather(const fft_ring& input, const filter_ptrs_t& filters
+        , size_t delay = 0);
+    void accumulate(fft_node& result) const;
+
+    /// Number of partitions with a non-zero product, see gather().
+    size_t active_partitions() const { return _active_partitions; }
+
+  private:
+    /// Number of coefficients of the result which are accumulated at once.
+    /// 1024 floats (4 KiB) stay in L1 together with the streamed spectra.
+    static constexpr size_t _tile_size = 1024;
+
+    /// Size (in bytes) of the spectra up to which the tiles are used.
+    /// Larger spectra come from main memory, where two streams at a time
+    /// (one pass per partition) are prefetched better than eight.
+    static constexpr size_t _max_tiled_bytes = size_t(2) << 20;
+
+    void _multiply_tile_cpp(float* out, size_t begin, size_t end) const;
+#ifdef __SSE__
+    void _multiply_tile_simd(float* out, size_t begin, size_t end) const;
+    void _multiply_single_simd(float* out, size_t begin, size_t end
+        , size_t first) const;
+#endif
+
+    size_t _first, _last;
+
+    /// Pairs of (input, filter) spectra with a non-zero contribution.
+    /// Only the first _active_partitions elements are valid.
+    fixed_vector<std::pair<const float*, const float*>> _active;
+    size_t _active_partitions;
+
+    // DC and Nyquist are purely real and don't follow the complex scheme
+    float _dc = 0.0f, _ny = 0.0f;
+};
+
+/** Collect the pairs of input and filter spectra with a non-zero product.
+ * @param input input spectra
+ * @param filters filter partitions (all of them, not only [first, last))
+ * @param delay The input partitions are taken from @p delay blocks earlier,
+ *   i.e. partition @c n uses the input spectrum @c n - @p delay.  This allows
+ *   preparing the accumulation for a future block.
+ **/
+void
+spectrum_accumulator::gather(const fft_ring& input
+    , const filter_ptrs_t& filters, size_t delay)
+{
+  assert(_last <= filters.size());
+  assert(delay <= _first);
+
+  _dc = 0.0f;
+  _ny = 0.0f;
+  _active_partitions = 0;
+  for (size_t n = _first; n < _last; ++n)
+  {
+    const auto* filter = filters[n];
+    assert(filter != nullptr);
+
+    if (input.zero(n - delay) || filter->zero)
+    {
+      // do nothing. There is no contribution if either is zero.
+    }
+    else
+    {
+      const float* signal = input.data(n - delay);
+      _dc += signal[0] * filter->data()[0];
+      _ny += signal[4] * filter->data()[4];
+      _active[_active_partitions++] = std::make_pair(signal, filter->data());
+    }
+  }
+}
+
+/** Complex multiplication of the spectra collected by gather().
+ * If the spectra fit into the cache, the frequency axis is split into tiles
+ * of _tile_size coefficients and all partitions are accumulated for one tile
+ * before moving on to the next, so that the accumulated part of @p result
+ * stays in L1 cache.  Otherwise, there is one pass over @p result per
+ * partition.
+ **/
+void
+spectrum_accumulator::accumulate(fft_node& result) const
+{
+  // Clear buffer (must be actually filled with zeros!)
+  std::fill(result.begin(), result.end(), 0.0f);
+  result.zero = true;
+
+  if (_active_partitions == 0) return;
+
+  result.zero = false;
+
+  auto bytes = 2 * _active_partitions * result.size() * sizeof(float);
+  if (bytes > _max_tiled_bytes)
+  {
+#ifdef __SSE__
+    _multiply_single_simd(result.data(), 0, result.size(), 0);
+#else
+    _multiply_tile_cpp(result.data(), 0, result.size());
+#endif
+  }
+  else
+  {
+    for (size_t begin = 0; begin < result.size(); begin += _tile_size)
+    {
+      auto end = std::min(begin + _tile_size, result.size());
+#ifdef __SSE__
+      _multiply_tile_simd(result.data(), begin, end);
+#else
+      _multiply_tile_cpp(result.data(), begin, end);
+#endif
+    }
+  }
+
+  result[0] = _dc;
+  result[4] = _ny;
+}
+
+/** Accumulate all active partitions for the coefficients [begin, end).
+ * The accumulated region must be cleared beforehand.
+ * Coefficients 0 and 4 (DC and Nyquist) are handled in accumulate().
+ **/
+void
+spectrum_accumulator::_multiply_tile_cpp(float* out, size_t begin
+    , size_t end) const
+{
+  // see http://www.ludd.luth.se/~torger/brutefir.html#bruteconv_4
+
+  for (size_t n = 0; n < _active_partitions; ++n)
+  {
+    const float* signal = _active[n].first;
+    const float* filter = _active[n].second;
+
+    for (size_t nn = begin; nn < end; nn += 8)
+    {
+      // real parts
+      out[nn+0] += signal[nn+0] * filter[nn + 0] -
+                   signal[nn+4] * filter[nn + 4];
+      out[nn+1] += signal[nn+1] * filter[nn + 1] -
+                   signal[nn+5] * filter[nn + 5];
+      out[nn+2] += signal[nn+2] * filter[nn + 2] -
+                   signal[nn+6] * filter[nn + 6];
+      out[nn+3] += signal[nn+3] * filter[nn + 3] -
+                   signal[nn+7] * filter[nn + 7];
+
+      // imaginary parts
+      out[nn+4] += signal[nn+0] * filter[nn + 4] +
+                   signal[nn+4] * filter[nn + 0];
+      out[nn+5] += signal[nn+1] * filter[nn + 5] +
+                   signal[nn+5] * filter[nn + 1];
+      out[nn+6] += signal[nn+2] * filter[nn + 6] +
+                   signal[nn+6] * filter[nn + 2];
+      out[nn+7] += signal[nn+3] * filter[nn + 7] +
+                   signal[nn+7] * filter[nn + 3];
+    } // for
+  }
+}
+
+#ifdef __SSE__
+/** SIMD version of _multiply_tile_cpp().
+ * Four partitions at a time are accumulated in registers, which quarters the
+ * loads and stores of the result compared to one pass per partition.
+ **/
+void
+spectrum_accumulator::_multiply_tile_simd(float* out, size_t begin
+    , size_t end) const
+{
+  // 16 byte alignment is needed for _mm_load_ps()!
+  // This should be the case anyway because fft_backend::allocator is used.
+
+  size_t n = 0;
+  for (; n + 4 <= _active_partitions; n += 4)
+  {
+    const float* s0 = _active[n + 0].first;
+    const float* s1 = _active[n + 1].first;
+    const float* s2 = _active[n + 2].first;
+    const float* s3 = _active[n + 3].first;
+    const float* f0 = _active[n + 0].second;
+    const float* f1 = _active[n + 1].second;
+    const float* f2 = _active[n + 2].second;
+    const float* f3 = _active[n + 3].second;
+
+    for (size_t i = begin; i < end; i += 8)
+    {
+      __m128 real = _mm_load_ps(out + i);
+      __m128 imag = _mm_load_ps(out + i + 4);
+      multiply_accumulate(s0 + i, f0 + i, real, imag);
+      multiply_accumulate(s1 + i, f1 + i, real, imag);
+      multiply_accumulate(s2 + i, f2 + i, real, imag);
+      multiply_accumulate(s3 + i, f3 + i, real, imag);
+      _mm_store_ps(out + i, real);
+      _mm_store_ps(out + i + 4, imag);
+    }
+  }
+  _multiply_single_simd(out, begin, end, n);
+}
+
+/// Accumulate the active partitions from @p first on for the coefficients
+/// [begin, end), one pass per partition.
+void
+spectrum_accumulator::_multiply_single_simd(float* out, size_t begin
+    , size_t end, size_t first) const
+{
+  for (size_t n = first; n < _active_partitions; ++n)
+  {
+    const float* signal = _active[n].first;
+    const float* filter = _active[n].second;
+
+    for (size_t i = begin; i < end; i += 8)
+    {
+      __m128 real = _mm_load_ps(out + i);
+      __m128 imag = _mm_load_ps(out + i + 4);
+      multiply_accumulate(signal + i, filter + i, real, imag);
+      _mm_store_ps(out + i, real);
+      _mm_store_ps(out + i + 4, imag);
+    }
+  }
+}
+#endif
+
+/** Tail of a two-stage convolution, see OutputBase::two_stage().
+ * The accumulation of the tail partitions for the next block is prepared with
+ * dispatch() and done by a background thread.  collect() returns the result,
+ * if the thread didn't finish in time, it is computed in the calling thread.
+ *
+ * The background thread doesn't read the input spectra of the Input (which
+ * are overwritten by Input::add_block() while it might still be running), but
+ * copies of them.  They are only updated while the background thread isn't
+ * busy.
+ *
+ * The handoff between audio thread and background thread is lock-free, only
+ * the semaphore is used to wake up the background thread.
+ **/
+class tail_stage : NonCopyable
+{
+  public:
+    using filter_ptrs_t = spectrum_accumulator::filter_ptrs_t;
+
+    tail_stage(size_t first, size_t last, size_t partitions
+        , size_t partition_size, int priority = 0, int numa_node = -1);
+    ~tail_stage();
+
+    /// Filter partitions of the next block, to be set before dispatch().
+    filter_ptrs_t& upcoming_filters() { return _upcoming_filters; }
+
+    void dispatch(const fft_ring& input);
+    const fft_node& collect(const fft_ring& input
+        , const filter_ptrs_t& filters);
+
+    /// Number of blocks where the background thread was too late.
+    size_t deadline_misses() const { return _deadline_misses; }
+
+  private:
+    enum state_t { idle, queued, busy, done };
+
+    void _copy_spectrum(const fft_ring& input, size_t n);
+    void _thread_function();
+
+    const size_t _first, _last;
+
+    filter_ptrs_t _upcoming_filters;
+
+    /// Copies of the input spectra which are used by the tail in the next
+    /// block, index 0 is the most recent one.
+    fft_ring _spectra;
+    /// Number of copies which were skipped because the background thread was
+    /// busy (and initially all of them).
+    size_t _stale;
+
+    // used by the background thread (or by collect() if not started in time)
+    spectrum_accumulator _accumulator;
+    fft_node _result;
 
-  template<typename In>
-  void add_block(In first);
+    // used by collect() if the background thread is still busy
+    spectrum_accumulator _fallback_accumulator;
+    fft_node _fallback;
 
-  size_t partitions() const { return spectra.size() - 1; }
+    std::atomic<int> _state;
+    bool _dispatched = false;
+    size_t _deadline_misses = 0;
 
-  /// Spectra of the partitions (double-blocks) of the input signal to be
-  /// convolved. The first element is the most recent signal chunk.
-  fixed_list<fft_node> spectra;
+    std::atomic<bool> _keep_running;
+    Semaphore _semaphore;
+    std::thread _thread;  ///< Must be initialized last
 };
 
-/** Add a block of time-domain input samples.
- * @param first Iterator to first sample.
- * @tparam In Forward iterator
+/// @param priority Priority of the background thread, see
+///   set_thread_priority().
+/// @param numa_node see fft_ring
+tail_stage::tail_stage(size_t first, size_t last, size_t partitions
+    , size_t partition_size, int priority, int numa_node)
+  : _first(first)
+  , _last(last)
+  , _upcoming_filters(partitions)
+  // One more for the copy which is made while the background thread is busy
+  , _spectra(last - first + 1, partition_size, numa_node)
+  , _stale(last - first)
+  , _accumulator(first, last)
+  , _result(partition_size)
+  , _fallback_accumulator(first, last)
+  , _fallback(partition_size)
+  , _state(idle)
+  , _keep_running(true)
+  , _thread(&tail_stage::_thread_function, this)
+{
+  assert(first > 0);
+  assert(first < last);
+
+  // Errors are ignored, if it doesn't work, the thread keeps the priority of
+  // the calling thread
+  set_thread_priority(_thread.native_handle(), priority);
+}
+
+tail_stage::~tail_stage()
+{
+  _keep_running.store(false, std::memory_order_release);
+  _semaphore.post();
+  _thread.join();
+}
+
+/** Prepare the tail of the next block and wake up the background thread.
+ * This must be called at the end of each block (after Input::add_block()).
+ * If the background thread is still busy with an earlier block, nothing is
+ * dispatched and the next collect() computes the tail itself.
+ * If all products of the tail are zero, the background thread isn't woken up.
  **/
-template<typename In>
 void
-Input::add_block(In first)
+tail_stage::dispatch(const fft_ring& input)
 {
-  In last = first;
-  std::advance(last, static_cast<std::ptrdiff_t>(this->block_size()));
+  _spectra.rotate();
 
-  // rotate buffers (this->spectra.size() is always at least 2)
-  this->spectra.move(--this->spectra.end(), this->spectra.begin());
+  // idle or done: the background thread doesn't touch _accumulator and
+  // _spectra
+  if (_state.load(std::memory_order_acquire) == busy)
+  {
+    _stale = std::min(_stale + 1, _spectra.size() - 1);
+    return;
+  }
+
+  // Input partition n of the next block is partition n - 1 of this block.
+  // Only the most recent one is new, except if copies were skipped.
+  for (size_t n = 0; n <= _stale; ++n)
+  {
+    _copy_spectrum(input, n);
+  }
+  _stale = 0;
 
-  auto& current = this->spectra.front();
-  auto& next = this->spectra.back();
+  _accumulator.gather(_spectra, _upcoming_filters, _first);
+  _dispatched = true;
+
+  if (_accumulator.active_partitions() == 0)
+  {
+    // Nothing to do for the background thread (e.g. silent input or tail
+    // partitions removed by Filter::truncate())
+    _accumulator.accumulate(_result);
+    _state.store(done, std::memory_order_relaxed);
+    return;
+  }
 
-  auto offset = static_cast<fft_node::difference_type>(this->block_size());
+  _state.store(queued, std::memory_order_release);
+  _semaphore.post();
+}
 
-  if (math::has_only_zeros(first, last))
+/** Get the accumulated tail of the current block.
+ * This is the deadline check: If the background thread hasn't finished,
+ * the accumulation is done in the calling thread.
+ * If the tail partitions of @p filters are not the ones which were dispatched
+ * (e.g. because of Output::set_filter() after the end of the previous
+ * block), the dispatched result is discarded and the tail is computed in the
+ * calling thread, too.
+ * @param input input spectra (needed if nothing was dispatched)
+ * @param filters current filter partitions
+ **/
+const fft_node&
+tail_stage::collect(const fft_ring& input, const filter_ptrs_t& filters)
+{
+  if (_dispatched)
   {
-    next.zero = true;
+    _dispatched = false;
+
+    bool valid = std::equal(filters.begin() + _first, filters.begin() + _last
+        , _upcoming_filters.begin() + _first);
 
-    if (current.zero)
+    int state = queued;
+    if (_state.compare_exchange_strong(state, idle
+          , std::memory_order_acq_rel))
     {
-      // Nothing to be done, actual data is ignored
+      // Not yet started, the background thread will ignore it
+      if (valid)
+      {
+        ++_deadline_misses;
+        _accumulator.accumulate(_result);
+        return _result;
+      }
     }
-    else
+    else if (state == done)
     {
-      // If first half is not zero, second half must be filled with zeros
-      std::fill(current.begin() + offset, current.end(), 0.0f);
+      _state.store(idle, std::memory_order_relaxed);
+      if (valid) return _result;
     }
-  }
-  else
-  {
-    if (current.zero)
+    else if (valid)
     {
-      // First half must be actually filled with zeros
-      std::fill(current.begin(), current.begin() + offset, 0.0f);
+      // Still busy, the result will be discarded
+      ++_deadline_misses;
     }
-
-    // Copy data to second half of the current partition
-    std::copy(first, last, current.begin() + offset);
-    current.zero = false;
-    // Copy data to first half of the upcoming partition
-    std::copy(first, last, next.begin());
-    next.zero = false;
   }
+  _fallback_accumulator.gather(input, filters);
+  _fallback_accumulator.accumulate(_fallback);
+  return _fallback;
+}
 
-  if (current.zero)
+/// Copy input partition @p n + _first - 1 to _spectra[n].
+void
+tail_stage::_copy_spectrum(const fft_ring& input, size_t n)
+{
+  auto age = n + _first - 1;
+  if (input.zero(age))
   {
-    // Nothing to be done, FFT of zero is also zero
+    _spectra.set_zero(n, true);
   }
   else
   {
-    _fft(current.data());
+    std::copy(input.data(age), input.data(age) + input.partition_size()
+        , _spectra.data(n));
+    _spectra.set_zero(n, false);
+  }
+}
+
+void
+tail_stage::_thread_function()
+{
+  for (;;)
+  {
+    _semaphore.wait();
+    if (!_keep_running.load(std::memory_order_acquire)) break;
+
+    int state = queued;
+    if (!_state.compare_exchange_strong(state, busy
+          , std::memory_order_acq_rel))
+    {
+      // Already collected
+      continue;
+    }
+    _accumulator.accumulate(_result);
+    _state.store(done, std::memory_order_release);
   }
 }
 
-/// Base class for Output and StaticOutput
+}  // namespace internal
+
+/** Base class for Output and StaticOutput.
+ *
+ * For very long filters, convolve() can be split into parts which are
+ * processed in parallel (e.g. by the threads of a MimoProcessor, see
+ * MimoProcessor::_process_split()):
+ *                                                                     @code
+ * output.split(threads, 64);  // at least 64 partitions per part
+ *
+ * // in the audio thread(s), each step is a barrier:
+ * multiply_part(0), ..., multiply_part(parts() - 1)  // concurrently
+ * reduce_part(0), ..., reduce_part(parts() - 1)  // concurrently
+ * float* result = finish();
+ *                                                                  @endcode
+ * multiply_part() accumulates a range of partitions into a partial spectrum,
+ * reduce_part() sums a range of coefficients of all partial spectra and
+ * finish() does the single IFFT.
+ *
+ * Alternatively (or additionally), the late partitions can be moved out of
+ * the audio thread, see two_stage().
+ **/
 class OutputBase
 {
   public:
@@ -395,32 +1418,63 @@ class OutputBase
     size_t block_size() const { return _input.block_size(); }
     size_t partitions() const { return _filter_ptrs.size(); }
 
+    size_t split(size_t parts, size_t min_partitions = 1);
+
+    /// Number of parts of a split convolution, see split().
+    size_t parts() const { return _accumulators.size(); }
+
+    void multiply_part(size_t part);
+    void reduce_part(size_t part);
+    float* finish(float weight = 1.0f);
+
+    size_t two_stage(size_t head_partitions, int priority = 0);
+
+    /// Number of partitions which are computed in the audio thread.
+    size_t head_partitions() const { return _head_partitions; }
+
+    size_t active_partitions() const;
+
+    /// Number of blocks where the tail of a two-stage convolution wasn't ready
+    /// in time and had to be computed in the audio thread.
+    size_t deadline_misses() const
+    {
+      return _tail ? _tail->deadline_misses() : 0;
+    }
+
   protected:
     explicit OutputBase(const Input& input);
 
+    virtual ~OutputBase() = default;
+    OutputBase(OutputBase&&) = default;
+
     // This is non-const to allow automatic move-constructor:
     fft_node _empty_partition;
 
-    using filter_ptrs_t = fixed_vector<const fft_node*>;
+    using filter_ptrs_t = internal::spectrum_accumulator::filter_ptrs_t;
     filter_ptrs_t _filter_ptrs;
 
-  private:
-    void _multiply_spectra();
-    void _multiply_partition_cpp(const float* signal, const float* filter);
-#ifdef __SSE__
-    void _multiply_partition_simd(const float* signal, const float* filter);
-#endif
-
-    void _unsort_coefficients();
-
-    void _ifft();
+    /// Filter partitions which will be used in the next block.
+    /// This is needed to prepare the tail of a two-stage convolution.
+    virtual void _get_upcoming_filters(filter_ptrs_t& upcoming) const
+    {
+      std::copy(_filter_ptrs.begin(), _filter_ptrs.end(), upcoming.begin());
+    }
 
+  private:
     const Input& _input;
 
     const size_t _partition_size;
 
     fft_node _output_buffer;
-    fftw<float>::scoped_plan _ifft_plan;
+    internal::fft_backend::inverse _ifft_plan;
+
+    /// One per part, the first one accumulates directly into _output_buffer.
+    std::vector<internal::spectrum_accumulator> _accumulators;
+    /// Partial spectra of the parts 1 to parts() - 1.
+    std::vector<fft_node> _partials;
+
+    size_t _head_partitions;
+    std::unique_ptr<internal::tail_stage> _tail;  ///< Only in two-stage mode
 };
 
 OutputBase::OutputBase(const Input& input)
@@ -430,11 +1484,11 @@ OutputBase::OutputBase(const Input& input)
   , _input(input)
   , _partition_size(input.partition_size())
   , _output_buffer(_partition_size)
-  , _ifft_plan(fftw<float>::plan_r2r_1d, int(_partition_size)
-      , _output_buffer.data()
-      , _output_buffer.data(), FFTW_HC2R, FFTW_PATIENT)
+  , _ifft_plan(_partition_size, _output_buffer.data())
+  , _head_partitions(_filter_ptrs.size())
 {
   assert(_filter_ptrs.size() > 0);
+  this->split(1);
 }
 
 /** Fast convolution of one audio block.
@@ -447,185 +1501,212 @@ OutputBase::OutputBase(const Input& input)
 float*
 OutputBase::convolve(float weight)
 {
-  _multiply_spectra();
-
-  auto offset = static_cast<fft_node::difference_type>(_input.block_size());
-
-  // The first half will be discarded
-  auto second_half = make_begin_and_end(
-      _output_buffer.begin() + offset, _output_buffer.end());
-
-  assert(std::distance(second_half.begin(), second_half.end()) == offset);
-
-  if (_output_buffer.zero)
+  for (size_t part = 0; part < this->parts(); ++part)
   {
-    // Nothing to be done, IFFT of zero is also zero.
-    // _output_buffer was already reset to zero in _multiply_spectra().
+    this->multiply_part(part);
   }
-  else
+  for (size_t part = 0; part < this->parts(); ++part)
   {
-    _ifft();
-
-    // normalize buffer (fftw3 does not do this)
-    const auto norm = weight / float(_partition_size);
-    for (auto& x: second_half)
-    {
-      x *= norm;
-    }
+    this->reduce_part(part);
   }
-  return &second_half[0];
+  return this->finish(weight);
 }
 
-void
-OutputBase::_multiply_partition_cpp(const float* signal, const float* filter)
+/** Divide the partitions into (at most) @p parts contiguous ranges.
+ * Splitting only pays off if each part has enough partitions to outweigh the
+ * additional reduction step and the synchronization between threads.
+ * @param parts maximum number of parts, typically the number of threads.
+ * @param min_partitions minimum number of partitions per part. If there are
+ *   less than 2 * @p min_partitions partitions, the convolution isn't split.
+ *   In two-stage mode, only the head partitions are counted.
+ * @return actual number of parts, 1 means no splitting.
+ * @warning This is not realtime-safe and must not be called concurrently with
+ *   convolve() or any of the *_part() functions.
+ **/
+size_t
+OutputBase::split(size_t parts, size_t min_partitions)
 {
-  // see http://www.ludd.luth.se/~torger/brutefir.html#bruteconv_4
-
-  auto d1s = _output_buffer[0] + signal[0] * filter[0];
-  auto d2s = _output_buffer[4] + signal[4] * filter[4];
-
-  for (size_t nn = 0; nn < _partition_size; nn += 8)
+  // In two-stage mode, only the head is split
+  auto total = _head_partitions;
+  parts = std::min(parts, total / std::max(min_partitions, size_t(1)));
+  parts = std::max(parts, size_t(1));
+
+  std::vector<internal::spectrum_accumulator> accumulators;
+  accumulators.reserve(parts);
+  for (size_t part = 0; part < parts; ++part)
   {
-    // real parts
-    _output_buffer[nn+0] += signal[nn+0] * filter[nn + 0] -
-                            signal[nn+4] * filter[nn + 4];
-    _output_buffer[nn+1] += signal[nn+1] * filter[nn + 1] -
-                            signal[nn+5] * filter[nn + 5];
-    _output_buffer[nn+2] += signal[nn+2] * filter[nn + 2] -
-                            signal[nn+6] * filter[nn + 6];
-    _output_buffer[nn+3] += signal[nn+3] * filter[nn + 3] -
-                            signal[nn+7] * filter[nn + 7];
-
-    // imaginary parts
-    _output_buffer[nn+4] += signal[nn+0] * filter[nn + 4] +
-                            signal[nn+4] * filter[nn + 0];
-    _output_buffer[nn+5] += signal[nn+1] * filter[nn + 5] +
-                            signal[nn+5] * filter[nn + 1];
-    _output_buffer[nn+6] += signal[nn+2] * filter[nn + 6] +
-                            signal[nn+6] * filter[nn + 2];
-    _output_buffer[nn+7] += signal[nn+3] * filter[nn + 7] +
-                            signal[nn+7] * filter[nn + 3];
+    accumulators.emplace_back(part * total / parts, (part + 1) * total / parts);
+  }
 
-  } // for
+  std::vector<fft_node> partials;
+  partials.reserve(parts - 1);
+  for (size_t part = 1; part < parts; ++part)
+  {
+    partials.emplace_back(_partition_size);
+  }
 
-  _output_buffer[0] = d1s;
-  _output_buffer[4] = d2s;
+  _accumulators.swap(accumulators);
+  _partials.swap(partials);
+  return parts;
 }
 
-#ifdef __SSE__
-void
-OutputBase::_multiply_partition_simd(const float* signal, const float* filter)
+/** Two-stage convolution: compute the tail partitions in the background.
+ * Only the first @p head_partitions partitions (the "head") are computed in
+ * the audio thread, by convolve() or by the steps of a split convolution.
+ * The remaining partitions (the "tail") only need input blocks which are
+ * at least @p head_partitions blocks old.  Therefore, at the end of each
+ * block, the tail of the next block is handed to a background thread, which
+ * has a whole block period to compute it.  finish() adds the tail to the
+ * head, if it isn't ready, it is computed in the audio thread instead.
+ * If the tail filter partitions are changed after finish() (e.g. by
+ * Output::set_filter() before the next Output::rotate_queues()), the tail of
+ * the following block is computed in the audio thread, too.
+ *
+ * @param head_partitions number of partitions to be computed in the audio
+ *   thread (at least 1).  If this is not less than partitions(), the
+ *   two-stage mode is switched off.
+ * @param priority Scheduling priority of the background thread, which is
+ *   set explicitly (regardless of the priority of the calling thread).
+ *   0 means a normal non-realtime thread, a positive value is a realtime
+ *   (@c SCHED_FIFO) priority, which should be lower than the one of the
+ *   audio thread.  See set_thread_priority(), if it fails, the background
+ *   thread keeps the priority of the calling thread.
+ * @return number of tail partitions, 0 means no two-stage mode.
+ * @note The background thread uses its own copies of the input spectra of
+ *   the tail partitions, which needs as much memory as the tail of the
+ *   Input.
+ * @warning This is not realtime-safe and must not be called concurrently with
+ *   convolve() or any of the *_part() functions.  The number of parts of a
+ *   split convolution is kept (if there are enough head partitions).
+ **/
+size_t
+OutputBase::two_stage(size_t head_partitions, int priority)
 {
-  // 16 byte alignment is needed for _mm_load_ps()!
-  // This should be the case anyway because fftwf_malloc() is used.
+  assert(head_partitions > 0);
+  head_partitions = std::max(head_partitions, size_t(1));
 
-  auto dc = _output_buffer[0] + signal[0] * filter[0];
-  auto ny = _output_buffer[4] + signal[4] * filter[4];
-
-  for(size_t i = 0; i < _partition_size; i += 8)
+  _tail.reset();
+  _head_partitions = std::min(head_partitions, this->partitions());
+  if (_head_partitions < this->partitions())
   {
-    // load real and imaginary parts of signal and filter
-    __m128 sigr = _mm_load_ps(signal + i);
-    __m128 sigi = _mm_load_ps(signal + i + 4);
-    __m128 filtr = _mm_load_ps(filter + i);
-    __m128 filti = _mm_load_ps(filter + i + 4);
-
-    // multiply and subtract
-    __m128 res1 = _mm_sub_ps(_mm_mul_ps(sigr, filtr), _mm_mul_ps(sigi, filti));
-
-    // multiply and add
-    __m128 res2 = _mm_add_ps(_mm_mul_ps(sigr, filti), _mm_mul_ps(sigi, filtr));
-
-    // load output data for accumulation
-    __m128 acc1 = _mm_load_ps(&_output_buffer[i]);
-    __m128 acc2 = _mm_load_ps(&_output_buffer[i + 4]);
-
-    // accumulate
-    acc1 = _mm_add_ps(acc1, res1);
-    acc2 = _mm_add_ps(acc2, res2);
+    // The copies of the spectra are placed like the original ones
+    _tail.reset(new internal::tail_stage(_head_partitions, this->partitions()
+          , this->partitions(), _partition_size, priority
+          , _input.spectra.numa_node()));
+  }
+  this->split(this->parts());
+  return this->partitions() - _head_partitions;
+}
 
-    // store output data
-    _mm_store_ps(&_output_buffer[i], acc1);
-    _mm_store_ps(&_output_buffer[i + 4], acc2);
+/** Number of partitions which were multiplied in the last block.
+ * Partitions are skipped if either the input or the filter partition is zero
+ * (see also Filter::truncate()).  In two-stage mode, only the head partitions
+ * are counted.
+ * @note Call this in the audio thread, after convolve() or multiply_part().
+ **/
+size_t
+OutputBase::active_partitions() const
+{
+  size_t result = 0;
+  for (const auto& accumulator: _accumulators)
+  {
+    result += accumulator.active_partitions();
   }
+  return result;
+}
+
+/// Complex multiplication of input and filter spectra of one part.
+/// The parts can be processed concurrently.
+void
+OutputBase::multiply_part(size_t part)
+{
+  assert(part < this->parts());
+  assert(_filter_ptrs.size() == _input.partitions());
 
-  _output_buffer[0] = dc;
-  _output_buffer[4] = ny;
+  _accumulators[part](_input.spectra, _filter_ptrs
+      , part == 0 ? _output_buffer : _partials[part - 1]);
 }
-#endif
 
-/// Complex multiplication of input and filter spectra
+/// Sum one range of coefficients of all partial spectra.
+/// All parts must have been multiplied before, the parts can be reduced
+/// concurrently.
 void
-OutputBase::_multiply_spectra()
+OutputBase::reduce_part(size_t part)
 {
-  // Clear IFFT buffer (must be actually filled with zeros!)
-  std::fill(_output_buffer.begin(), _output_buffer.end(), 0.0f);
-  _output_buffer.zero = true;
+  assert(part < this->parts());
 
-  assert(_filter_ptrs.size() == _input.partitions());
+  if (_partials.empty()) return;
 
-  auto input = _input.spectra.begin();
+  // Ranges are multiples of 8 to keep the SIMD alignment
+  auto groups = _partition_size / 8;
+  auto begin = part * groups / this->parts() * 8;
+  auto end = (part + 1) * groups / this->parts() * 8;
 
-  for (const auto* filter: _filter_ptrs)
+  float* out = _output_buffer.data();
+  for (const auto& partial: _partials)
   {
-    assert(filter != nullptr);
+    if (partial.zero) continue;
 
-    if (input->zero || filter->zero)
+    const float* in = partial.data();
+    for (size_t i = begin; i < end; ++i)
     {
-      // do nothing. There is no contribution if either is zero.
+      out[i] += in[i];
     }
-    else
+  }
+}
+
+/** Last step of convolve(), to be called after reduce_part().
+ * @param weight amplitude weighting factor for current audio block.
+ * @return pointer to the first sample of the convolved (and weighted) signal
+ **/
+float*
+OutputBase::finish(float weight)
+{
+  for (const auto& partial: _partials)
+  {
+    if (!partial.zero) _output_buffer.zero = false;
+  }
+
+  if (_tail)
+  {
+    const auto& tail = _tail->collect(_input.spectra, _filter_ptrs);
+    if (!tail.zero)
     {
-#ifdef __SSE__
-      _multiply_partition_simd(input->data(), filter->data());
-#else
-      _multiply_partition_cpp(input->data(), filter->data());
-#endif
+      // _output_buffer is actually filled with zeros, see multiply_part()
+      std::transform(tail.begin(), tail.end(), _output_buffer.begin()
+          , _output_buffer.begin(), std::plus<float>());
       _output_buffer.zero = false;
     }
-    ++input;
+
+    this->_get_upcoming_filters(_tail->upcoming_filters());
+    _tail->dispatch(_input.spectra);
   }
-}
 
-void
-OutputBase::_unsort_coefficients()
-{
-  fixed_vector<float> buffer(_partition_size);
+  auto offset = static_cast<fft_node::difference_type>(_input.block_size());
 
-  size_t base = 8;
+  // The first half will be discarded
+  auto second_half = make_begin_and_end(
+      _output_buffer.begin() + offset, _output_buffer.end());
 
-  buffer[0]                 = _output_buffer[0];
-  buffer[1]                 = _output_buffer[1];
-  buffer[2]                 = _output_buffer[2];
-  buffer[3]                 = _output_buffer[3];
-  buffer[_input.block_size()] = _output_buffer[4];
-  buffer[_partition_size-1] = _output_buffer[5];
-  buffer[_partition_size-2] = _output_buffer[6];
-  buffer[_partition_size-3] = _output_buffer[7];
+  assert(std::distance(second_half.begin(), second_half.end()) == offset);
 
-  for (size_t i=0; i < (_partition_size / 8-1); i++)
+  if (_output_buffer.zero)
   {
-    for (size_t ii = 0; ii < 4; ii++)
-    {
-      buffer[base/2+ii] = _output_buffer[base+ii];
-    }
+    // Nothing to be done, IFFT of zero is also zero.
+    // _output_buffer was already reset to zero in multiply_part().
+  }
+  else
+  {
+    _ifft_plan(_output_buffer.data());
 
-    for (size_t ii = 0; ii < 4; ii++)
+    // normalize buffer (the IFFT does not do this)
+    const auto norm = weight / float(_partition_size);
+    for (auto& x: second_half)
     {
-      buffer[_partition_size-base/2-ii] = _output_buffer[base+4+ii];
+      x *= norm;
     }
-
-    base += 8;
   }
-
-  std::copy(buffer.begin(), buffer.end(), _output_buffer.begin());
-}
-
-void
-OutputBase::_ifft()
-{
-  _unsort_coefficients();
-  fftw<float>::execute(_ifft_plan);
+  return &second_half[0];
 }
 
 /** Convolution engine (output part).
@@ -636,8 +1717,7 @@ class Output : public OutputBase
   public:
     Output(const Input& input)
       : OutputBase(input)
-      , _queues(apf::make_index_iterator(size_t(1))
-              , apf::make_index_iterator(input.partitions()))
+      , _pending(input.partitions() - 1)
     {}
 
     void set_filter(const Filter& filter);
@@ -646,7 +1726,16 @@ class Output : public OutputBase
     void rotate_queues();
 
   private:
-    fixed_vector<filter_ptrs_t> _queues;
+    void _get_upcoming_filters(filter_ptrs_t& upcoming) const override;
+    size_t _update_filter_ptrs(size_t blocks, filter_ptrs_t& ptrs) const;
+
+    /// Filters whose partitions are not yet all in use.
+    /// This is a ring buffer indexed by _blocks, a filter stays in its slot
+    /// until its last partition is used (which is when the slot is needed
+    /// again).
+    fixed_vector<const Filter*> _pending;
+    size_t _pending_filters = 0;  ///< Number of non-null entries in _pending
+    size_t _blocks = 0;  ///< Number of calls to rotate_queues()
 };
 
 /** Set a new filter.
@@ -654,23 +1743,23 @@ class Output : public OutputBase
  * updated with rotate_queues().
  * @param filter Container with filter partitions. If too few partitions are
  *   given, the rest is set to zero, if too many are given, the rest is ignored.
+ * @attention The filter coefficients are not copied, their lifetime must
+ *   exceed the time until the last partition is used (i.e. partitions() - 1
+ *   calls to rotate_queues()).
  **/
 void
 Output::set_filter(const Filter& filter)
 {
-  auto partition = filter.begin();
-
   // First partition has no queue and is updated immediately
-  if (partition != filter.end())
-  {
-    _filter_ptrs.front() = &*partition++;
-  }
+  _filter_ptrs.front() = filter.partitions() > 0
+    ? &filter.front() : &_empty_partition;
 
-  for (size_t i = 0; i < _queues.size(); ++i)
-  {
-    _queues[i][i]
-      = (partition == filter.end()) ? &_empty_partition : &*partition++;
-  }
+  if (_pending.empty()) return;
+
+  // A previous filter set in the same block is overwritten
+  auto& slot = _pending[_blocks % _pending.size()];
+  if (!slot) ++_pending_filters;
+  slot = &filter;
 }
 
 /** Check if there are still valid partitions in the queues.
@@ -682,36 +1771,64 @@ Output::set_filter(const Filter& filter)
 bool
 Output::queues_empty() const
 {
-  if (_queues.empty()) return true;
-
-  // It may not be obvious, but that's what the following code does:
-  // If some non-null pointer is found in the last queue, return false
-
-  auto first = _queues.rbegin()->begin();
-  auto last  = _queues.rbegin()->end();
-  return std::find_if(first, last, math::identity<const fft_node*>()) == last;
+  return _pending_filters == 0;
 }
 
 /** Update filter queues.
  * If queues_empty() returns @b true, calling this function is unnecessary.
+ * Each pending filter updates one partition, therefore this takes at most
+ * O(partitions()) time.
  * @note This can lead to artifacts, so a crossfade is recommended.
  **/
 void
 Output::rotate_queues()
 {
-  auto target = _filter_ptrs.begin();
-  // Skip first element, it doesn't have a queue
-  ++target;
+  ++_blocks;
+  if (_pending_filters == 0) return;
+
+  // Filters whose partitions are all in use now are removed
+  auto slot = _update_filter_ptrs(_blocks, _filter_ptrs);
+  if (slot < _pending.size())
+  {
+    _pending[slot] = nullptr;
+    --_pending_filters;
+  }
+}
 
-  for (auto& queue: _queues)
+/** Update the partitions of all pending filters.
+ * @param blocks number of calls to rotate_queues()
+ * @param ptrs filter partitions to be updated
+ * @return slot of the filter whose last partition was updated (or the number
+ *   of slots if there is none)
+ **/
+size_t
+Output::_update_filter_ptrs(size_t blocks, filter_ptrs_t& ptrs) const
+{
+  const auto slots = _pending.size();
+  auto finished = slots;
+  for (size_t i = 0; i < slots; ++i)
   {
-    // If first element is valid, use it
-    if (queue.front()) *target = queue.front();
+    const auto* filter = _pending[i];
+    if (!filter) continue;
+
+    // Number of blocks since set_filter(), between 1 and slots
+    auto age = (blocks % slots + slots - i) % slots;
+    if (age == 0) age = slots;
 
-    std::copy(queue.begin() + 1, queue.end(), queue.begin());
-    *queue.rbegin() = nullptr;
-    ++target;
+    ptrs[age] = age < filter->partitions()
+      ? &(*filter)[age] : &_empty_partition;
+
+    if (age == slots) finished = i;
   }
+  return finished;
+}
+
+/// The next call to rotate_queues() is anticipated.
+void
+Output::_get_upcoming_filters(filter_ptrs_t& upcoming) const
+{
+  OutputBase::_get_upcoming_filters(upcoming);
+  if (_pending_filters > 0) _update_filter_ptrs(_blocks + 1, upcoming);
 }
 
 /** %Convolver output stage with static filter.
@@ -761,8 +1878,9 @@ class StaticOutput : public OutputBase
 /// Combination of Input and Output
 struct Convolver : Input, Output
 {
-  Convolver(size_t block_size_, size_t partitions_)
-    : Input(block_size_, partitions_)
+  /// @param numa_node see Input
+  Convolver(size_t block_size_, size_t partitions_, int numa_node = -1)
+    : Input(block_size_, partitions_, numa_node)
     // static_cast to resolve ambiguity
     , Output(*static_cast<Input*>(this))
   {}
@@ -772,21 +1890,183 @@ struct Convolver : Input, Output
 struct StaticConvolver : Input, StaticOutput
 {
   template<typename In>
-  StaticConvolver(size_t block_size_, In first, In last, size_t partitions_ = 0)
+  StaticConvolver(size_t block_size_, In first, In last, size_t partitions_ = 0
+      , int numa_node = -1)
     : Input(block_size_, partitions_ ? partitions_
-        : min_partitions(block_size_, size_t(std::distance(first, last))))
+        : min_partitions(block_size_, size_t(std::distance(first, last)))
+        , numa_node)
     , StaticOutput(*this, first, last)
   {
     assert(std::distance(first, last) > 0);
   }
 
-  StaticConvolver(const Filter& filter, size_t partitions_ = 0)
-    : Input(filter.block_size()
-        , partitions_ ? partitions_ : filter.partitions())
+  /// @param filter Filter partitions, see StaticOutput
+  /// @param partitions_ Number of partitions, 0 means
+  ///   Filter::effective_partitions(), i.e. trailing partitions which are
+  ///   zero (e.g. because of Filter::truncate()) are not used at all.
+  /// @param numa_node see Input
+  StaticConvolver(const Filter& filter, size_t partitions_ = 0
+      , int numa_node = -1)
+    : Input(filter.block_size(), partitions_ ? partitions_
+        : std::max(filter.effective_partitions(), size_t(1)), numa_node)
     , StaticOutput(*this, filter)
   {}
 };
 
+/** Filters for a set of directions, e.g. a large set of HRTFs or BRIRs.
+ * All filters are prepared once (in the constructor) and can be shared by any
+ * number of Output%s, see Output::set_filter().
+ * The lookup functions are realtime-safe, see DirectionIndex.
+ * @attention The FilterDatabase must outlive all Output%s using its filters!
+ **/
+class FilterDatabase
+{
+  public:
+    using vector_t = DirectionIndex::vector_t;
+
+    /// Filter and its weight, see weights()
+    using weight_t = std::pair<const Filter*, float>;
+    using weights_t = std::array<weight_t, 3>;
+
+    template<typename DirIn, typename IrIn>
+    FilterDatabase(size_t block_size_, DirIn first, DirIn last
+        , IrIn ir_first, size_t partitions_ = 0);
+
+    size_t size() const { return _filters.size(); }
+    size_t block_size() const { return _filters.front().block_size(); }
+    size_t partitions() const { return _filters.front().partitions(); }
+
+    /// Filter number @p n, in the order given to the constructor
+    const Filter& operator[](size_t n) const { return _filters[n]; }
+
+    const DirectionIndex& index() const { return _index; }
+
+    /// Filter of the direction nearest to @p direction
+    const Filter& nearest(const vector_t& direction) const
+    {
+      return _filters[_index.nearest(direction)];
+    }
+
+    weights_t weights(const vector_t& direction) const;
+    void interpolate(const vector_t& direction, Filter& result) const;
+
+  private:
+    template<typename IrIn>
+    static size_t _max_partitions(size_t block_size_, IrIn first, size_t n);
+
+    DirectionIndex _index;
+    fixed_vector<Filter> _filters;
+};
+
+/** Constructor.
+ * @param block_size_ Block size
+ * @param first Iterator to the first direction, see DirectionIndex
+ * @param last Past-the-end iterator
+ * @param ir_first Iterator to the impulse response of the first direction.
+ *   Each impulse response is a container of time-domain coefficients, there
+ *   must be one for each direction.
+ * @param partitions_ Number of partitions of each filter.  If 0, the longest
+ *   impulse response is used.
+ **/
+template<typename DirIn, typename IrIn>
+FilterDatabase::FilterDatabase(size_t block_size_, DirIn first, DirIn last
+    , IrIn ir_first, size_t partitions_)
+  : _index(first, last)
+  , _filters(_index.size(), block_size_, partitions_ ? partitions_
+      : _max_partitions(block_size_, ir_first, _index.size()))
+{
+  // One FFT plan for all filters
+  Transform transform(block_size_);
+  for (auto& filter: _filters)
+  {
+    transform.prepare_filter(ir_first->begin(), ir_first->end(), filter);
+    ++ir_first;
+  }
+}
+
+template<typename IrIn>
+size_t
+FilterDatabase::_max_partitions(size_t block_size_, IrIn first, size_t n)
+{
+  size_t result = 1;
+  for (size_t i = 0; i < n; ++i, ++first)
+  {
+    result = std::max(result, min_partitions(block_size_
+          , size_t(std::distance(first->begin(), first->end()))));
+  }
+  return result;
+}
+
+/// Three filters surrounding @p direction and their weights (which sum up to
+/// 1), e.g. for crossfading between three Output%s.
+/// @see DirectionIndex::weights()
+FilterDatabase::weights_t
+FilterDatabase::weights(const vector_t& direction) const
+{
+  auto w = _index.weights(direction);
+  weights_t result;
+  for (size_t i = 0; i < 3; ++i)
+  {
+    result[i] = { &_filters[w[i].first], w[i].second };
+  }
+  return result;
+}
+
+/** Weighted sum of the three filters surrounding @p direction.
+ * This is done in the frequency domain, without memory allocation.
+ *
+ * @p result is overwritten in place.  If it is in use by an Output, its
+ * partitions change immediately instead of one per block (see
+ * Output::set_filter()), which causes clicks.  For a moving source, use two
+ * Filter%s alternately, e.g.:
+ *                                                                     @code
+ * if (output.queues_empty())
+ * {
+ *   db.interpolate(direction, *spare);
+ *   output.set_filter(*spare);
+ *   std::swap(spare, current);
+ * }
+ *                                                                  @endcode
+ * @param direction Direction, see weights()
+ * @param[out] result Filter with the same block size and number of
+ *   partitions as the database
+ * @attention @p result must not be in use by an Output: After it was passed
+ *   to Output::set_filter(), it can only be re-used once another filter was
+ *   set and queues_empty() is @b true again.
+ **/
+void
+FilterDatabase::interpolate(const vector_t& direction, Filter& result) const
+{
+  assert(result.partition_size() == _filters.front().partition_size());
+  assert(result.partitions() == this->partitions());
+
+  auto w = this->weights(direction);
+
+  for (size_t p = 0; p < result.partitions(); ++p)
+  {
+    auto& out = result[p];
+    out.zero = true;
+    for (const auto& item: w)
+    {
+      const auto& in = (*item.first)[p];
+      if (in.zero || item.second == 0.0f) continue;
+
+      auto weight = item.second;
+      if (out.zero)
+      {
+        std::transform(in.begin(), in.end(), out.begin()
+            , [weight](float x) { return weight * x; });
+        out.zero = false;
+      }
+      else
+      {
+        std::transform(in.begin(), in.end(), out.begin(), out.begin()
+            , [weight](float x, float y) { return y + weight * x; });
+      }
+    }
+  }
+}
+
 /// Apply @c std::transform to a container of fft_node%s
 template<typename BinaryFunction>
 void transform_nested(const Filter& in1, const Filter& in2, Filter& out
@@ -834,6 +2114,8 @@ void transform_nested(const Filter& in1, const Filter& in2, Filter& out
   }
 }
 
+}  // inline namespace builtin_fft_backend/fftw_backend
+
 }  // namespace conv
 
 }  // namespace apf
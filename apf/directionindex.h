@@ -0,0 +1,531 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Spatial index for a set of directions (e.g. of HRTFs).
+
+#ifndef APF_DIRECTIONINDEX_H
+#define APF_DIRECTIONINDEX_H
+
+#include <algorithm>  // for std::nth_element(), std::max_element()
+#include <array>
+#include <cassert>
+#include <cmath>  // for std::sqrt(), std::cos(), std::sin()
+#include <cstdint>  // for uint32_t
+#include <limits>  // for std::numeric_limits
+#include <map>
+#include <stdexcept>  // for std::logic_error
+#include <utility>  // for std::pair
+#include <vector>
+
+namespace apf
+{
+
+/** Index for nearest-neighbour and interpolation queries on directions.
+ * The directions (e.g. of a set of HRTFs) are stored as unit vectors.
+ * Queries are realtime-safe (they don't allocate memory):
+ * - nearest() uses a k-d tree, O(log n)
+ * - weights() returns three directions and their weights for interpolation.
+ *   The directions are triangulated (with their convex hull, which is the
+ *   spherical Delaunay triangulation), the triangle is found by walking from
+ *   the nearest direction, which normally only takes a few steps.
+ *
+ * The constructor is not realtime-safe.
+ **/
+class DirectionIndex
+{
+  public:
+    using vector_t = std::array<float, 3>;
+
+    /// Index and weight of a direction
+    using weight_t = std::pair<size_t, float>;
+    using weights_t = std::array<weight_t, 3>;
+
+    /// Unit vector pointing to @p azimuth, measured counterclockwise from the
+    /// x-axis, and @p elevation, measured from the x-y-plane (in degrees).
+    static vector_t from_degrees(float azimuth, float elevation)
+    {
+      const float deg2rad = 3.14159265358979323846f / 180.0f;
+      azimuth *= deg2rad;
+      elevation *= deg2rad;
+      return { std::cos(elevation) * std::cos(azimuth)
+        , std::cos(elevation) * std::sin(azimuth), std::sin(elevation) };
+    }
+
+    template<typename In>
+    DirectionIndex(In first, In last);
+
+    size_t size() const { return _directions.size(); }
+
+    /// Direction @p n (normalized), in the order given to the constructor.
+    const vector_t& operator[](size_t n) const { return _directions[n]; }
+
+    /// Number of triangles, 0 if no triangulation was possible.
+    size_t triangles() const { return _triangles.size(); }
+
+    size_t nearest(vector_t direction) const;
+    weights_t weights(vector_t direction) const;
+
+  private:
+    using triangle_t = std::array<size_t, 3>;
+
+    static constexpr size_t _none = std::numeric_limits<size_t>::max();
+
+    static bool _normalize(vector_t& v);
+    static float _det(const vector_t& a, const vector_t& b, const vector_t& c);
+
+    void _build_tree(size_t begin, size_t end);
+    void _nearest(size_t begin, size_t end, const vector_t& direction
+        , size_t& best, float& best_distance) const;
+    void _first_within(size_t begin, size_t end, const vector_t& direction
+        , float distance, size_t& first) const;
+    void _triangulate();
+
+    std::vector<vector_t> _directions;
+
+    /// k-d tree: each node is the middle of a range of _order, the left and
+    /// right halves of the range are its children.
+    std::vector<size_t> _order;
+    std::vector<unsigned char> _axis;  ///< Splitting axis of each node
+
+    std::vector<triangle_t> _triangles;  ///< counterclockwise seen from outside
+    /// Neighbour triangle opposite of each vertex.
+    std::vector<triangle_t> _neighbors;
+    std::vector<size_t> _vertex_triangle;  ///< One triangle per direction
+};
+
+/** Constructor.
+ * @param first Iterator to the first direction (a @c vector_t or anything
+ *   with @c operator[] for x, y and z), it doesn't have to be normalized.
+ * @param last Past-the-end iterator
+ * @throw std::logic_error if there are no directions or if one of them is
+ *   a zero vector.
+ **/
+template<typename In>
+DirectionIndex::DirectionIndex(In first, In last)
+{
+  for (; first != last; ++first)
+  {
+    vector_t v{ float((*first)[0]), float((*first)[1]), float((*first)[2]) };
+    if (!_normalize(v))
+    {
+      throw std::logic_error("DirectionIndex: zero vector!");
+    }
+    _directions.push_back(v);
+  }
+  if (_directions.empty())
+  {
+    throw std::logic_error("DirectionIndex: no directions given!");
+  }
+
+  _order.resize(this->size());
+  _axis.resize(this->size());
+  for (size_t i = 0; i < this->size(); ++i) _order[i] = i;
+  _build_tree(0, this->size());
+
+  _triangulate();
+}
+
+inline bool
+DirectionIndex::_normalize(vector_t& v)
+{
+  float norm = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (norm == 0.0f) return false;
+  for (auto& x: v) x /= norm;
+  return true;
+}
+
+/// Determinant of the 3x3 matrix with the columns @p a, @p b and @p c.
+inline float
+DirectionIndex::_det(const vector_t& a, const vector_t& b, const vector_t& c)
+{
+  return a[0] * (b[1] * c[2] - b[2] * c[1])
+       + a[1] * (b[2] * c[0] - b[0] * c[2])
+       + a[2] * (b[0] * c[1] - b[1] * c[0]);
+}
+
+/// Balanced k-d tree, split along the axis with the largest extent.
+inline void
+DirectionIndex::_build_tree(size_t begin, size_t end)
+{
+  if (end - begin < 2) return;
+
+  vector_t low = _directions[_order[begin]], high = low;
+  for (size_t i = begin; i < end; ++i)
+  {
+    for (size_t k = 0; k < 3; ++k)
+    {
+      low[k] = std::min(low[k], _directions[_order[i]][k]);
+      high[k] = std::max(high[k], _directions[_order[i]][k]);
+    }
+  }
+  size_t axis = 0;
+  for (size_t k = 1; k < 3; ++k)
+  {
+    if (high[k] - low[k] > high[axis] - low[axis]) axis = k;
+  }
+
+  auto middle = begin + (end - begin) / 2;
+  auto first = _order.begin() + static_cast<std::ptrdiff_t>(begin);
+  std::nth_element(first, _order.begin() + static_cast<std::ptrdiff_t>(middle)
+      , _order.begin() + static_cast<std::ptrdiff_t>(end)
+      , [this, axis](size_t a, size_t b)
+      {
+        return _directions[a][axis] < _directions[b][axis];
+      });
+  _axis[middle] = static_cast<unsigned char>(axis);
+
+  _build_tree(begin, middle);
+  _build_tree(middle + 1, end);
+}
+
+/// Index of the nearest direction (with the largest dot product).
+inline size_t
+DirectionIndex::nearest(vector_t direction) const
+{
+  // On the unit sphere, the nearest point also has the smallest distance
+  if (!_normalize(direction)) return 0;
+  size_t best = _none;
+  float best_distance = std::numeric_limits<float>::max();
+  _nearest(0, this->size(), direction, best, best_distance);
+  assert(best != _none);
+  return best;
+}
+
+inline void
+DirectionIndex::_nearest(size_t begin, size_t end, const vector_t& direction
+    , size_t& best, float& best_distance) const
+{
+  if (begin >= end) return;
+
+  auto middle = begin + (end - begin) / 2;
+  const auto& point = _directions[_order[middle]];
+
+  float distance = 0.0f;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    distance += (point[k] - direction[k]) * (point[k] - direction[k]);
+  }
+  if (distance < best_distance)
+  {
+    best_distance = distance;
+    best = _order[middle];
+  }
+
+  auto axis = _axis[middle];
+  auto difference = direction[axis] - point[axis];
+  if (difference < 0.0f)
+  {
+    _nearest(begin, middle, direction, best, best_distance);
+    if (difference * difference < best_distance)
+    {
+      _nearest(middle + 1, end, direction, best, best_distance);
+    }
+  }
+  else
+  {
+    _nearest(middle + 1, end, direction, best, best_distance);
+    if (difference * difference < best_distance)
+    {
+      _nearest(begin, middle, direction, best, best_distance);
+    }
+  }
+}
+
+/// Smallest index of the directions with a squared distance of at most
+/// @p distance from @p direction.
+inline void
+DirectionIndex::_first_within(size_t begin, size_t end
+    , const vector_t& direction, float distance, size_t& first) const
+{
+  if (begin >= end) return;
+
+  auto middle = begin + (end - begin) / 2;
+  const auto& point = _directions[_order[middle]];
+
+  float d = 0.0f;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    d += (point[k] - direction[k]) * (point[k] - direction[k]);
+  }
+  if (d <= distance) first = std::min(first, _order[middle]);
+
+  auto difference = direction[_axis[middle]] - point[_axis[middle]];
+  if (difference <= 0.0f || difference * difference <= distance)
+  {
+    _first_within(begin, middle, direction, distance, first);
+  }
+  if (difference >= 0.0f || difference * difference <= distance)
+  {
+    _first_within(middle + 1, end, direction, distance, first);
+  }
+}
+
+/** Three directions surrounding @p direction with their weights.
+ * The weights are the barycentric coordinates of the intersection of the ray
+ * along @p direction with the triangle, they are non-negative and sum up to 1.
+ * If no triangle is found (e.g. if all directions are within a hemisphere
+ * and @p direction points to the other side), the nearest direction is
+ * returned with weight 1 (and the other two with weight 0).
+ **/
+inline DirectionIndex::weights_t
+DirectionIndex::weights(vector_t direction) const
+{
+  auto nearest_ = this->nearest(direction);
+  weights_t fallback{{ { nearest_, 1.0f }, { nearest_, 0.0f }
+    , { nearest_, 0.0f } }};
+
+  if (_triangles.empty() || !_normalize(direction)) return fallback;
+
+  auto t = _vertex_triangle[nearest_];
+  if (t == _none) t = 0;
+
+  // Walk towards the triangle containing the direction.  On the hull of a
+  // point set surrounding the origin, this terminates.  The number of steps
+  // is limited anyway, in case of rounding errors.
+  for (size_t step = 0; step < _triangles.size(); ++step)
+  {
+    const auto& tri = _triangles[t];
+    const auto& a = _directions[tri[0]];
+    const auto& b = _directions[tri[1]];
+    const auto& c = _directions[tri[2]];
+
+    if (_det(a, b, c) <= 0.0f) break;  // origin is not inside
+
+    std::array<float, 3> w{{ _det(direction, b, c), _det(a, direction, c)
+      , _det(a, b, direction) }};
+    auto min = std::min_element(w.begin(), w.end());
+    if (*min >= -1e-6f)
+    {
+      for (auto& x: w) x = std::max(x, 0.0f);
+      float sum = w[0] + w[1] + w[2];
+      if (sum <= 0.0f) break;
+      return {{ { tri[0], w[0] / sum }, { tri[1], w[1] / sum }
+        , { tri[2], w[2] / sum } }};
+    }
+    t = _neighbors[t][size_t(min - w.begin())];
+  }
+  return fallback;
+}
+
+/** Incremental convex hull.
+ * Directions which are exactly coplanar (e.g. on a circle of equal
+ * elevation) would lead to ambiguous triangulations, therefore the hull is
+ * computed from slightly perturbed directions.
+ * (Almost) identical directions (e.g. several azimuths at the poles) are
+ * only triangulated once.
+ * Visible faces are found by flood fill from a face which was added recently,
+ * which is fast for the usual direction sets (worst case O(n^2)).
+ **/
+inline void
+DirectionIndex::_triangulate()
+{
+  const size_t n = this->size();
+  _vertex_triangle.assign(n, size_t(_none));
+
+  // Index of the first of (almost) identical directions
+  std::vector<size_t> same(n);
+  size_t unique = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t first = i;
+    _first_within(0, n, _directions[i], 1e-10f, first);
+    same[i] = (first == i) ? i : same[first];
+    if (same[i] == i) ++unique;
+  }
+  if (unique < 4) return;
+
+  using point_t = std::array<double, 3>;
+  std::vector<point_t> p(n);
+  uint32_t random = 12345;
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t k = 0; k < 3; ++k)
+    {
+      random = random * 1664525u + 1013904223u;  // LCG
+      p[i][k] = double(_directions[i][k])
+        + 1e-7 * (double(random) / 4294967296.0 - 0.5);
+    }
+  }
+
+  auto sub = [](const point_t& a, const point_t& b)
+  {
+    return point_t{{ a[0] - b[0], a[1] - b[1], a[2] - b[2] }};
+  };
+  auto cross = [](const point_t& a, const point_t& b)
+  {
+    return point_t{{ a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2]
+      , a[0] * b[1] - a[1] * b[0] }};
+  };
+  auto dot = [](const point_t& a, const point_t& b)
+  {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  };
+  // positive if d is above the plane a, b, c (counterclockwise from above)
+  auto orientation = [&](size_t a, size_t b, size_t c, size_t d)
+  {
+    return dot(cross(sub(p[b], p[a]), sub(p[c], p[a])), sub(p[d], p[a]));
+  };
+
+  // Initial tetrahedron
+  size_t i0 = 0, i1 = 0, i2 = 0, i3 = 0;
+  double best = 0.0;
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (same[i] != i) continue;
+    auto d = sub(p[i], p[i0]);
+    if (dot(d, d) > best) { best = dot(d, d); i1 = i; }
+  }
+  best = 0.0;
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (same[i] != i) continue;
+    auto c = cross(sub(p[i1], p[i0]), sub(p[i], p[i0]));
+    if (dot(c, c) > best) { best = dot(c, c); i2 = i; }
+  }
+  best = 0.0;
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (same[i] != i) continue;
+    auto o = std::abs(orientation(i0, i1, i2, i));
+    if (o > best) { best = o; i3 = i; }
+  }
+  if (best < 1e-12) return;  // all directions are (almost) in one plane
+  if (orientation(i0, i1, i2, i3) > 0) std::swap(i1, i2);
+
+  std::vector<triangle_t> faces;
+  std::vector<bool> alive;
+  std::map<std::pair<size_t, size_t>, size_t> edges;  // directed edge -> face
+
+  auto add_face = [&](size_t a, size_t b, size_t c)
+  {
+    faces.push_back({{ a, b, c }});
+    alive.push_back(true);
+    edges[{a, b}] = faces.size() - 1;
+    edges[{b, c}] = faces.size() - 1;
+    edges[{c, a}] = faces.size() - 1;
+  };
+  // all faces counterclockwise seen from outside
+  add_face(i0, i1, i2);
+  add_face(i0, i3, i1);
+  add_face(i1, i3, i2);
+  add_face(i2, i3, i0);
+
+  auto sees = [&](size_t f, size_t i)
+  {
+    return orientation(faces[f][0], faces[f][1], faces[f][2], i) > 1e-15;
+  };
+
+  std::vector<bool> visible;
+  std::vector<size_t> visible_faces;
+  std::vector<std::pair<size_t, size_t>> horizon;
+  size_t recent = 0;  // first face added for the previous direction
+
+  // The k-d tree order is spatially coherent, therefore one of the faces
+  // added for the previous direction is normally visible from the next one.
+  for (auto i: _order)
+  {
+    if (same[i] != i || i == i0 || i == i1 || i == i2 || i == i3) continue;
+
+    size_t first = _none;
+    for (size_t f = recent; f < faces.size() && first == _none; ++f)
+    {
+      if (alive[f] && sees(f, i)) first = f;
+    }
+    for (size_t f = 0; f < faces.size() && first == _none; ++f)
+    {
+      if (alive[f] && sees(f, i)) first = f;
+    }
+    if (first == _none) continue;  // inside
+
+    // The visible faces are connected
+    visible.resize(faces.size(), false);
+    visible_faces.assign(1, first);
+    visible[first] = true;
+    for (size_t v = 0; v < visible_faces.size(); ++v)
+    {
+      const auto face = faces[visible_faces[v]];
+      for (size_t k = 0; k < 3; ++k)
+      {
+        auto neighbor = edges.at({face[(k + 1) % 3], face[k]});
+        if (!visible[neighbor] && sees(neighbor, i))
+        {
+          visible[neighbor] = true;
+          visible_faces.push_back(neighbor);
+        }
+      }
+    }
+
+    horizon.clear();
+    for (auto f: visible_faces)
+    {
+      for (size_t k = 0; k < 3; ++k)
+      {
+        auto a = faces[f][k], b = faces[f][(k + 1) % 3];
+        if (!visible[edges.at({b, a})]) horizon.emplace_back(a, b);
+      }
+    }
+    for (auto f: visible_faces)
+    {
+      alive[f] = false;
+      for (size_t k = 0; k < 3; ++k)
+      {
+        edges.erase({faces[f][k], faces[f][(k + 1) % 3]});
+      }
+    }
+    recent = faces.size();
+    for (const auto& edge: horizon) add_face(edge.first, edge.second, i);
+  }
+
+  // Compact and connect the remaining faces
+  std::vector<size_t> index(faces.size(), size_t(_none));
+  for (size_t f = 0; f < faces.size(); ++f)
+  {
+    if (!alive[f]) continue;
+    index[f] = _triangles.size();
+    _triangles.push_back(faces[f]);
+  }
+  _neighbors.resize(_triangles.size());
+  for (size_t t = 0; t < _triangles.size(); ++t)
+  {
+    const auto& tri = _triangles[t];
+    for (size_t k = 0; k < 3; ++k)
+    {
+      // edge opposite of vertex k, in reverse direction
+      auto a = tri[(k + 1) % 3], b = tri[(k + 2) % 3];
+      _neighbors[t][k] = index[edges.at({b, a})];
+      _vertex_triangle[tri[k]] = t;
+    }
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    _vertex_triangle[i] = _vertex_triangle[same[i]];
+  }
+}
+
+}  // namespace apf
+
+#endif
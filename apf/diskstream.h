@@ -0,0 +1,305 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Streaming audio data from and to disk in realtime.
+
+#ifndef APF_DISKSTREAM_H
+#define APF_DISKSTREAM_H
+
+#include <algorithm>  // for std::fill(), std::find()
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "apf/lockfreefifo.h"
+#include "apf/threadtools.h"  // for ScopedThread
+#include "apf/interleave.h"  // for deinterleave(), interleave()
+#include "apf/iterator.h"  // for has_begin_and_end
+#include "apf/misc.h"  // for NonCopyable
+
+namespace apf
+{
+
+/** Base class for PlaybackStream and RecordStream.
+ * Blocks of interleaved audio data are passed between the audio thread and
+ * the disk thread (see DiskStreamer) with two LockFreeFifo%s, one for empty
+ * blocks and one for full blocks. The audio thread never waits for the disk.
+ **/
+class DiskStreamBase : NonCopyable
+{
+  public:
+    virtual ~DiskStreamBase() = default;
+
+    /// Do the disk I/O for one block. This is called by the DiskStreamer
+    /// thread (or manually, but never from the audio thread).
+    /// @return @b false if there was nothing to do
+    virtual bool service() = 0;
+
+    size_t channels() const { return _channels; }
+    size_t block_size() const { return _block_size; }
+
+    /// Number of blocks where the audio thread had to skip (playback: output
+    /// silence, recording: drop data) because the disk was too slow.
+    size_t xruns() const { return _xruns.load(std::memory_order_relaxed); }
+
+  protected:
+    struct block
+    {
+      std::vector<float> data;  ///< interleaved
+      size_t frames = 0;  ///< number of valid frames
+    };
+
+    /// @param channels number of channels
+    /// @param block_size audio block size
+    /// @param blocks number of blocks in the ring, e.g. the number of
+    ///   seconds to prefetch * sample rate / @p block_size
+    DiskStreamBase(size_t channels, size_t block_size, size_t blocks)
+      : _channels(channels)
+      , _block_size(block_size)
+      , _blocks(blocks)
+      , _empty(blocks + 1)
+      , _full(blocks + 1)
+      , _buffer(channels * block_size)
+      , _channel_ptrs(channels)
+      , _xruns(0)
+    {
+      for (auto& b: _blocks)
+      {
+        b.data.resize(channels * block_size);
+        _empty.push(&b);
+      }
+      for (size_t c = 0; c < channels; ++c)
+      {
+        _channel_ptrs[c] = _buffer.data() + c * block_size;
+      }
+    }
+
+    has_begin_and_end<float*> _channel(size_t c) const
+    {
+      return has_begin_and_end<float*>(_channel_ptrs[c], _block_size);
+    }
+
+    const size_t _channels;
+    const size_t _block_size;
+    std::vector<block> _blocks;
+    LockFreeFifo<block*> _empty, _full;
+    std::vector<float> _buffer;  ///< non-interleaved, for the audio thread
+    std::vector<float*> _channel_ptrs;
+    std::atomic<size_t> _xruns;
+};
+
+/** Stream an audio file from disk, block by block.
+ * In the audio thread, call process() once per block, afterwards the data is
+ * available with channel().
+ * At the end of the file, silence is played.
+ * @tparam File file type, e.g. @c SndfileHandle. It needs the member function
+ *   <tt>readf(float* ptr, frames)</tt>, which reads interleaved frames and
+ *   returns the number of frames actually read.
+ **/
+template<typename File>
+class PlaybackStream : public DiskStreamBase
+{
+  public:
+    using channel_type = has_begin_and_end<const float*>;
+
+    /// Constructor. The ring of blocks is filled before returning.
+    /// @see DiskStreamBase::DiskStreamBase()
+    PlaybackStream(File file, size_t channels, size_t block_size
+        , size_t blocks)
+      : DiskStreamBase(channels, block_size, blocks)
+      , _file(file)
+      , _end_of_file(false)
+    {
+      while (this->service()) {}
+    }
+
+    /// Get the next block from the ring. This is realtime-safe.
+    void process()
+    {
+      auto b = _full.pop();
+      if (b == nullptr)
+      {
+        std::fill(_buffer.begin(), _buffer.end(), 0.0f);
+        _xruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      deinterleave(b->data.data(), _channels, _block_size
+          , _channel_ptrs.data());
+      _empty.push(b);
+    }
+
+    /// Data of channel @p c of the current block
+    channel_type channel(size_t c) const
+    {
+      return channel_type(_channel_ptrs[c], _block_size);
+    }
+
+    /// @b true if the whole file has been read (but not necessarily played).
+    bool end_of_file() const
+    {
+      return _end_of_file.load(std::memory_order_acquire);
+    }
+
+    bool service() override
+    {
+      auto b = _empty.pop();
+      if (b == nullptr) return false;
+
+      b->frames = 0;
+      if (!_end_of_file.load(std::memory_order_relaxed))
+      {
+        auto frames = _file.readf(b->data.data(), _block_size);
+        b->frames = frames > 0 ? static_cast<size_t>(frames) : 0;
+        if (b->frames < _block_size)
+        {
+          _end_of_file.store(true, std::memory_order_release);
+        }
+      }
+      std::fill(b->data.begin() + static_cast<std::ptrdiff_t>(
+            b->frames * _channels), b->data.end(), 0.0f);
+      _full.push(b);
+      return true;
+    }
+
+  private:
+    File _file;
+    std::atomic<bool> _end_of_file;
+};
+
+/** Record audio data to disk, block by block.
+ * In the audio thread, write the data of each channel to channel() and call
+ * process() once per block.
+ * @tparam File file type, e.g. @c SndfileHandle. It needs the member function
+ *   <tt>writef(const float* ptr, frames)</tt>, which writes interleaved
+ *   frames.
+ * @attention Remove the stream from its DiskStreamer before destroying it.
+ *   Remaining data is written in the destructor.
+ **/
+template<typename File>
+class RecordStream : public DiskStreamBase
+{
+  public:
+    using channel_type = has_begin_and_end<float*>;
+
+    /// Constructor. @see DiskStreamBase::DiskStreamBase()
+    RecordStream(File file, size_t channels, size_t block_size, size_t blocks)
+      : DiskStreamBase(channels, block_size, blocks)
+      , _file(file)
+    {}
+
+    ~RecordStream() { while (this->service()) {} }
+
+    /// Buffer for channel @p c of the current block.
+    channel_type channel(size_t c) { return this->_channel(c); }
+
+    /// Pass the current block to the disk thread. This is realtime-safe.
+    void process()
+    {
+      auto b = _empty.pop();
+      if (b == nullptr)
+      {
+        _xruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      interleave(_channel_ptrs.data(), _channels, _block_size
+          , b->data.data());
+      b->frames = _block_size;
+      _full.push(b);
+    }
+
+    bool service() override
+    {
+      auto b = _full.pop();
+      if (b == nullptr) return false;
+      _file.writef(b->data.data(), b->frames);
+      _empty.push(b);
+      return true;
+    }
+
+  private:
+    File _file;
+};
+
+/** Background thread doing the disk I/O for many streams.
+ * One thread is enough for hundreds of streams, each service() call handles
+ * one block.
+ **/
+class DiskStreamer : NonCopyable
+{
+  public:
+    /// Constructor, starts the thread.
+    /// @param usleeptime time to sleep after all streams are serviced
+    explicit DiskStreamer(int usleeptime = 10000)
+      : _thread(service_all(*this), usleeptime)
+    {}
+
+    /// Add a stream. This is not realtime-safe.
+    void add(DiskStreamBase& stream)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _streams.push_back(&stream);
+    }
+
+    /// Remove a stream. Afterwards, service() is not called anymore.
+    void remove(DiskStreamBase& stream)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = std::find(_streams.begin(), _streams.end(), &stream);
+      if (it != _streams.end()) _streams.erase(it);
+    }
+
+  private:
+    struct service_all
+    {
+      explicit service_all(DiskStreamer& parent) : _parent(parent) {}
+
+      void operator()()
+      {
+        std::lock_guard<std::mutex> lock(_parent._mutex);
+        bool busy = true;
+        // Round-robin, one block per stream, until there is nothing to do
+        while (busy)
+        {
+          busy = false;
+          for (auto stream: _parent._streams)
+          {
+            busy = stream->service() || busy;
+          }
+        }
+      }
+
+      DiskStreamer& _parent;
+    };
+
+    std::mutex _mutex;
+    std::vector<DiskStreamBase*> _streams;
+    ScopedThread<service_all> _thread;  ///< must be the last member
+};
+
+}  // namespace apf
+
+#endif
@@ -0,0 +1,580 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Built-in real-valued FFT (no external library needed).
+
+#ifndef APF_FFT_H
+#define APF_FFT_H
+
+#include <cmath>  // for std::cos(), std::sin()
+#include <cstdlib>  // for posix_memalign(), std::free()
+#include <new>  // for std::bad_alloc
+#include <stdexcept>  // for std::logic_error
+#include <vector>
+
+#ifdef __SSE__
+#include <xmmintrin.h>  // for SSE instrinsics
+#endif
+
+#include "apf/container.h"  // for fixed_vector
+
+namespace apf
+{
+
+/// Fast Fourier transform, see real_fft
+namespace fft
+{
+
+/// Allocator for memory which is aligned for SIMD operations (32 bytes).
+template<typename T>
+struct aligned_allocator
+{
+  using value_type = T;
+
+  aligned_allocator() noexcept = default;
+
+  template<typename U>
+  aligned_allocator(const aligned_allocator<U>&) noexcept {}
+
+  T* allocate(size_t n)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, 32, n * sizeof(T)) != 0) throw std::bad_alloc();
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t) noexcept { std::free(p); }
+};
+
+template<typename T, typename U>
+bool operator==(const aligned_allocator<T>&, const aligned_allocator<U>&)
+{
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const aligned_allocator<T>&, const aligned_allocator<U>&)
+{
+  return false;
+}
+
+/** Real-valued FFT for power-of-two sizes.
+ * The spectrum is not stored in FFTW's half-complex format but in the
+ * "sorted" format which is used by conv::OutputBase for SIMD processing:
+ * The @c size()/2+1 complex coefficients are stored in groups of four,
+ * each group as four real parts followed by four imaginary parts.
+ * Coefficient 0 and @c size()/2 are real, therefore the (real) coefficient
+ * @c size()/2 is stored in place of the imaginary part of coefficient 0:
+ *                                                                     @code
+ * re0 re1 re2 re3 re(n/2) im1 im2 im3 | re4 re5 re6 re7 im4 im5 im6 im7 | ...
+ *                                                                  @endcode
+ * Like in FFTW, the inverse transform is not normalized, forward() followed
+ * by inverse() scales the signal by @c size().
+ *
+ * Internally, a complex FFT of half the size is computed with radix-4
+ * passes (and one radix-2 pass if needed).  SSE is used if available.
+ * @note forward(float*) and inverse() are not re-entrant, because they use
+ *   internal scratch memory.  forward(float*, float*) uses scratch memory
+ *   provided by the caller and can be called concurrently.
+ **/
+class real_fft
+{
+  public:
+    explicit real_fft(size_t size_);
+
+    size_t size() const { return 2 * _half; }
+
+    void forward(float* data) const;
+    void forward(float* data, float* scratch) const;
+    void inverse(float* data) const;
+
+  private:
+    using buffer_t = fixed_vector<float, aligned_allocator<float>>;
+
+    void _forward(float* data, float* re, float* im) const;
+    void _complex_fft(float* re, float* im) const;
+    void _first_pass(float* re, float* im) const;
+    void _radix4_pass(float* re, float* im, size_t h, const float* tw) const;
+    void _radix2_pass(float* re, float* im, size_t h, const float* tw) const;
+
+    const size_t _half;  ///< Size of the complex FFT
+    fixed_vector<size_t> _bitrev;
+    buffer_t _twiddles;  ///< For all passes after the first one
+    buffer_t _wr, _wi;  ///< Twiddle factors for splitting the real spectrum
+    mutable buffer_t _re, _im;  ///< Scratch memory for the complex FFT
+};
+
+/// @param size_ FFT size, must be a power of 2 (at least 16)
+/// @throw std::logic_error if @p size_ is not supported
+inline real_fft::real_fft(size_t size_)
+  : _half(size_ / 2)
+  , _bitrev(_half)
+  , _wr(_half)
+  , _wi(_half)
+  , _re(_half)
+  , _im(_half)
+{
+  if (size_ < 16 || (size_ & (size_ - 1)) != 0)
+  {
+    throw std::logic_error("real_fft: size must be a power of 2 (at least 16)!");
+  }
+
+  const double pi = 3.14159265358979323846;
+  // W_n^k = exp(-2 pi i k / n)
+  auto w_real = [pi](size_t k, size_t n)
+  {
+    return float(std::cos(2.0 * pi * double(k) / double(n)));
+  };
+  auto w_imag = [pi](size_t k, size_t n)
+  {
+    return float(-std::sin(2.0 * pi * double(k) / double(n)));
+  };
+
+  size_t bits = 0;
+  while ((size_t(1) << bits) < _half) ++bits;
+  for (size_t n = 0; n < _half; ++n)
+  {
+    size_t reversed = 0;
+    for (size_t b = 0; b < bits; ++b)
+    {
+      reversed |= ((n >> b) & 1) << (bits - 1 - b);
+    }
+    _bitrev[n] = reversed;
+  }
+
+  for (size_t k = 0; k < _half; ++k)
+  {
+    _wr[k] = w_real(k, size_);
+    _wi[k] = w_imag(k, size_);
+  }
+
+  // Same sequence of passes as in _complex_fft()
+  std::vector<float> twiddles;
+  size_t h = 4;
+  for (; 4 * h <= _half; h *= 4)
+  {
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_real(j, 2 * h));
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_imag(j, 2 * h));
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_real(j, 4 * h));
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_imag(j, 4 * h));
+  }
+  if (2 * h == _half)
+  {
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_real(j, 2 * h));
+    for (size_t j = 0; j < h; ++j) twiddles.push_back(w_imag(j, 2 * h));
+  }
+  _twiddles.resize(twiddles.size());
+  std::copy(twiddles.begin(), twiddles.end(), _twiddles.begin());
+}
+
+/** In-place forward FFT.
+ * @param data @c size() real samples, overwritten by the sorted spectrum.
+ *   Must be aligned to 16 bytes (e.g. using aligned_allocator).
+ **/
+inline void
+real_fft::forward(float* data) const
+{
+  _forward(data, _re.data(), _im.data());
+}
+
+/** In-place forward FFT with external scratch memory.
+ * @param data see forward(float*)
+ * @param scratch @c size() floats, aligned like @p data
+ **/
+inline void
+real_fft::forward(float* data, float* scratch) const
+{
+  _forward(data, scratch, scratch + _half);
+}
+
+inline void
+real_fft::_forward(float* data, float* re, float* im) const
+{
+  // Even samples are the real parts, odd samples the imaginary parts
+  for (size_t n = 0; n < _half; ++n)
+  {
+    re[n] = data[2 * _bitrev[n]];
+    im[n] = data[2 * _bitrev[n] + 1];
+  }
+
+  _complex_fft(re, im);
+
+  // Split into the spectrum of the real signal:
+  // X[k] = E[k] + W^k O[k] with E[k] = (Z[k] + Z*[M-k]) / 2
+  // and O[k] = -i (Z[k] - Z*[M-k]) / 2
+#ifdef __SSE__
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (size_t k = 0; k < _half; k += 4)
+  {
+    __m128 ar = _mm_load_ps(re + k);
+    __m128 ai = _mm_load_ps(im + k);
+    // Z[M-k], Z[M-k-1], Z[M-k-2], Z[M-k-3] (with Z[M] = Z[0])
+    __m128 br, bi;
+    if (k == 0)
+    {
+      br = _mm_loadu_ps(re + _half - 4);
+      bi = _mm_loadu_ps(im + _half - 4);
+      br = _mm_shuffle_ps(br, br, _MM_SHUFFLE(1, 2, 3, 0));
+      bi = _mm_shuffle_ps(bi, bi, _MM_SHUFFLE(1, 2, 3, 0));
+      br = _mm_move_ss(br, ar);
+      bi = _mm_move_ss(bi, ai);
+    }
+    else
+    {
+      br = _mm_loadu_ps(re + _half - k - 3);
+      bi = _mm_loadu_ps(im + _half - k - 3);
+      br = _mm_shuffle_ps(br, br, _MM_SHUFFLE(0, 1, 2, 3));
+      bi = _mm_shuffle_ps(bi, bi, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    __m128 er = _mm_mul_ps(half, _mm_add_ps(ar, br));
+    __m128 ei = _mm_mul_ps(half, _mm_sub_ps(ai, bi));
+    __m128 odd_r = _mm_mul_ps(half, _mm_add_ps(ai, bi));
+    __m128 odd_i = _mm_mul_ps(half, _mm_sub_ps(br, ar));
+    __m128 wr = _mm_load_ps(_wr.data() + k);
+    __m128 wi = _mm_load_ps(_wi.data() + k);
+    _mm_store_ps(data + 2 * k, _mm_add_ps(er
+          , _mm_sub_ps(_mm_mul_ps(wr, odd_r), _mm_mul_ps(wi, odd_i))));
+    _mm_store_ps(data + 2 * k + 4, _mm_add_ps(ei
+          , _mm_add_ps(_mm_mul_ps(wr, odd_i), _mm_mul_ps(wi, odd_r))));
+  }
+#else
+  for (size_t k = 0; k < _half; ++k)
+  {
+    size_t kk = (_half - k) & (_half - 1);
+    float er = 0.5f * (re[k] + re[kk]);
+    float ei = 0.5f * (im[k] - im[kk]);
+    float odd_r = 0.5f * (im[k] + im[kk]);
+    float odd_i = 0.5f * (re[kk] - re[k]);
+    size_t out = 2 * k - k % 4;
+    data[out] = er + _wr[k] * odd_r - _wi[k] * odd_i;
+    data[out + 4] = ei + _wr[k] * odd_i + _wi[k] * odd_r;
+  }
+#endif
+  // Nyquist frequency
+  data[4] = re[0] - im[0];
+}
+
+/** In-place inverse FFT (not normalized).
+ * @param data sorted spectrum (see forward()), overwritten by @c size() real
+ *   samples.  Must be aligned to 16 bytes (e.g. using aligned_allocator).
+ **/
+inline void
+real_fft::inverse(float* data) const
+{
+  float* re = _re.data();
+  float* im = _im.data();
+
+  // Combine into the spectrum of the complex signal (the inverse of the
+  // splitting in forward(), times 2), in bit-reversed order:
+  // Z[k] = (X[k] + X*[M-k]) + i W^-k (X[k] - X*[M-k])
+#ifdef __SSE__
+  alignas(16) float zr[4], zi[4];
+  for (size_t k = 0; k < _half; k += 4)
+  {
+    __m128 ar = _mm_load_ps(data + 2 * k);
+    __m128 ai = _mm_load_ps(data + 2 * k + 4);
+    // X[M-k], X[M-k-1], X[M-k-2], X[M-k-3] are in two different groups
+    size_t group = 2 * (_half - k);
+    __m128 br = _mm_load_ps(data + group - 8);
+    __m128 bi = _mm_load_ps(data + group - 4);
+    br = _mm_shuffle_ps(br, br, _MM_SHUFFLE(1, 2, 3, 0));
+    bi = _mm_shuffle_ps(bi, bi, _MM_SHUFFLE(1, 2, 3, 0));
+    if (k == 0)
+    {
+      // X[0] and X[M] are real, X[M] is stored in place of imag(X[0])
+      br = _mm_move_ss(br, _mm_load_ss(data + 4));
+      bi = _mm_move_ss(bi, _mm_setzero_ps());
+      ai = _mm_move_ss(ai, _mm_setzero_ps());
+    }
+    else
+    {
+      br = _mm_move_ss(br, _mm_load_ss(data + group));
+      bi = _mm_move_ss(bi, _mm_load_ss(data + group + 4));
+    }
+    __m128 sr = _mm_add_ps(ar, br);
+    __m128 si = _mm_sub_ps(ai, bi);
+    __m128 dr = _mm_sub_ps(ar, br);
+    __m128 di = _mm_add_ps(ai, bi);
+    __m128 wr = _mm_load_ps(_wr.data() + k);
+    __m128 wi = _mm_load_ps(_wi.data() + k);
+    __m128 tr = _mm_add_ps(_mm_mul_ps(wr, dr), _mm_mul_ps(wi, di));
+    __m128 ti = _mm_sub_ps(_mm_mul_ps(wr, di), _mm_mul_ps(wi, dr));
+    _mm_store_ps(zr, _mm_sub_ps(sr, ti));
+    _mm_store_ps(zi, _mm_add_ps(si, tr));
+    for (size_t l = 0; l < 4; ++l)
+    {
+      re[_bitrev[k + l]] = zr[l];
+      im[_bitrev[k + l]] = zi[l];
+    }
+  }
+#else
+  for (size_t k = 0; k < _half; ++k)
+  {
+    size_t kk = _half - k;
+    float ar = data[2 * k - k % 4];
+    float ai = k == 0 ? 0.0f : data[2 * k - k % 4 + 4];
+    float br = k == 0 ? data[4] : data[2 * kk - kk % 4];
+    float bi = k == 0 ? 0.0f : data[2 * kk - kk % 4 + 4];
+    float dr = ar - br;
+    float di = ai + bi;
+    float tr = _wr[k] * dr + _wi[k] * di;
+    float ti = _wr[k] * di - _wi[k] * dr;
+    re[_bitrev[k]] = ar + br - ti;
+    im[_bitrev[k]] = ai - bi + tr;
+  }
+#endif
+
+  // Inverse FFT by swapping real and imaginary parts
+  _complex_fft(im, re);
+
+  // Real parts are the even samples, imaginary parts the odd samples
+#ifdef __SSE__
+  for (size_t n = 0; n < _half; n += 4)
+  {
+    __m128 r = _mm_load_ps(re + n);
+    __m128 i = _mm_load_ps(im + n);
+    _mm_store_ps(data + 2 * n, _mm_unpacklo_ps(r, i));
+    _mm_store_ps(data + 2 * n + 4, _mm_unpackhi_ps(r, i));
+  }
+#else
+  for (size_t n = 0; n < _half; ++n)
+  {
+    data[2 * n] = re[n];
+    data[2 * n + 1] = im[n];
+  }
+#endif
+}
+
+/// Complex FFT of bit-reversed data (decimation in time).
+inline void
+real_fft::_complex_fft(float* re, float* im) const
+{
+  _first_pass(re, im);
+
+  const float* tw = _twiddles.data();
+  size_t h = 4;
+  for (; 4 * h <= _half; h *= 4)
+  {
+    _radix4_pass(re, im, h, tw);
+    tw += 4 * h;
+  }
+  if (2 * h == _half)
+  {
+    _radix2_pass(re, im, h, tw);
+  }
+}
+
+/// The first two stages (radix-4 without twiddle factors).
+inline void
+real_fft::_first_pass(float* re, float* im) const
+{
+  size_t q = 0;
+#ifdef __SSE__
+  // 4 butterflies at a time, transposed to use vertical operations
+  for (; q + 16 <= _half; q += 16)
+  {
+    __m128 r0 = _mm_load_ps(re + q);
+    __m128 r1 = _mm_load_ps(re + q + 4);
+    __m128 r2 = _mm_load_ps(re + q + 8);
+    __m128 r3 = _mm_load_ps(re + q + 12);
+    __m128 i0 = _mm_load_ps(im + q);
+    __m128 i1 = _mm_load_ps(im + q + 4);
+    __m128 i2 = _mm_load_ps(im + q + 8);
+    __m128 i3 = _mm_load_ps(im + q + 12);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+
+    __m128 t0r = _mm_add_ps(r0, r1), t0i = _mm_add_ps(i0, i1);
+    __m128 t1r = _mm_sub_ps(r0, r1), t1i = _mm_sub_ps(i0, i1);
+    __m128 t2r = _mm_add_ps(r2, r3), t2i = _mm_add_ps(i2, i3);
+    __m128 t3r = _mm_sub_ps(r2, r3), t3i = _mm_sub_ps(i2, i3);
+
+    // multiplication of t3 by -i is folded into the additions
+    r0 = _mm_add_ps(t0r, t2r); i0 = _mm_add_ps(t0i, t2i);
+    r1 = _mm_add_ps(t1r, t3i); i1 = _mm_sub_ps(t1i, t3r);
+    r2 = _mm_sub_ps(t0r, t2r); i2 = _mm_sub_ps(t0i, t2i);
+    r3 = _mm_sub_ps(t1r, t3i); i3 = _mm_add_ps(t1i, t3r);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+    _mm_store_ps(re + q, r0);
+    _mm_store_ps(re + q + 4, r1);
+    _mm_store_ps(re + q + 8, r2);
+    _mm_store_ps(re + q + 12, r3);
+    _mm_store_ps(im + q, i0);
+    _mm_store_ps(im + q + 4, i1);
+    _mm_store_ps(im + q + 8, i2);
+    _mm_store_ps(im + q + 12, i3);
+  }
+#endif
+  for (; q < _half; q += 4)
+  {
+    float t0r = re[q] + re[q + 1], t0i = im[q] + im[q + 1];
+    float t1r = re[q] - re[q + 1], t1i = im[q] - im[q + 1];
+    float t2r = re[q + 2] + re[q + 3], t2i = im[q + 2] + im[q + 3];
+    float t3r = re[q + 2] - re[q + 3], t3i = im[q + 2] - im[q + 3];
+
+    re[q] = t0r + t2r; im[q] = t0i + t2i;
+    re[q + 1] = t1r + t3i; im[q + 1] = t1i - t3r;
+    re[q + 2] = t0r - t2r; im[q + 2] = t0i - t2i;
+    re[q + 3] = t1r - t3i; im[q + 3] = t1i + t3r;
+  }
+}
+
+#ifdef __SSE__
+namespace internal
+{
+
+/// Complex multiplication of 4 numbers
+inline void
+complex_multiply(__m128 ar, __m128 ai, __m128 br, __m128 bi
+    , __m128& real, __m128& imag)
+{
+  real = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+  imag = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+}
+
+}  // namespace internal
+#endif
+
+/** Two stages (with half-sizes @p h and 2 @p h) in one pass.
+ * @param tw Twiddle factors W_2h^j and W_4h^j (real and imaginary parts,
+ *   each @p h values)
+ **/
+inline void
+real_fft::_radix4_pass(float* re, float* im, size_t h, const float* tw) const
+{
+  const float* w1r = tw;
+  const float* w1i = tw + h;
+  const float* w2r = tw + 2 * h;
+  const float* w2i = tw + 3 * h;
+
+  for (size_t b = 0; b < _half; b += 4 * h)
+  {
+    float* r0 = re + b; float* i0 = im + b;
+    float* r1 = r0 + h; float* i1 = i0 + h;
+    float* r2 = r1 + h; float* i2 = i1 + h;
+    float* r3 = r2 + h; float* i3 = i2 + h;
+#ifdef __SSE__
+    for (size_t j = 0; j < h; j += 4)
+    {
+      __m128 w1r_ = _mm_load_ps(w1r + j), w1i_ = _mm_load_ps(w1i + j);
+      __m128 w2r_ = _mm_load_ps(w2r + j), w2i_ = _mm_load_ps(w2i + j);
+      __m128 a0r = _mm_load_ps(r0 + j), a0i = _mm_load_ps(i0 + j);
+      __m128 a2r = _mm_load_ps(r2 + j), a2i = _mm_load_ps(i2 + j);
+      __m128 mr, mi;
+
+      // first stage: (a0, a1) and (a2, a3)
+      internal::complex_multiply(_mm_load_ps(r1 + j), _mm_load_ps(i1 + j)
+          , w1r_, w1i_, mr, mi);
+      __m128 t0r = _mm_add_ps(a0r, mr), t0i = _mm_add_ps(a0i, mi);
+      __m128 t1r = _mm_sub_ps(a0r, mr), t1i = _mm_sub_ps(a0i, mi);
+      internal::complex_multiply(_mm_load_ps(r3 + j), _mm_load_ps(i3 + j)
+          , w1r_, w1i_, mr, mi);
+      __m128 t2r = _mm_add_ps(a2r, mr), t2i = _mm_add_ps(a2i, mi);
+      __m128 t3r = _mm_sub_ps(a2r, mr), t3i = _mm_sub_ps(a2i, mi);
+
+      // second stage: (t0, t2) with W_4h^j, (t1, t3) with -i W_4h^j
+      internal::complex_multiply(t2r, t2i, w2r_, w2i_, mr, mi);
+      _mm_store_ps(r0 + j, _mm_add_ps(t0r, mr));
+      _mm_store_ps(i0 + j, _mm_add_ps(t0i, mi));
+      _mm_store_ps(r2 + j, _mm_sub_ps(t0r, mr));
+      _mm_store_ps(i2 + j, _mm_sub_ps(t0i, mi));
+      internal::complex_multiply(t3r, t3i, w2r_, w2i_, mr, mi);
+      _mm_store_ps(r1 + j, _mm_add_ps(t1r, mi));
+      _mm_store_ps(i1 + j, _mm_sub_ps(t1i, mr));
+      _mm_store_ps(r3 + j, _mm_sub_ps(t1r, mi));
+      _mm_store_ps(i3 + j, _mm_add_ps(t1i, mr));
+    }
+#else
+    for (size_t j = 0; j < h; ++j)
+    {
+      float mr = r1[j] * w1r[j] - i1[j] * w1i[j];
+      float mi = r1[j] * w1i[j] + i1[j] * w1r[j];
+      float t0r = r0[j] + mr, t0i = i0[j] + mi;
+      float t1r = r0[j] - mr, t1i = i0[j] - mi;
+      mr = r3[j] * w1r[j] - i3[j] * w1i[j];
+      mi = r3[j] * w1i[j] + i3[j] * w1r[j];
+      float t2r = r2[j] + mr, t2i = i2[j] + mi;
+      float t3r = r2[j] - mr, t3i = i2[j] - mi;
+
+      mr = t2r * w2r[j] - t2i * w2i[j];
+      mi = t2r * w2i[j] + t2i * w2r[j];
+      r0[j] = t0r + mr; i0[j] = t0i + mi;
+      r2[j] = t0r - mr; i2[j] = t0i - mi;
+      mr = t3r * w2r[j] - t3i * w2i[j];
+      mi = t3r * w2i[j] + t3i * w2r[j];
+      r1[j] = t1r + mi; i1[j] = t1i - mr;
+      r3[j] = t1r - mi; i3[j] = t1i + mr;
+    }
+#endif
+  }
+}
+
+/** Last stage (with half-size @p h), if the number of stages is odd.
+ * @param tw Twiddle factors W_2h^j (real and imaginary parts, each @p h
+ *   values)
+ **/
+inline void
+real_fft::_radix2_pass(float* re, float* im, size_t h, const float* tw) const
+{
+  const float* wr = tw;
+  const float* wi = tw + h;
+
+  for (size_t b = 0; b < _half; b += 2 * h)
+  {
+    float* r0 = re + b; float* i0 = im + b;
+    float* r1 = r0 + h; float* i1 = i0 + h;
+#ifdef __SSE__
+    for (size_t j = 0; j < h; j += 4)
+    {
+      __m128 ar = _mm_load_ps(r0 + j), ai = _mm_load_ps(i0 + j);
+      __m128 mr, mi;
+      internal::complex_multiply(_mm_load_ps(r1 + j), _mm_load_ps(i1 + j)
+          , _mm_load_ps(wr + j), _mm_load_ps(wi + j), mr, mi);
+      _mm_store_ps(r0 + j, _mm_add_ps(ar, mr));
+      _mm_store_ps(i0 + j, _mm_add_ps(ai, mi));
+      _mm_store_ps(r1 + j, _mm_sub_ps(ar, mr));
+      _mm_store_ps(i1 + j, _mm_sub_ps(ai, mi));
+    }
+#else
+    for (size_t j = 0; j < h; ++j)
+    {
+      float mr = r1[j] * wr[j] - i1[j] * wi[j];
+      float mi = r1[j] * wi[j] + i1[j] * wr[j];
+      r1[j] = r0[j] - mr; i1[j] = i0[j] - mi;
+      r0[j] += mr; i0[j] += mi;
+    }
+#endif
+  }
+}
+
+}  // namespace fft
+
+}  // namespace apf
+
+#endif
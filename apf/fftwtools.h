@@ -60,6 +60,13 @@ struct fftw<longtype> { \
   static plan plan_r2r_1d(int n, longtype* in, longtype* out \
       , fftw_r2r_kind kind, unsigned flags) { \
     return fftw ## shorttype ## plan_r2r_1d(n, in, out, kind, flags); } \
+  static plan plan_many_r2r(int rank, const int* n, int howmany \
+      , longtype* in, const int* inembed, int istride, int idist \
+      , longtype* out, const int* onembed, int ostride, int odist \
+      , const fftw_r2r_kind* kind, unsigned flags) { \
+    return fftw ## shorttype ## plan_many_r2r(rank, n, howmany \
+        , in, inembed, istride, idist, out, onembed, ostride, odist \
+        , kind, flags); } \
   class scoped_plan { \
     public: \
       template<typename Func, typename... Args> \
@@ -0,0 +1,311 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Pipelined block-wise offline processing with reader and writer threads
+
+#ifndef APF_FILE_IO_PIPELINE_H
+#define APF_FILE_IO_PIPELINE_H
+
+#include <algorithm>  // for std::fill(), std::max()
+#include <atomic>
+#include <chrono>  // for std::chrono::steady_clock
+#include <exception>  // for std::exception_ptr
+#include <thread>
+#include <vector>
+
+#include "apf/container.h"  // for fixed_matrix, fixed_vector
+#include "apf/threadtools.h"  // for Semaphore
+#include "apf/interleave.h"  // for deinterleave(), interleave()
+
+namespace apf
+{
+
+namespace internal
+{
+
+/// One slot of the ring of blocks used in file_io_pipeline().
+struct file_io_block
+{
+  file_io_block(size_t blocksize, size_t in_channels, size_t out_channels)
+    : in(blocksize, in_channels)
+    , out(blocksize, out_channels)
+  {}
+
+  fixed_matrix<float> in;  ///< interleaved input data
+  fixed_matrix<float> out;  ///< interleaved output data
+  size_t frames = 0;  ///< number of valid frames, 0 means end of file
+};
+
+/// Process interleaved data directly, e.g. with interleaved_policy.
+template<typename Processor>
+auto file_io_process(Processor& processor, file_io_block& block
+    , fixed_matrix<float>&, fixed_matrix<float>&, int)
+  -> decltype(processor.audio_callback(size_t(), block.in.data()
+        , block.out.data()))
+{
+  return processor.audio_callback(processor.block_size(), block.in.data()
+      , block.out.data());
+}
+
+/// De-interleave, process (e.g. with pointer_policy) and interleave again.
+template<typename Processor>
+void file_io_process(Processor& processor, file_io_block& block
+    , fixed_matrix<float>& in, fixed_matrix<float>& out, long)
+{
+  auto blocksize = processor.block_size();
+  deinterleave(block.in.data(), size_t(processor.in_channels()), blocksize
+      , in.get_channel_ptrs());
+  processor.audio_callback(blocksize
+      , in.get_channel_ptrs(), out.get_channel_ptrs());
+  interleave(out.get_channel_ptrs(), size_t(processor.out_channels())
+      , blocksize, block.out.data());
+}
+
+/** Call @p process for each job, with one processor per worker thread.
+ * The processors are created once, one after another in the calling thread
+ * (e.g. FFTW planning is not thread-safe), before the workers are started.
+ * The jobs are distributed dynamically, an idle worker takes the next one.
+ * @param factory Function object which returns a (smart) pointer to a new
+ *   processor
+ * @param jobs Number of jobs
+ * @param workers Number of worker threads
+ * @param process Function object, called as @c process(processor, job)
+ * @throw anything that's thrown by @p factory or @p process.  In the latter
+ *   case, the worker stops, the other workers finish their jobs.
+ **/
+template<typename Factory, typename Process>
+void run_batch(Factory factory, size_t jobs, size_t workers, Process process)
+{
+  workers = std::max(workers, size_t(1));
+  std::atomic<size_t> next_job(0);
+  std::vector<std::exception_ptr> errors(workers);
+  std::vector<std::thread> threads;
+
+  std::vector<decltype(factory())> processors;
+  for (size_t w = 0; w < workers; ++w) processors.push_back(factory());
+
+  for (size_t w = 0; w < workers; ++w)
+  {
+    threads.emplace_back([&, w] ()
+    {
+      try
+      {
+        auto& processor = *processors[w];
+        size_t i;
+        while ((i = next_job++) < jobs)
+        {
+          process(processor, i);
+        }
+      }
+      catch (...)
+      {
+        errors[w] = std::current_exception();
+      }
+    });
+  }
+
+  for (auto& thread: threads) thread.join();
+
+  for (auto& error: errors)
+  {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+}  // namespace internal
+
+/// Throughput of file_io_pipeline()
+struct file_io_statistics
+{
+  size_t blocks = 0;  ///< Number of processed blocks
+  size_t frames = 0;  ///< Number of processed frames
+  size_t sample_rate = 0;
+  double seconds = 0;  ///< Wall-clock time for processing
+
+  double blocks_per_second() const { return double(blocks) / seconds; }
+
+  /// Duration of the audio data divided by the processing time
+  double realtime_factor() const
+  {
+    return double(frames) / double(sample_rate) / seconds;
+  }
+};
+
+/** Use MimoProcessor-based object with block-wise input and output.
+ * Reading, processing and writing is done in a pipeline: a reader thread
+ * reads ahead into a ring of @p queue_depth blocks, the processor works on
+ * them in the calling thread and a writer thread writes the results behind.
+ * The last (incomplete) block is zero-padded.
+ * @param processor Object derived from MimoProcessor
+ * @param read Function object which is called as
+ *   <tt>size_t read(float* data, size_t frames)</tt> in the reader thread.
+ *   It stores at most @c frames interleaved frames in @c data and returns
+ *   the number of frames, 0 means end of input.
+ * @param write Function object which is called as
+ *   <tt>write(const float* data, size_t frames)</tt> in the writer thread
+ *   with interleaved output frames.
+ * @param[out] statistics Throughput of the processing
+ * @param queue_depth Number of blocks in the ring (at least 2)
+ * @throw anything that's thrown by @p read, @p write or by the processor.
+ *   The pipeline is stopped and all threads are joined before the (first)
+ *   exception is re-thrown.
+ **/
+template<typename Processor, typename Read, typename Write>
+void file_io_pipeline(Processor& processor, Read read, Write write
+    , file_io_statistics& statistics, size_t queue_depth = 4)
+{
+  auto blocksize = processor.block_size();
+  auto in_channels = size_t(processor.in_channels());
+  auto out_channels = size_t(processor.out_channels());
+  queue_depth = std::max(queue_depth, size_t(2));
+
+  fixed_vector<internal::file_io_block> blocks(queue_depth
+      , blocksize, in_channels, out_channels);
+
+  // these matrices are used for de-interleaving and interleaving (unless the
+  // processor can handle interleaved data, see internal::file_io_process())
+  fixed_matrix<float> m_in_transpose(in_channels, blocksize);
+  fixed_matrix<float> m_out_transpose(out_channels, blocksize);
+
+  // Each block goes from "empty" to "read" to "processed" and back to "empty"
+  Semaphore empty_blocks(static_cast<int>(queue_depth));
+  Semaphore read_blocks, processed_blocks;
+
+  // If one of the threads fails, all of them are woken up and stop without
+  // touching any further blocks
+  std::atomic<bool> failed(false);
+  std::exception_ptr reader_error, processor_error, writer_error;
+  auto stop = [&] ()
+  {
+    failed = true;
+    empty_blocks.post();
+    read_blocks.post();
+    processed_blocks.post();
+  };
+
+  processor.activate();
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread reader([&] ()
+  {
+    for (size_t i = 0; ; i = (i + 1) % queue_depth)
+    {
+      empty_blocks.wait();
+      if (failed) break;
+      auto& block = blocks[i];
+      size_t frames;
+      try
+      {
+        frames = read(block.in.data(), blocksize);
+      }
+      catch (...)
+      {
+        reader_error = std::current_exception();
+        stop();
+        break;
+      }
+      // Don't process left-overs of previous blocks
+      std::fill(block.in.data() + frames * in_channels
+          , block.in.data() + blocksize * in_channels, 0.0f);
+      block.frames = frames;
+      read_blocks.post();
+      if (frames == 0) break;
+    }
+  });
+
+  std::thread writer([&] ()
+  {
+    for (size_t i = 0; ; i = (i + 1) % queue_depth)
+    {
+      processed_blocks.wait();
+      if (failed) break;
+      auto& block = blocks[i];
+      if (block.frames == 0) break;
+      try
+      {
+        write(static_cast<const float*>(block.out.data()), block.frames);
+      }
+      catch (...)
+      {
+        writer_error = std::current_exception();
+        stop();
+        break;
+      }
+      empty_blocks.post();
+    }
+  });
+
+  size_t processed = 0;
+  size_t total_frames = 0;
+  try
+  {
+    for (size_t i = 0; ; i = (i + 1) % queue_depth)
+    {
+      read_blocks.wait();
+      if (failed) break;
+      auto& block = blocks[i];
+      // The block must not be accessed after it is passed on
+      auto frames = block.frames;
+      if (frames != 0)
+      {
+        internal::file_io_process(processor, block
+            , m_in_transpose, m_out_transpose, 0);
+        ++processed;
+        total_frames += frames;
+      }
+      processed_blocks.post();
+      if (frames == 0) break;
+    }
+  }
+  catch (...)
+  {
+    processor_error = std::current_exception();
+    stop();
+  }
+
+  reader.join();
+  writer.join();
+
+  statistics.blocks = processed;
+  statistics.frames = total_frames;
+  statistics.sample_rate = size_t(processor.sample_rate());
+  statistics.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  processor.deactivate();
+
+  for (auto& error: { processor_error, reader_error, writer_error })
+  {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+}  // namespace apf
+
+#endif
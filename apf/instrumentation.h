@@ -0,0 +1,562 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Per-block timing of MimoProcessor::process().
+
+#ifndef APF_INSTRUMENTATION_H
+#define APF_INSTRUMENTATION_H
+
+#include <algorithm>  // for std::sort(), std::max()
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>  // for std::max_align_t
+#include <cstdint>  // for uint64_t
+#include <memory>  // for std::unique_ptr
+#include <iomanip>  // for std::setw()
+#include <ostream>
+#include <string>  // for std::to_string()
+#include <vector>
+
+#include "apf/lockfreefifo.h"
+#include "apf/math.h"  // for next_power_of_2()
+#include "apf/parameter_map.h"
+
+namespace apf
+{
+
+/// Stages of MimoProcessor::process(), in order of execution.
+enum class instrumentation_stage
+{
+  commands,  ///< non-realtime commands from the CommandQueue
+  inputs,  ///< processing of the input list
+  process,  ///< the Process struct of the derived class
+  outputs,  ///< processing of the output list
+  queries,  ///< query commands (see enable_queries)
+};
+
+/// Number of values in instrumentation_stage
+constexpr size_t instrumentation_stages = 5;
+
+/// Wall clock timing of one call to MimoProcessor::process().
+/// All times are in seconds.
+struct block_timing
+{
+  struct thread_timing
+  {
+    double busy = 0;  ///< time spent processing list items
+    /// Slowest list item (only if item timing is enabled).
+    /// Only use it for identification, the item might not exist anymore!
+    const void* slowest_item = nullptr;
+    double slowest_item_time = 0;  ///< time spent in @c slowest_item
+  };
+
+  std::array<double, instrumentation_stages> stages{};  ///< time per stage
+  double total = 0;  ///< time for the whole block
+  double load = 0;  ///< @c total relative to the block period
+  std::vector<thread_timing> threads;  ///< index 0 is the main thread
+
+  double stage(instrumentation_stage s) const
+  {
+    return stages[static_cast<size_t>(s)];
+  }
+
+  /// @return @b true if the block took longer than the block period.
+  bool overload() const { return load > 1.0; }
+};
+
+/** Policy for MimoProcessor which measures the wall clock time of each audio
+ * block (with @c std::chrono::steady_clock).
+ * Each block_timing is filled in the audio thread (and the worker threads)
+ * and handed over to a non-realtime thread with a LockFreeFifo.
+ * No memory is allocated and no locks are taken in the audio thread.
+ * If the reader doesn't keep up, timings are dropped (see dropped_timings()).
+ *
+ * The parameter @c "timing_blocks" (default: 1024) sets the number of
+ * block_timing%s which can be buffered.
+ * Item timing (see item_timing()) is disabled by default, because it needs
+ * two clock readings per list item.
+ *
+ * Usage example:
+ *                                                                     @code
+ * class MyProcessor : public apf::MimoProcessor<MyProcessor
+ *                     , apf::jack_policy, apf::disable_queries
+ *                     , apf::enable_instrumentation>
+ * { ... };
+ *
+ * // in a non-realtime thread, e.g. in the update() function of a query:
+ * apf::timing_statistics stats;
+ * processor.read_timings([&](const apf::block_timing& t) { stats.add(t); });
+ * stats.print(std::cout);
+ *                                                                  @endcode
+ **/
+class enable_instrumentation
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// Pass all available block timings to @p f and return their number.
+    /// This must only be called from one (non-realtime) thread at a time.
+    template<typename F>
+    size_t read_timings(F f)
+    {
+      size_t count = 0;
+      while (auto* t = _full->pop())
+      {
+        f(static_cast<const block_timing&>(*t));
+        _free->push(t);
+        ++count;
+      }
+      return count;
+    }
+
+    /// Number of blocks which couldn't be recorded because read_timings()
+    /// wasn't called often enough.
+    size_t dropped_timings() const { return _dropped.load(); }
+
+    /// Enable/disable timing of individual list items.
+    void item_timing(bool enable) { _item_timing.store(enable); }
+
+    /// Block period in seconds (block size divided by sample rate).
+    double block_period() const { return _block_period; }
+
+  protected:
+    enable_instrumentation() = default;
+
+    /// Called in the constructor of MimoProcessor
+    template<typename P>
+    void _instrumentation_init(const P& interface, unsigned threads
+        , const parameter_map& params)
+    {
+      _block_period = static_cast<double>(interface.block_size())
+        / static_cast<double>(interface.sample_rate());
+      auto blocks = params.get("timing_blocks", size_t(1024));
+      _timings.resize(blocks);
+      // Both FIFOs must be able to hold all timings
+      _free = std::make_unique<LockFreeFifo<block_timing*>>(blocks + 2);
+      _full = std::make_unique<LockFreeFifo<block_timing*>>(blocks + 2);
+      for (auto& t: _timings)
+      {
+        t.threads.resize(threads);
+        _free->push(&t);
+      }
+    }
+
+    void _instrument_block_begin()
+    {
+      _current = _free->pop();
+      if (!_current)
+      {
+        ++_dropped;
+        return;
+      }
+      _current->stages.fill(0);
+      for (auto& t: _current->threads) t = block_timing::thread_timing();
+      _items = _item_timing.load(std::memory_order_relaxed);
+      _block_start = _stage_start = clock::now();
+    }
+
+    void _instrument_stage_end(instrumentation_stage s)
+    {
+      if (!_current) return;
+      auto now = clock::now();
+      _current->stages[static_cast<size_t>(s)] = _seconds(now - _stage_start);
+      _stage_start = now;
+    }
+
+    void _instrument_block_end()
+    {
+      if (!_current) return;
+      _current->total = _seconds(_stage_start - _block_start);
+      _current->load = _current->total / _block_period;
+      _full->push(_current);
+      _current = nullptr;
+    }
+
+    // The following are called from the main audio thread and the worker
+    // threads.  They are synchronized by the semaphores of MimoProcessor.
+
+    clock::time_point _instrument_thread_begin() const
+    {
+      return _current ? clock::now() : clock::time_point();
+    }
+
+    void _instrument_thread_end(unsigned thread, clock::time_point start)
+    {
+      if (!_current) return;
+      _current->threads[thread].busy += _seconds(clock::now() - start);
+    }
+
+    clock::time_point _instrument_item_begin() const
+    {
+      return (_current && _items) ? clock::now() : clock::time_point();
+    }
+
+    /// Item costs are not measured, see enable_item_profiling.
+    double _item_cost_measurement(const void*) const { return -1; }
+
+    void _instrument_item_end(unsigned thread, const void* item
+        , clock::time_point start)
+    {
+      if (!_current || !_items) return;
+      auto time = _seconds(clock::now() - start);
+      auto& t = _current->threads[thread];
+      if (time > t.slowest_item_time)
+      {
+        t.slowest_item_time = time;
+        t.slowest_item = item;
+      }
+    }
+
+  private:
+    static double _seconds(clock::duration d)
+    {
+      return std::chrono::duration<double>(d).count();
+    }
+
+    std::vector<block_timing> _timings;
+    // The FIFOs are created in _instrumentation_init()
+    std::unique_ptr<LockFreeFifo<block_timing*>> _free, _full;
+    block_timing* _current = nullptr;
+    bool _items = false;
+    std::atomic<bool> _item_timing{false};
+    std::atomic<size_t> _dropped{0};
+    double _block_period = 0;
+    clock::time_point _block_start, _stage_start;
+};
+
+/// Accumulated processing time of one list item, see enable_item_profiling.
+struct item_cost
+{
+  /// Only use it for identification, the item might not exist anymore!
+  const void* item = nullptr;
+  uint64_t count = 0;  ///< number of calls to Item::process()
+  double total = 0;  ///< time in seconds, summed over all calls
+  double max = 0;  ///< time of the slowest call in seconds
+
+  double mean() const { return count ? total / static_cast<double>(count) : 0; }
+};
+
+/** Policy for MimoProcessor which does everything enable_instrumentation does
+ * and additionally accumulates the processing time of each list item.
+ *
+ * Each call to Item::process() is timed (with @c std::chrono::steady_clock).
+ * The results are accumulated in a preallocated hash table (indexed by the
+ * address of the item) which is updated lock-free from the audio thread and
+ * the worker threads.
+ * The parameter @c "profiled_items" (default: 256) sets the maximum number of
+ * items, the time of further items is not recorded (see untracked_items()).
+ *
+ * Use most_expensive_items() (from a non-realtime thread) to find out which
+ * items are responsible for overloads and how to distribute them among
+ * threads.
+ **/
+class enable_item_profiling : public enable_instrumentation
+{
+  public:
+    /// Get the @p n items with the largest accumulated time.
+    /// The values of items which are currently processed may be slightly
+    /// inconsistent.
+    std::vector<item_cost> most_expensive_items(size_t n) const
+    {
+      std::vector<item_cost> result;
+      for (size_t i = 0; i < _capacity; ++i)
+      {
+        const auto& s = _slots[i];
+        item_cost cost;
+        cost.item = s.item.load(std::memory_order_acquire);
+        if (!cost.item) continue;
+        cost.count = s.count.load(std::memory_order_relaxed);
+        cost.total = _seconds(s.nanoseconds.load(std::memory_order_relaxed));
+        cost.max = _seconds(s.max.load(std::memory_order_relaxed));
+        result.push_back(cost);
+      }
+      n = std::min(n, result.size());
+      std::partial_sort(result.begin(), result.begin()
+          + static_cast<std::ptrdiff_t>(n), result.end()
+          , [](const item_cost& a, const item_cost& b)
+          {
+            return a.total > b.total;
+          });
+      result.resize(n);
+      return result;
+    }
+
+    /// Clear all statistics.  This is done at the beginning of the next block.
+    void reset_item_profile() { _reset.store(true); }
+
+    /// Number of calls to Item::process() which couldn't be recorded
+    /// because there were more than @c "profiled_items" items.
+    uint64_t untracked_items() const { return _untracked.load(); }
+
+  protected:
+    enable_item_profiling() = default;
+
+    template<typename P>
+    void _instrumentation_init(const P& interface, unsigned threads
+        , const parameter_map& params)
+    {
+      enable_instrumentation::_instrumentation_init(interface, threads, params);
+      // The table is kept at most half full to keep the probe chains short
+      _capacity = math::next_power_of_2(
+          2 * params.get("profiled_items", size_t(256)));
+      _slots = std::make_unique<slot[]>(_capacity);
+    }
+
+    void _instrument_block_begin()
+    {
+      enable_instrumentation::_instrument_block_begin();
+      if (_reset.exchange(false))
+      {
+        for (size_t i = 0; i < _capacity; ++i) _slots[i].clear();
+        _untracked = 0;
+      }
+    }
+
+    clock::time_point _instrument_item_begin() const
+    {
+      return clock::now();
+    }
+
+    /// Mean processing time of @p item in seconds, -1 if not available.
+    /// This is called in the audio thread by MimoProcessor::balance_threads().
+    double _item_cost_measurement(const void* item) const
+    {
+      auto mask = _capacity - 1;
+      auto index = _hash(item) & mask;
+      for (size_t i = 0; i < _capacity; ++i, index = (index + 1) & mask)
+      {
+        const auto& s = _slots[index];
+        auto current = s.item.load(std::memory_order_acquire);
+        if (current == nullptr) break;
+        if (current != item) continue;
+        auto count = s.count.load(std::memory_order_relaxed);
+        if (count == 0) break;
+        return _seconds(s.nanoseconds.load(std::memory_order_relaxed))
+          / static_cast<double>(count);
+      }
+      return -1;
+    }
+
+    void _instrument_item_end(unsigned thread, const void* item
+        , clock::time_point start)
+    {
+      auto elapsed = clock::now() - start;
+      if (auto* s = _find_slot(item))
+      {
+        auto ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+              elapsed).count());
+        // Each item is only processed by one thread at a time, no RMW needed
+        s->count.store(s->count.load(std::memory_order_relaxed) + 1
+            , std::memory_order_relaxed);
+        s->nanoseconds.store(s->nanoseconds.load(std::memory_order_relaxed)
+            + ns, std::memory_order_relaxed);
+        if (ns > s->max.load(std::memory_order_relaxed))
+        {
+          s->max.store(ns, std::memory_order_relaxed);
+        }
+      }
+      else
+      {
+        ++_untracked;
+      }
+      enable_instrumentation::_instrument_item_end(thread, item, start);
+    }
+
+  private:
+    struct slot
+    {
+      std::atomic<const void*> item{nullptr};
+      std::atomic<uint64_t> count{0}, nanoseconds{0}, max{0};
+
+      void clear()
+      {
+        item = nullptr;
+        count = 0;
+        nanoseconds = 0;
+        max = 0;
+      }
+    };
+
+    static double _seconds(uint64_t nanoseconds)
+    {
+      return static_cast<double>(nanoseconds) * 1e-9;
+    }
+
+    static size_t _hash(const void* item)
+    {
+      // The lowest bits of heap addresses are always zero
+      return reinterpret_cast<uintptr_t>(item) / alignof(std::max_align_t);
+    }
+
+    /// Find the slot of @p item or claim a new one (linear probing).
+    /// @return @b nullptr if the table is full.
+    slot* _find_slot(const void* item)
+    {
+      auto mask = _capacity - 1;
+      auto index = _hash(item) & mask;
+      for (size_t i = 0; i < _capacity; ++i, index = (index + 1) & mask)
+      {
+        auto& s = _slots[index];
+        auto current = s.item.load(std::memory_order_acquire);
+        if (current == item) return &s;
+        if (current == nullptr)
+        {
+          // Another thread might claim this slot at the same time
+          if (s.item.compare_exchange_strong(current, item)
+              || current == item)
+          {
+            return &s;
+          }
+        }
+      }
+      return nullptr;
+    }
+
+    size_t _capacity = 0;
+    std::unique_ptr<slot[]> _slots;
+    std::atomic<bool> _reset{false};
+    std::atomic<uint64_t> _untracked{0};
+};
+
+/// Policy for MimoProcessor without instrumentation (the default).
+class disable_instrumentation
+{
+  protected:
+    template<typename P>
+    void _instrumentation_init(const P&, unsigned, const parameter_map&) {}
+
+    void _instrument_block_begin() {}
+    void _instrument_stage_end(instrumentation_stage) {}
+    void _instrument_block_end() {}
+
+    int _instrument_thread_begin() const { return 0; }
+    void _instrument_thread_end(unsigned, int) {}
+    int _instrument_item_begin() const { return 0; }
+    void _instrument_item_end(unsigned, const void*, int) {}
+
+    double _item_cost_measurement(const void*) const { return -1; }
+};
+
+/** Histograms of block_timing%s, to be used in a non-realtime thread.
+ * All values are stored, use clear() to start a new measurement period.
+ **/
+class timing_statistics
+{
+  public:
+    struct summary
+    {
+      double p50 = 0, p99 = 0, max = 0;
+    };
+
+    void add(const block_timing& t)
+    {
+      for (size_t i = 0; i < instrumentation_stages; ++i)
+      {
+        _stages[i].push_back(t.stages[i]);
+      }
+      _total.push_back(t.total);
+      _load.push_back(t.load);
+      if (t.overload()) ++_overloads;
+      if (_threads.size() < t.threads.size()) _threads.resize(t.threads.size());
+      for (size_t i = 0; i < t.threads.size(); ++i)
+      {
+        _threads[i].push_back(t.threads[i].busy);
+      }
+    }
+
+    void clear() { *this = timing_statistics(); }
+
+    size_t blocks() const { return _total.size(); }
+
+    /// Number of blocks which took longer than the block period
+    size_t overloads() const { return _overloads; }
+
+    summary stage(instrumentation_stage s) const
+    {
+      return _summarize(_stages[static_cast<size_t>(s)]);
+    }
+
+    summary total() const { return _summarize(_total); }
+    summary load() const { return _summarize(_load); }
+
+    /// @note No bounds checking!
+    summary thread(size_t n) const { return _summarize(_threads[n]); }
+    size_t threads() const { return _threads.size(); }
+
+    /// Print a table of all summaries (times in microseconds).
+    void print(std::ostream& out) const
+    {
+      static const char* names[instrumentation_stages] = {
+        "commands", "inputs", "process", "outputs", "queries" };
+
+      auto line = [&out](const std::string& name, summary s, double factor)
+      {
+        out << std::setw(12) << name
+          << std::setw(12) << s.p50 * factor
+          << std::setw(12) << s.p99 * factor
+          << std::setw(12) << s.max * factor << '\n';
+      };
+
+      out << blocks() << " blocks, " << overloads() << " overloads\n"
+        << std::setw(12) << "[us]" << std::setw(12) << "p50"
+        << std::setw(12) << "p99" << std::setw(12) << "max" << '\n';
+      for (size_t i = 0; i < instrumentation_stages; ++i)
+      {
+        line(names[i], _summarize(_stages[i]), 1e6);
+      }
+      line("total", total(), 1e6);
+      for (size_t i = 0; i < _threads.size(); ++i)
+      {
+        line("thread " + std::to_string(i), thread(i), 1e6);
+      }
+      line("load [%]", load(), 100);
+    }
+
+  private:
+    static summary _summarize(std::vector<double> values)
+    {
+      summary result;
+      if (values.empty()) return result;
+      std::sort(values.begin(), values.end());
+      auto last = values.size() - 1;
+      result.p50 = values[last / 2];
+      result.p99 = values[last * 99 / 100];
+      result.max = values[last];
+      return result;
+    }
+
+    std::array<std::vector<double>, instrumentation_stages> _stages;
+    std::vector<double> _total, _load;
+    std::vector<std::vector<double>> _threads;
+    size_t _overloads = 0;
+};
+
+}  // namespace apf
+
+#endif
@@ -0,0 +1,169 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Conversion between interleaved and non-interleaved audio data.
+
+#ifndef APF_INTERLEAVE_H
+#define APF_INTERLEAVE_H
+
+#include <cstddef>  // for size_t
+
+#ifdef __SSE__
+#include <xmmintrin.h>  // for SSE intrinsics
+#endif
+
+namespace apf
+{
+
+namespace internal
+{
+  // Generic versions: not optimized, return number of processed frames.
+
+  template<typename T>
+  size_t deinterleave_simd(const T*, size_t, size_t, T* const*) { return 0; }
+
+  template<typename T>
+  size_t interleave_simd(const T* const*, size_t, size_t, T*) { return 0; }
+
+#ifdef __SSE__
+  /// Deinterleave float data with 2 or 4 channels, 4 frames at a time.
+  inline size_t deinterleave_simd(const float* in, size_t channels
+      , size_t frames, float* const* out)
+  {
+    size_t i = 0;
+    if (channels == 2)
+    {
+      for (; i + 4 <= frames; i += 4, in += 8)
+      {
+        __m128 a = _mm_loadu_ps(in);
+        __m128 b = _mm_loadu_ps(in + 4);
+        _mm_storeu_ps(out[0] + i
+            , _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(out[1] + i
+            , _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+      }
+    }
+    else if (channels == 4)
+    {
+      for (; i + 4 <= frames; i += 4, in += 16)
+      {
+        __m128 r0 = _mm_loadu_ps(in);
+        __m128 r1 = _mm_loadu_ps(in + 4);
+        __m128 r2 = _mm_loadu_ps(in + 8);
+        __m128 r3 = _mm_loadu_ps(in + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out[0] + i, r0);
+        _mm_storeu_ps(out[1] + i, r1);
+        _mm_storeu_ps(out[2] + i, r2);
+        _mm_storeu_ps(out[3] + i, r3);
+      }
+    }
+    return i;
+  }
+
+  /// Interleave float data with 2 or 4 channels, 4 frames at a time.
+  inline size_t interleave_simd(const float* const* in, size_t channels
+      , size_t frames, float* out)
+  {
+    size_t i = 0;
+    if (channels == 2)
+    {
+      for (; i + 4 <= frames; i += 4, out += 8)
+      {
+        __m128 l = _mm_loadu_ps(in[0] + i);
+        __m128 r = _mm_loadu_ps(in[1] + i);
+        _mm_storeu_ps(out, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 4, _mm_unpackhi_ps(l, r));
+      }
+    }
+    else if (channels == 4)
+    {
+      for (; i + 4 <= frames; i += 4, out += 16)
+      {
+        __m128 r0 = _mm_loadu_ps(in[0] + i);
+        __m128 r1 = _mm_loadu_ps(in[1] + i);
+        __m128 r2 = _mm_loadu_ps(in[2] + i);
+        __m128 r3 = _mm_loadu_ps(in[3] + i);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out, r0);
+        _mm_storeu_ps(out + 4, r1);
+        _mm_storeu_ps(out + 8, r2);
+        _mm_storeu_ps(out + 12, r3);
+      }
+    }
+    return i;
+  }
+#endif
+}  // namespace internal
+
+/** Split interleaved data into separate channels.
+ * For @c float data with 2 or 4 channels, SSE instructions are used (if
+ * available).
+ * @param in Interleaved data (@p channels * @p frames elements)
+ * @param channels Number of channels
+ * @param frames Number of frames
+ * @param out Array of @p channels pointers, each to @p frames elements
+ * @see interleave()
+ **/
+template<typename T>
+void deinterleave(const T* in, size_t channels, size_t frames, T* const* out)
+{
+  auto done = internal::deinterleave_simd(in, channels, frames, out);
+  for (size_t c = 0; c < channels; ++c)
+  {
+    const T* source = in + done * channels + c;
+    for (size_t i = done; i < frames; ++i, source += channels)
+    {
+      out[c][i] = *source;
+    }
+  }
+}
+
+/** Combine separate channels into interleaved data.
+ * @param in Array of @p channels pointers, each to @p frames elements
+ * @param channels Number of channels
+ * @param frames Number of frames
+ * @param out Interleaved data (@p channels * @p frames elements)
+ * @see deinterleave()
+ **/
+template<typename T>
+void interleave(const T* const* in, size_t channels, size_t frames, T* out)
+{
+  auto done = internal::interleave_simd(in, channels, frames, out);
+  for (size_t c = 0; c < channels; ++c)
+  {
+    T* target = out + done * channels + c;
+    for (size_t i = done; i < frames; ++i, target += channels)
+    {
+      *target = in[c][i];
+    }
+  }
+}
+
+}  // namespace apf
+
+#endif
@@ -0,0 +1,242 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// C policy (= pointer based) for MimoProcessor's audio_interface.
+/// @file
+/// Interleaved C policy (= pointer based) for MimoProcessor's audio_interface.
+
+#ifndef APF_INTERLEAVED_POLICY_H
+#define APF_INTERLEAVED_POLICY_H
+
+#include <cassert>  // for assert()
+#include <algorithm>  // for std::copy()
+#include <vector>
+#include "apf/parameter_map.h"
+#include "apf/iterator.h"  // for has_begin_and_end, stride_iterator
+
+#ifndef APF_MIMOPROCESSOR_SAMPLE_TYPE
+#define APF_MIMOPROCESSOR_SAMPLE_TYPE float
+#endif
+#ifndef APF_MIMOPROCESSOR_INTERFACE_POLICY
+#define APF_MIMOPROCESSOR_INTERFACE_POLICY apf::interleaved_policy<APF_MIMOPROCESSOR_SAMPLE_TYPE*>
+#endif
+
+namespace apf
+{
+
+template<typename T> class interleaved_policy;  // no implementation, use <T*>!
+
+/// @c interface_policy which uses plain pointers to interleaved data.
+/// The buffers of inputs and outputs are accessed with a stride_iterator, so
+/// no (de-)interleaving is needed.
+/// Apart from that, it works like pointer_policy.
+/// @see MimoProcessor, pointer_policy, deinterleave(), interleave()
+/// @ingroup apf_policies
+template<typename T>
+class interleaved_policy<T*>
+{
+  public:
+    using sample_type = T;
+
+    class Input;
+    class Output;
+
+    void audio_callback(size_t n, const T* in, T* out);
+    void flush(size_t n, const T* in, T* out);
+
+    // for now, do nothing:
+    bool activate() const { return true; }
+    bool deactivate() const { return true; }
+
+    size_t block_size() const { return _block_size; }
+    size_t sample_rate() const { return _sample_rate; }
+
+    int in_channels() const { return _next_input_id; }
+    int out_channels() const { return _next_output_id; }
+
+  protected:
+    explicit interleaved_policy(const parameter_map& params = parameter_map())
+      : _sample_rate(params.get<size_t>("sample_rate"))
+      , _block_size(params.get<size_t>("block_size"))
+      , _next_input_id(0)
+      , _next_output_id(0)
+      , _in(nullptr)
+      , _out(nullptr)
+    {}
+
+    virtual ~interleaved_policy() = default;
+
+  private:
+    virtual void process() = 0;
+
+    /// Generate next higher input ID.
+    /// @warning This function is \b not re-entrant!
+    int get_next_input_id() { return _next_input_id++; }
+
+    /// @see get_next_input_id()
+    int get_next_output_id() { return _next_output_id++; }
+
+    const size_t _sample_rate;
+    const size_t _block_size;
+
+    int _next_input_id;
+    int _next_output_id;
+    const T* _in;  ///< first frame of the current block
+    T* _out;  ///< first frame of the current block
+
+    /// Zero-padded copies of the last (incomplete) block, see flush()
+    std::vector<T> _remainder_in, _remainder_out;
+};
+
+/** This has to be called for each audio block.
+ * As in pointer_policy::audio_callback(), @p n can be a multiple of
+ * block_size() for offline processing.  A last incomplete block can be
+ * processed with flush().
+ * @attention The number of channels in @p in and @p out must be
+ *   in_channels() and out_channels(), respectively. Inputs and outputs can be
+ *   added, but @p in and @p out must be enlarged accordingly.
+ * @warning If inputs/outputs are @em removed, the corresponding channels must
+ *   remain in @p in/@p out!
+ * @param n number of frames, normally the block size
+ * @param in pointer to interleaved input data
+ * @param out pointer to interleaved output data
+ **/
+template<typename T>
+void
+interleaved_policy<T*>::audio_callback(size_t n, const T* in, T* out)
+{
+  auto in_channels = static_cast<size_t>(this->in_channels());
+  auto out_channels = static_cast<size_t>(this->out_channels());
+  auto block_size = this->block_size();
+
+  assert(n >= block_size);
+  assert(n % block_size == 0);
+
+  for (size_t offset = 0; offset + block_size <= n; offset += block_size)
+  {
+    _in = in + offset * in_channels;
+    _out = out + offset * out_channels;
+    this->process();
+  }
+}
+
+/** Process the last incomplete block, see pointer_policy::flush().
+ * @attention This allocates memory, it's not meant for realtime use!
+ * @param n number of frames, less than block_size()
+ * @param in pointer to interleaved input data
+ * @param out pointer to interleaved output data
+ **/
+template<typename T>
+void
+interleaved_policy<T*>::flush(size_t n, const T* in, T* out)
+{
+  assert(n < this->block_size());
+  if (n == 0) return;
+
+  auto in_channels = static_cast<size_t>(this->in_channels());
+  auto out_channels = static_cast<size_t>(this->out_channels());
+  auto block_size = this->block_size();
+
+  _remainder_in.assign(block_size * in_channels, T());
+  _remainder_out.assign(block_size * out_channels, T());
+  std::copy(in, in + n * in_channels, _remainder_in.begin());
+  _in = _remainder_in.data();
+  _out = _remainder_out.data();
+  this->process();
+  std::copy(_remainder_out.begin()
+      , _remainder_out.begin() + static_cast<std::ptrdiff_t>(n * out_channels)
+      , out);
+}
+
+template<typename T>
+class interleaved_policy<T*>::Input
+{
+  public:
+    using iterator = stride_iterator<T const*>;
+
+    struct buffer_type : has_begin_and_end<iterator> { friend class Input; };
+
+    void fetch_buffer()
+    {
+      this->buffer._begin = iterator(_parent._in + _id, _parent.in_channels());
+      this->buffer._end = this->buffer._begin
+        + static_cast<std::ptrdiff_t>(_parent.block_size());
+    }
+
+    buffer_type buffer;
+
+  protected:
+    Input(interleaved_policy& parent, const parameter_map&)
+      : _parent(parent)
+      , _id(_parent.get_next_input_id())
+    {}
+
+    ~Input() = default;
+
+  private:
+    Input(const Input&); Input& operator=(const Input&);  // deactivated
+
+    interleaved_policy& _parent;
+    const int _id;
+};
+
+template<typename T>
+class interleaved_policy<T*>::Output
+{
+  public:
+    using iterator = stride_iterator<T*>;
+
+    struct buffer_type : has_begin_and_end<iterator> { friend class Output; };
+
+    void fetch_buffer()
+    {
+      this->buffer._begin = iterator(_parent._out + _id
+          , _parent.out_channels());
+      this->buffer._end = this->buffer._begin
+        + static_cast<std::ptrdiff_t>(_parent.block_size());
+    }
+
+    buffer_type buffer;
+
+  protected:
+    Output(interleaved_policy& parent, const parameter_map&)
+      : _parent(parent)
+      , _id(_parent.get_next_output_id())
+    {}
+
+    ~Output() = default;
+
+  private:
+    Output(const Output&); Output& operator=(const Output&);  // deactivated
+
+    interleaved_policy& _parent;
+    const int _id;
+};
+
+}  // namespace apf
+
+#endif
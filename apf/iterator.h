@@ -30,9 +30,11 @@
 #ifndef APF_ITERATOR_H
 #define APF_ITERATOR_H
 
+#include <algorithm>  // for std::copy(), std::transform(), std::min()
 #include <cassert>  // for assert()
 #include <iterator>  // for std::iterator_traits, std::output_iterator_tag, ...
 #include <type_traits>  // for std::remove_reference, std::result_of
+#include <utility>  // for std::pair
 
 #include "apf/math.h"  // for wrap()
 
@@ -820,6 +822,27 @@ class circular_iterator
 
     APF_ITERATOR_BASE(I, _current)
 
+    /// Contiguous range of the underlying iterator type. @see spans()
+    using span = has_begin_and_end<I>;
+
+    /// Split a range into (at most) two contiguous ranges.
+    /// Algorithms working on the spans don't need a wrap-around check for
+    /// each element. If @c I is a pointer, they can use @c memcpy() or SIMD
+    /// instructions.
+    /// @param n number of elements, starting at the current position.
+    ///   It must not be larger than the length of the underlying range.
+    /// @return pair of ranges; the second one is empty if there is no
+    ///   wrap-around.
+    /// @see apf::copy(), apf::transform()
+    std::pair<span, span> spans(difference_type n) const
+    {
+      assert(no_nullptr(_begin) && no_nullptr(_end) && no_nullptr(_current));
+      assert(n >= 0 && n <= _end - _begin);
+      auto first_length = std::min(n, _end - _current);
+      return { span(_current, _current + first_length)
+             , span(_begin, _begin + (n - first_length)) };
+    }
+
   private:
     I _begin;   ///< begin of the underlying iterator range
     I _end;     ///< end of said range
@@ -859,6 +882,41 @@ make_circular_iterator(I begin, I end, I current)
   return circular_iterator<I>(begin, end, current);
 }
 
+/** Copy a range of a circular_iterator in (at most) two contiguous parts.
+ * This does the same as @c std::copy(), but without a wrap-around check for
+ * each element. If @p I is a pointer, this typically ends up as @c memmove().
+ * @param first Iterator to the first element
+ * @param last Past-the-end iterator, must be based on the same range
+ * @param result Destination iterator
+ * @return Destination iterator past the last copied element
+ * @note If @p first and @p last are equal, nothing is copied, so a whole
+ *   revolution can not be copied with this function.
+ * @see circular_iterator::spans()
+ * @ingroup apf_iterators
+ **/
+template<typename I, typename Out>
+Out copy(circular_iterator<I> first, circular_iterator<I> last, Out result)
+{
+  auto spans = first.spans(last - first);
+  result = std::copy(spans.first.begin(), spans.first.end(), result);
+  return std::copy(spans.second.begin(), spans.second.end(), result);
+}
+
+/** Transform a range of a circular_iterator in (at most) two contiguous parts.
+ * This does the same as @c std::transform(), but without a wrap-around check
+ * for each element.
+ * @see apf::copy(), circular_iterator::spans()
+ * @ingroup apf_iterators
+ **/
+template<typename I, typename Out, typename F>
+Out transform(circular_iterator<I> first, circular_iterator<I> last
+    , Out result, F f)
+{
+  auto spans = first.spans(last - first);
+  result = std::transform(spans.first.begin(), spans.first.end(), result, f);
+  return std::transform(spans.second.begin(), spans.second.end(), result, f);
+}
+
 /** Iterator adaptor with a function call at dereferenciation.
  * @tparam I type of base iterator
  * @tparam F Unary function object which takes an @p I::value_type.
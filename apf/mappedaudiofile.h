@@ -0,0 +1,353 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Memory-mapped reading of uncompressed floating point audio files.
+
+#ifndef APF_MAPPEDAUDIOFILE_H
+#define APF_MAPPEDAUDIOFILE_H
+
+#include <cstdint>  // for uint8_t, uint16_t, uint32_t, uint64_t
+#include <cstring>  // for std::memcmp()
+#include <stdexcept>  // for std::logic_error
+#include <string>
+
+#include <fcntl.h>  // for open()
+#include <sys/mman.h>  // for mmap(), munmap(), madvise()
+#include <sys/stat.h>  // for fstat()
+#include <unistd.h>  // for close()
+
+#include "apf/iterator.h"  // for stride_iterator, has_begin_and_end
+#include "apf/misc.h"  // for NonCopyable
+
+namespace apf
+{
+
+/** Read-only memory-mapped audio file with 32-bit float samples.
+ * The whole file is mapped into memory, no data is copied. The kernel is
+ * advised to read ahead sequentially.
+ *
+ * Supported file types:
+ * - WAV and RF64 with IEEE float samples (also as WAVE_FORMAT_EXTENSIBLE)
+ * - CAF with little-endian float samples
+ * - RAW (headerless) files, see MappedAudioFile(const std::string&, size_t,
+ *   size_t, size_t)
+ *
+ * The interleaved data (see data() and block()) can be used directly with
+ * interleaved_policy::audio_callback(), single channels can be accessed with
+ * channel(). If a file has only one channel, its data can also be used with
+ * pointer_policy.
+ * @attention Only little-endian hosts are supported.
+ **/
+class MappedAudioFile : NonCopyable
+{
+  public:
+    using channel_type = has_begin_and_end<stride_iterator<const float*>>;
+
+    explicit MappedAudioFile(const std::string& name);
+    MappedAudioFile(const std::string& name, size_t channels
+        , size_t sample_rate, size_t header_bytes = 0);
+    ~MappedAudioFile();
+
+    size_t channels() const { return _channels; }
+    size_t sample_rate() const { return _sample_rate; }
+    size_t frames() const { return _frames; }
+
+    /// Interleaved sample data
+    const float* data() const { return _data; }
+
+    /// Interleaved data, starting at @p frame.
+    const float* block(size_t frame) const
+    {
+      return _data + frame * _channels;
+    }
+
+    /// Strided view of one channel.
+    channel_type channel(size_t c) const
+    {
+      auto begin = stride_iterator<const float*>(_data + c
+          , static_cast<std::ptrdiff_t>(_channels));
+      return channel_type(begin, static_cast<std::ptrdiff_t>(_frames));
+    }
+
+    /// Ask the kernel to load a range of frames ahead of time.
+    void will_need(size_t first_frame, size_t frames) const
+    {
+      _advise(first_frame, frames, MADV_WILLNEED);
+    }
+
+    /// Tell the kernel that a range of frames isn't needed anymore.
+    void dont_need(size_t first_frame, size_t frames) const
+    {
+      _advise(first_frame, frames, MADV_DONTNEED);
+    }
+
+  private:
+    void _map(const std::string& name);
+    void _parse_wav();
+    void _parse_caf();
+    void _set_data(size_t offset, size_t bytes);
+    void _advise(size_t first_frame, size_t frames, int advice) const;
+
+    [[noreturn]] void _error(const std::string& message) const
+    {
+      throw std::logic_error("apf::MappedAudioFile: \"" + _name + "\": "
+          + message);
+    }
+
+    bool _id(size_t offset, const char* id) const
+    {
+      return offset + 4 <= _size && std::memcmp(_bytes + offset, id, 4) == 0;
+    }
+
+    /// Read unsigned integer with @p n bytes (little-endian)
+    uint64_t _le(size_t offset, size_t n) const
+    {
+      if (offset + n > _size) _error("unexpected end of file!");
+      uint64_t result = 0;
+      for (size_t i = n; i > 0; --i)
+      {
+        result = (result << 8) | _bytes[offset + i - 1];
+      }
+      return result;
+    }
+
+    /// Read unsigned integer with @p n bytes (big-endian)
+    uint64_t _be(size_t offset, size_t n) const
+    {
+      if (offset + n > _size) _error("unexpected end of file!");
+      uint64_t result = 0;
+      for (size_t i = 0; i < n; ++i)
+      {
+        result = (result << 8) | _bytes[offset + i];
+      }
+      return result;
+    }
+
+    std::string _name;
+    const uint8_t* _bytes = nullptr;
+    size_t _size = 0;
+    size_t _channels = 0;
+    size_t _sample_rate = 0;
+    size_t _frames = 0;
+    const float* _data = nullptr;
+};
+
+/** Open WAV, RF64 or CAF file.
+ * @param name file name
+ * @throw std::logic_error if the file can't be mapped or if its format is not
+ *   supported
+ **/
+inline MappedAudioFile::MappedAudioFile(const std::string& name)
+  : _name(name)
+{
+  _map(name);
+  try
+  {
+    if ((_id(0, "RIFF") || _id(0, "RF64")) && _id(8, "WAVE")) _parse_wav();
+    else if (_id(0, "caff")) _parse_caf();
+    else _error("unknown file type!");
+  }
+  catch (...)
+  {
+    munmap(const_cast<uint8_t*>(_bytes), _size);
+    throw;
+  }
+}
+
+/** Open RAW file with interleaved 32-bit float samples.
+ * @param name file name
+ * @param channels number of channels
+ * @param sample_rate sample rate
+ * @param header_bytes number of bytes to skip at the beginning of the file
+ * @throw std::logic_error if the file can't be mapped
+ **/
+inline MappedAudioFile::MappedAudioFile(const std::string& name
+    , size_t channels, size_t sample_rate, size_t header_bytes)
+  : _name(name)
+  , _channels(channels)
+  , _sample_rate(sample_rate)
+{
+  if (channels == 0) _error("number of channels must not be zero!");
+  _map(name);
+  try
+  {
+    if (header_bytes > _size) _error("file is too short!");
+    _set_data(header_bytes, _size - header_bytes);
+  }
+  catch (...)
+  {
+    munmap(const_cast<uint8_t*>(_bytes), _size);
+    throw;
+  }
+}
+
+inline MappedAudioFile::~MappedAudioFile()
+{
+  munmap(const_cast<uint8_t*>(_bytes), _size);
+}
+
+inline void
+MappedAudioFile::_map(const std::string& name)
+{
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd == -1) _error("couldn't be opened!");
+
+  struct stat info;
+  if (fstat(fd, &info) == -1 || info.st_size == 0)
+  {
+    close(fd);
+    _error("couldn't determine size (or file is empty)!");
+  }
+  _size = static_cast<size_t>(info.st_size);
+
+  void* address = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // the mapping stays valid
+  if (address == MAP_FAILED) _error("couldn't be mapped!");
+  _bytes = static_cast<const uint8_t*>(address);
+  madvise(address, _size, MADV_SEQUENTIAL);
+}
+
+inline void
+MappedAudioFile::_parse_wav()
+{
+  const bool rf64 = _id(0, "RF64");
+  uint64_t rf64_data_size = 0;
+  bool fmt_found = false;
+
+  for (size_t offset = 12; offset + 8 <= _size; )
+  {
+    auto chunk_size = _le(offset + 4, 4);
+    auto chunk = offset + 8;
+
+    if (_id(offset, "ds64"))
+    {
+      rf64_data_size = _le(chunk + 8, 8);
+    }
+    else if (_id(offset, "fmt "))
+    {
+      auto format = _le(chunk, 2);
+      if (format == 0xFFFE)  // WAVE_FORMAT_EXTENSIBLE: use sub-format
+      {
+        format = _le(chunk + 24, 2);
+      }
+      if (format != 3 || _le(chunk + 14, 2) != 32)
+      {
+        _error("only 32-bit IEEE float WAV files are supported!");
+      }
+      _channels = static_cast<size_t>(_le(chunk + 2, 2));
+      _sample_rate = static_cast<size_t>(_le(chunk + 4, 4));
+      fmt_found = true;
+    }
+    else if (_id(offset, "data"))
+    {
+      if (!fmt_found) _error("\"data\" chunk before \"fmt \" chunk!");
+      if (rf64 && chunk_size == 0xFFFFFFFF) chunk_size = rf64_data_size;
+      // Truncated files are allowed, only complete frames are used
+      if (chunk + chunk_size > _size) chunk_size = _size - chunk;
+      _set_data(chunk, static_cast<size_t>(chunk_size));
+      return;
+    }
+    offset = chunk + static_cast<size_t>(chunk_size) + (chunk_size & 1);
+  }
+  _error("no \"data\" chunk found!");
+}
+
+inline void
+MappedAudioFile::_parse_caf()
+{
+  bool desc_found = false;
+
+  for (size_t offset = 8; offset + 12 <= _size; )
+  {
+    auto chunk_size = _be(offset + 4, 8);
+    auto chunk = offset + 12;
+
+    if (_id(offset, "desc"))
+    {
+      uint64_t sample_rate_bits = _be(chunk, 8);
+      double sample_rate;
+      std::memcpy(&sample_rate, &sample_rate_bits, sizeof(sample_rate));
+      const uint64_t float_flag = 1, little_endian_flag = 2;
+      auto flags = _be(chunk + 12, 4);
+      if (!_id(chunk + 8, "lpcm") || !(flags & float_flag)
+          || !(flags & little_endian_flag) || _be(chunk + 28, 4) != 32)
+      {
+        _error("only little-endian 32-bit float CAF files are supported!");
+      }
+      _channels = static_cast<size_t>(_be(chunk + 24, 4));
+      _sample_rate = static_cast<size_t>(sample_rate);
+      desc_found = true;
+    }
+    else if (_id(offset, "data"))
+    {
+      if (!desc_found) _error("\"data\" chunk before \"desc\" chunk!");
+      // The first 4 bytes contain the "edit count".
+      // The size -1 means "until the end of the file".
+      if (chunk_size == uint64_t(-1) || chunk + chunk_size > _size)
+      {
+        chunk_size = _size - chunk;
+      }
+      if (chunk_size < 4) _error("\"data\" chunk is too short!");
+      _set_data(chunk + 4, static_cast<size_t>(chunk_size) - 4);
+      return;
+    }
+    offset = chunk + static_cast<size_t>(chunk_size);
+  }
+  _error("no \"data\" chunk found!");
+}
+
+inline void
+MappedAudioFile::_set_data(size_t offset, size_t bytes)
+{
+  if (_channels == 0) _error("number of channels must not be zero!");
+  if (offset % alignof(float) != 0)
+  {
+    _error("sample data is not aligned!");
+  }
+  _data = reinterpret_cast<const float*>(_bytes + offset);
+  _frames = bytes / (sizeof(float) * _channels);
+}
+
+inline void
+MappedAudioFile::_advise(size_t first_frame, size_t frames, int advice) const
+{
+  if (first_frame >= _frames) return;
+  if (frames > _frames - first_frame) frames = _frames - first_frame;
+
+  // madvise() needs a page-aligned address
+  auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto begin = reinterpret_cast<const uint8_t*>(this->block(first_frame));
+  auto end = begin + frames * _channels * sizeof(float);
+  auto offset = static_cast<size_t>(begin - _bytes) % page_size;
+  begin -= offset;
+  madvise(const_cast<uint8_t*>(begin), static_cast<size_t>(end - begin)
+      , advice);
+}
+
+}  // namespace apf
+
+#endif
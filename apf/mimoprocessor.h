@@ -30,9 +30,13 @@
 #ifndef APF_MIMOPROCESSOR_H
 #define APF_MIMOPROCESSOR_H
 
+#include <algorithm>  // for std::sort(), std::lower_bound()
+#include <atomic>
 #include <cassert>  // for assert()
 #include <mutex>
 #include <stdexcept>  // for std::logic_error
+#include <utility>  // for std::pair
+#include <vector>
 
 #include "apf/rtlist.h"
 #include "apf/parameter_map.h"
@@ -40,9 +44,11 @@
 #include "apf/iterator.h" // for *_iterator, make_*_iterator(), cast_proxy_const
 #include "apf/container.h" // for fixed_vector
 #include "apf/threadtools.h" // for ScopedThread
+#include "apf/instrumentation.h" // for disable_instrumentation
+#include "apf/numa.h" // for numa_node_of_cpu()
 
-#define APF_MIMOPROCESSOR_TEMPLATES template<typename Derived, typename interface_policy, typename query_policy>
-#define APF_MIMOPROCESSOR_BASE MimoProcessor<Derived, interface_policy, query_policy>
+#define APF_MIMOPROCESSOR_TEMPLATES template<typename Derived, typename interface_policy, typename query_policy, typename instrumentation_policy>
+#define APF_MIMOPROCESSOR_BASE MimoProcessor<Derived, interface_policy, query_policy, instrumentation_policy>
 
 /** Macro to create a @c Process struct and a corresponding member function.
  * @param name Name of the containing class
@@ -189,14 +195,19 @@ class disable_queries
  * @tparam Derived Your derived class -> CRTP!
  * @tparam interface_policy Policy class. You can use existing policies (e.g.
  *   jack_policy, pointer_policy<T*>) or write your own policy class.
+ * @tparam query_policy enable_queries or disable_queries
+ * @tparam instrumentation_policy enable_instrumentation or
+ *   disable_instrumentation
  *
  * Example: @ref MimoProcessor
  **/
 template<typename Derived
   , typename interface_policy
-  , typename query_policy = disable_queries>
+  , typename query_policy = disable_queries
+  , typename instrumentation_policy = disable_instrumentation>
 class MimoProcessor : public interface_policy
                     , public query_policy
+                    , public instrumentation_policy
                     , public CRTP<Derived>
                     , NonCopyable
 {
@@ -215,6 +226,14 @@ class MimoProcessor : public interface_policy
 
       /// to be overwritten in the derived class
       virtual void process() = 0;
+
+      /// Estimated processing cost relative to other items.
+      /// This is used by balance_threads() if no measurements are available.
+      std::atomic<float> cost{1.0f};
+
+      /// Thread which processes this item, assigned by balance_threads().
+      /// -1 means round-robin assignment.  Only used in the audio thread(s).
+      int thread = -1;
     };
 
     /** Base class for items which have a @c Process class.
@@ -243,6 +262,22 @@ class MimoProcessor : public interface_policy
       }
     };
 
+    /** Base class for work which is shared among all threads.
+     * Unlike an Item, which is processed by one thread, a SplitItem is
+     * processed by all threads at once, each of them doing one part.
+     * This is useful for single tasks which are too expensive for one thread,
+     * e.g. a convolution with a very long filter (see conv::OutputBase).
+     * @see _process_split()
+     **/
+    struct SplitItem : NonCopyable
+    {
+      virtual ~SplitItem() = default;
+
+      /// Process part number @p part of @p parts (which is the number of
+      /// threads). All parts are processed concurrently.
+      virtual void process(unsigned part, unsigned parts) = 0;
+    };
+
     using rtlist_t = RtList<Item*>;
 
     /// Proxy class for accessing an RtList.
@@ -334,6 +369,41 @@ class MimoProcessor : public interface_policy
 
     unsigned threads() const { return _num_threads; }
 
+    /** CPU of a thread, given by the parameter "cpus" (e.g. "0-3,8").
+     * Worker thread @p n is pinned to the @p n-th CPU of the list (wrapping
+     * around if the list is shorter than the number of threads).
+     * Thread 0 is the audio thread of the interface_policy, it is not
+     * pinned, but it is assumed to run on the first CPU of the list.
+     * @return CPU number or -1 if no CPUs were given.
+     **/
+    int thread_cpu(unsigned thread) const
+    {
+      return _cpus.empty() ? -1
+        : static_cast<int>(_cpus[thread % _cpus.size()]);
+    }
+
+    /// NUMA node of a thread (see thread_cpu()), -1 if unknown.
+    /// Use this with numa_allocator (or e.g. the @c numa_node parameter of
+    /// conv::Convolver) to allocate item buffers locally to the thread given
+    /// by Item::thread.
+    int thread_node(unsigned thread) const
+    {
+      auto cpu = this->thread_cpu(thread);
+      return cpu < 0 ? -1 : numa_node_of_cpu(static_cast<unsigned>(cpu));
+    }
+
+    /** Re-distribute the items of the input and output list among the
+     * threads, based on their cost.  See _balance_threads().
+     * This blocks until the audio thread has processed one block.
+     * @param min_improvement minimum relative improvement of the most loaded
+     *   thread which is necessary to actually change the assignment.
+     * @return @b true if any item was assigned to a new thread.
+     **/
+    bool balance_threads(double min_improvement = 0.05)
+    {
+      return _balance_threads({&_input_list, &_output_list}, min_improvement);
+    }
+
     // TODO: make private?
     const parameter_map params;
 
@@ -357,6 +427,10 @@ class MimoProcessor : public interface_policy
 
     void _process_list(rtlist_t& l);
     void _process_list(rtlist_t& l1, rtlist_t& l2);
+    void _process_split(SplitItem& item);
+
+    bool _balance_threads(const std::vector<rtlist_t*>& lists
+        , double min_improvement);
 
     CommandQueue _fifo;
 
@@ -373,6 +447,14 @@ class MimoProcessor : public interface_policy
           thread_traits<interface_policy
             , std::thread::native_handle_type>::update_priority(parent
                 , _thread.native_handle());
+
+          // Errors are ignored, like in update_priority()
+          auto cpu = parent.thread_cpu(thread_number);
+          if (cpu >= 0)
+          {
+            set_thread_affinity(_thread.native_handle()
+                , static_cast<unsigned>(cpu));
+          }
         }
 
         WorkerThread(WorkerThread&& other)
@@ -419,14 +501,35 @@ class MimoProcessor : public interface_policy
 
     class Xput;
 
+    /// Cost and current thread of an item, collected in the audio thread
+    struct item_snapshot
+    {
+      const Item* item;
+      size_t list;  ///< index of list
+      double estimated;  ///< Item::cost
+      double measured;  ///< negative if not available
+      unsigned thread;
+      double cost;  ///< measured or (scaled) estimated cost
+    };
+
+    class SnapshotCommand;
+    class AssignCommand;
+
     // This is called from the interface_policy
     virtual void process()
     {
+      this->_instrument_block_begin();
       _fifo.process_commands();
+      this->_instrument_stage_end(instrumentation_stage::commands);
       _process_list(_input_list);
+      this->_instrument_stage_end(instrumentation_stage::inputs);
       typename Derived::Process(this->derived());
+      this->_instrument_stage_end(instrumentation_stage::process);
       _process_list(_output_list);
+      this->_instrument_stage_end(instrumentation_stage::outputs);
       this->process_query_commands();
+      this->_instrument_stage_end(instrumentation_stage::queries);
+      this->_instrument_block_end();
     }
 
     void _process_current_list_in_main_thread();
@@ -437,10 +540,13 @@ class MimoProcessor : public interface_policy
 
     // TODO: make "volatile"?
     rtlist_t* _current_list;
+    SplitItem* _current_split;  ///< if non-null, _current_list is ignored
 
     /// Number of threads (main thread plus worker threads)
     const unsigned _num_threads;
 
+    const std::vector<unsigned> _cpus;  ///< see thread_cpu()
+
     fixed_vector<WorkerThread> _thread_data;
 
     rtlist_t _input_list, _output_list;
@@ -451,10 +557,13 @@ APF_MIMOPROCESSOR_TEMPLATES
 APF_MIMOPROCESSOR_BASE::MimoProcessor(const parameter_map& params_)
   : interface_policy(params_)
   , query_policy()
+  , instrumentation_policy()
   , params(params_)
   , _fifo(params.get("fifo_size", size_t(1024)))
   , _current_list(nullptr)
+  , _current_split(nullptr)
   , _num_threads(params.get("threads", std::thread::hardware_concurrency()))
+  , _cpus(parse_cpu_list(params.get("cpus", "")))
   , _input_list(_fifo)
   , _output_list(_fifo)
 {
@@ -469,6 +578,9 @@ APF_MIMOPROCESSOR_BASE::MimoProcessor(const parameter_map& params_)
   {
     _thread_data.emplace_back(i, *this);
   }
+
+  this->_instrumentation_init(static_cast<const interface_policy&>(*this)
+      , _num_threads, params);
 }
 
 APF_MIMOPROCESSOR_TEMPLATES
@@ -500,22 +612,239 @@ APF_MIMOPROCESSOR_BASE::_process_list(rtlist_t& l1, rtlist_t& l2)
   // not exception-safe (original lists are not restored), but who cares?
 }
 
+/** Process @p item in all threads, the calling thread being thread 0.
+ * This blocks until all parts are finished, successive calls are therefore
+ * separated by a barrier.
+ * @note This must only be called from the main audio thread outside of list
+ *   processing, e.g. in Derived::Process.
+ **/
+APF_MIMOPROCESSOR_TEMPLATES
+void
+APF_MIMOPROCESSOR_BASE::_process_split(SplitItem& item)
+{
+  _current_split = &item;
+
+  // wake all threads
+  for (auto& it: _thread_data) it.cont_semaphore.post();
+
+  _process_selected_items_in_current_list(0);
+
+  // wait for worker threads
+  for (auto& it: _thread_data) it.wait_semaphore.wait();
+
+  _current_split = nullptr;
+}
+
 APF_MIMOPROCESSOR_TEMPLATES
 void
 APF_MIMOPROCESSOR_BASE::_process_selected_items_in_current_list(
     unsigned thread_number)
 {
+  auto thread_start = this->_instrument_thread_begin();
+
+  if (_current_split)
+  {
+    _current_split->process(thread_number, _num_threads);
+    this->_instrument_thread_end(thread_number, thread_start);
+    return;
+  }
+
   assert(_current_list);
 
   unsigned n = 0;
   for (auto& i: *_current_list)
   {
-    if (thread_number == n++ % _num_threads)
+    assert(i);
+    auto round_robin = n++ % _num_threads;
+    if (thread_number == (i->thread < 0
+          ? round_robin : static_cast<unsigned>(i->thread)))
     {
-      assert(i);
+      auto item_start = this->_instrument_item_begin();
       i->process();
+      this->_instrument_item_end(thread_number, i, item_start);
+    }
+  }
+
+  this->_instrument_thread_end(thread_number, thread_start);
+}
+
+/// Collect costs and current thread numbers of all items in the audio thread.
+/// Nothing is collected if there are more than @c capacity() items.
+APF_MIMOPROCESSOR_TEMPLATES
+class APF_MIMOPROCESSOR_BASE::SnapshotCommand : public CommandQueue::Command
+{
+  public:
+    SnapshotCommand(MimoProcessor& parent
+        , const std::vector<rtlist_t*>& lists
+        , std::vector<item_snapshot>& snapshot, size_t& required)
+      : _parent(parent)
+      , _lists(lists)
+      , _snapshot(snapshot)
+      , _required(required)
+    {}
+
+    virtual void execute()
+    {
+      _required = 0;
+      for (const auto* l: _lists) _required += l->size();
+      if (_required > _snapshot.capacity()) return;  // no allocation here!
+
+      for (size_t l = 0; l < _lists.size(); ++l)
+      {
+        unsigned n = 0;
+        for (const auto* i: *_lists[l])
+        {
+          auto round_robin = n++ % _parent._num_threads;
+          auto measured = _parent._item_cost_measurement(i);
+          _snapshot.push_back({i, l, i->cost.load(std::memory_order_relaxed)
+              , measured, i->thread < 0
+              ? round_robin : static_cast<unsigned>(i->thread), 0.0});
+        }
+      }
+    }
+
+    virtual void cleanup() {}
+
+  private:
+    MimoProcessor& _parent;
+    const std::vector<rtlist_t*>& _lists;
+    std::vector<item_snapshot>& _snapshot;
+    size_t& _required;
+};
+
+/// Assign new thread numbers to items in the audio thread.
+/// Items which were removed in the meantime are not in the lists anymore and
+/// therefore they are never dereferenced.
+APF_MIMOPROCESSOR_TEMPLATES
+class APF_MIMOPROCESSOR_BASE::AssignCommand : public CommandQueue::Command
+{
+  public:
+    /// @param assignment must be sorted by item address
+    AssignCommand(const std::vector<rtlist_t*>& lists
+        , std::vector<std::pair<const Item*, int>>&& assignment)
+      : _lists(lists)
+      , _assignment(std::move(assignment))
+    {}
+
+    virtual void execute()
+    {
+      for (auto* l: _lists)
+      {
+        for (auto* i: *l)
+        {
+          auto it = std::lower_bound(_assignment.begin(), _assignment.end()
+              , std::make_pair(static_cast<const Item*>(i), -1));
+          if (it != _assignment.end() && it->first == i) i->thread = it->second;
+        }
+      }
+    }
+
+    virtual void cleanup() {}
+
+  private:
+    std::vector<rtlist_t*> _lists;
+    std::vector<std::pair<const Item*, int>> _assignment;
+};
+
+/** Distribute the items of several lists among the threads.
+ * Each list is balanced separately, because each list is processed
+ * separately.  Use this in your derived class if you have additional lists.
+ *
+ * The cost of each item is measured if enable_item_profiling is used, else
+ * the estimated Item::cost is used (it can also be given with the parameter
+ * "cost" when creating an Input or Output).  Items without measurements
+ * get the estimated cost scaled to the measured items.
+ *
+ * The items are assigned greedily to the least loaded thread, in order of
+ * decreasing cost ("longest processing time first").  If the NUMA nodes of
+ * the threads are known (see thread_node()), items are only moved between
+ * threads of the same node, so that their data stays local.  The new assignment is
+ * only used if it reduces the cost of the most loaded thread by at least
+ * @p min_improvement (relative), to avoid needless moving of items between
+ * threads (and their caches).
+ * @return @b true if any item was assigned to a new thread.
+ **/
+APF_MIMOPROCESSOR_TEMPLATES
+bool
+APF_MIMOPROCESSOR_BASE::_balance_threads(const std::vector<rtlist_t*>& lists
+    , double min_improvement)
+{
+  if (_num_threads < 2) return false;
+
+  std::vector<item_snapshot> snapshot;
+  size_t required = 0;
+  do
+  {
+    snapshot.clear();
+    snapshot.reserve(required + 16);
+    _fifo.push(new SnapshotCommand(*this, lists, snapshot, required));
+    _fifo.wait();
+  }
+  while (required > snapshot.capacity());
+
+  // Scale estimated costs to measured ones
+  double measured_cost = 0, estimated_cost = 0;
+  for (const auto& s: snapshot)
+  {
+    if (s.measured < 0) continue;
+    measured_cost += s.measured;
+    estimated_cost += s.estimated;
+  }
+  auto scale = estimated_cost > 0 ? measured_cost / estimated_cost : 1.0;
+  for (auto& s: snapshot)
+  {
+    s.cost = s.measured < 0 ? s.estimated * scale : s.measured;
+  }
+
+  std::vector<std::pair<const Item*, int>> assignment;
+  bool changed = false;
+  for (size_t l = 0; l < lists.size(); ++l)
+  {
+    std::vector<item_snapshot*> items;
+    std::vector<double> old_load(_num_threads), new_load(_num_threads);
+    for (auto& s: snapshot)
+    {
+      if (s.list != l) continue;
+      items.push_back(&s);
+      old_load[s.thread] += s.cost;
+    }
+    std::sort(items.begin(), items.end()
+        , [](const item_snapshot* a, const item_snapshot* b)
+        {
+          return a->cost > b->cost;
+        });
+    std::vector<unsigned> new_thread;
+    for (const auto* s: items)
+    {
+      // Items stay on the NUMA node of their current thread (if known)
+      auto node = this->thread_node(s->thread);
+      unsigned least = _num_threads;
+      for (unsigned t = 0; t < _num_threads; ++t)
+      {
+        if (node >= 0 && this->thread_node(t) != node) continue;
+        if (least == _num_threads || new_load[t] < new_load[least]) least = t;
+      }
+      new_load[least] += s->cost;
+      new_thread.push_back(least);
+    }
+    auto old_max = *std::max_element(old_load.begin(), old_load.end());
+    auto new_max = *std::max_element(new_load.begin(), new_load.end());
+    if (new_max >= old_max * (1.0 - min_improvement)) continue;
+
+    // All items of the list are pinned to their thread, even if it doesn't
+    // change, to keep them there if other items are added or removed.
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+      if (new_thread[i] != items[i]->thread) changed = true;
+      assignment.emplace_back(items[i]->item, static_cast<int>(new_thread[i]));
     }
   }
+
+  if (!changed) return false;
+
+  std::sort(assignment.begin(), assignment.end());
+  _fifo.push(new AssignCommand(lists, std::move(assignment)));
+  return true;
 }
 
 APF_MIMOPROCESSOR_TEMPLATES
@@ -561,7 +890,14 @@ class APF_MIMOPROCESSOR_BASE::Xput : public APF_MIMOPROCESSOR_BASE::Item
       : parent(*(p.parent
             ? p.parent
             : throw std::logic_error("Bug: In/Output: parent == 0!")))
-    {}
+    {
+      this->cost = p.get("cost", 1.0f);
+      this->thread = p.get("thread", -1);
+      if (this->thread >= static_cast<int>(parent.threads()))
+      {
+        throw std::logic_error("In/Output: invalid thread number!");
+      }
+    }
 };
 
 /// %Input class.
@@ -29,41 +29,53 @@
 
 #include <sndfile.hh>  // C++ interface to libsndfile
 #include <iostream>
+#include <sstream>  // for std::ostringstream
+#include <vector>
 
-#include "stopwatch.h"
-#include "apf/container.h"  // for fixed_matrix
+#include "apf/file_io_pipeline.h"
 
 namespace apf
 {
 
 /// Use MimoProcessor-based object with multichannel audio file input and output
+/// Reading, processing and writing is done in a pipeline, see
+/// file_io_pipeline().
 /// @param processor Object derived from MimoProcessor
 /// @param infilename Input audio file name
 /// @param outfilename Output audio file name (will be overwritten if it exists)
+/// @param[out] statistics Throughput of the processing
+/// @param log All messages are written to this stream
+/// @param queue_depth Number of blocks in the ring (at least 2)
+/// @return 0 on success
+/// @throw anything that's thrown by the processor (after the reader and writer
+///   threads have been stopped)
 template<typename Processor>
 int mimoprocessor_file_io(Processor& processor
     , const std::string& infilename
-    , const std::string& outfilename)
+    , const std::string& outfilename
+    , file_io_statistics& statistics
+    , std::ostream& log
+    , size_t queue_depth = 4)
 {
-  std::cout << "Opening file \"" << infilename << "\" ..." << std::endl;
+  log << "Opening file \"" << infilename << "\" ..." << std::endl;
 
   auto in = SndfileHandle(infilename, SFM_READ);
 
   if (int err = in.error())
   {
-    std::cout << in.strError() << std::endl;
+    log << in.strError() << std::endl;
     return err;
   }
 
   if (in.samplerate() != static_cast<int>(processor.sample_rate()))
   {
-    std::cout << "Samplerate mismatch!" << std::endl;
+    log << "Samplerate mismatch!" << std::endl;
     return 42;
   }
 
   if (in.channels() != processor.in_channels())
   {
-    std::cout << "Input channel mismatch!" << std::endl;
+    log << "Input channel mismatch!" << std::endl;
     return 666;
   }
 
@@ -72,7 +84,7 @@ int mimoprocessor_file_io(Processor& processor
 
   if (int err = out.error())
   {
-    std::cout << out.strError() << std::endl;
+    log << out.strError() << std::endl;
     return err;
   }
 
@@ -80,46 +92,138 @@ int mimoprocessor_file_io(Processor& processor
   format_info.format = in.format();
   in.command(SFC_GET_FORMAT_INFO, &format_info, sizeof(format_info));
 
-  std::cout << "format: " << format_info.name << std::endl;
+  log << "format: " << format_info.name << std::endl;
 
-  std::cout << "frames: " << in.frames()
+  log << "frames: " << in.frames()
     << " (" << in.frames()/in.samplerate() << " seconds)" << std::endl;
-  std::cout << "channels: " << in.channels() << std::endl;
-  std::cout << "samplerate: " << in.samplerate() << std::endl;
+  log << "channels: " << in.channels() << std::endl;
+  log << "samplerate: " << in.samplerate() << std::endl;
+
+  file_io_pipeline(processor
+      , [&in] (float* data, size_t frames)
+        {
+          return size_t(in.readf(data, static_cast<sf_count_t>(frames)));
+        }
+      , [&out] (const float* data, size_t frames)
+        {
+          out.writef(data, static_cast<sf_count_t>(frames));
+        }
+      , statistics, queue_depth);
 
-  auto blocksize = processor.block_size();
-
-  // these matrices are used for de-interleaving and interleaving
-  fixed_matrix<float> m_in(blocksize, size_t(in.channels()));
-  fixed_matrix<float> m_in_transpose(size_t(in.channels()), blocksize);
-  fixed_matrix<float> m_out(blocksize, size_t(processor.out_channels()));
-  fixed_matrix<float> m_out_transpose(
-      size_t(processor.out_channels()), blocksize);
+  //out.writeSync();  // write cache buffers to disk
 
-  processor.activate();
+  return 0;
+}
 
-  StopWatch watch("processing");
 
-  sf_count_t actual_frames = 0;
-  while ((actual_frames = in.readf(m_in.data()
-          , static_cast<sf_count_t>(blocksize))) != 0)
+/// Use MimoProcessor-based object with multichannel audio file input and output
+/// Messages and statistics are written to @c std::cout.
+/// @see mimoprocessor_file_io(Processor&, const std::string&
+///   , const std::string&, file_io_statistics&, std::ostream&, size_t)
+template<typename Processor>
+int mimoprocessor_file_io(Processor& processor
+    , const std::string& infilename
+    , const std::string& outfilename
+    , size_t queue_depth = 4)
+{
+  auto statistics = file_io_statistics();
+  int result = mimoprocessor_file_io(processor, infilename, outfilename
+      , statistics, std::cout, queue_depth);
+  if (result == 0)
   {
-    m_in_transpose.set_channels(m_in.slices);
+    std::cout << statistics.blocks << " blocks in " << statistics.seconds
+      << " seconds (" << statistics.blocks_per_second()
+      << " blocks/second, realtime factor " << statistics.realtime_factor()
+      << ")" << std::endl;
+  }
+  return result;
+}
 
-    processor.audio_callback(blocksize
-        , m_in_transpose.get_channel_ptrs()
-        , m_out_transpose.get_channel_ptrs());
+/// One file for mimoprocessor_batch_file_io()
+struct batch_file_io_job
+{
+  batch_file_io_job(const std::string& in, const std::string& out)
+    : infilename(in)
+    , outfilename(out)
+  {}
+
+  std::string infilename;
+  std::string outfilename;
+  int result = -1;  ///< Return value of mimoprocessor_file_io()
+  std::string log;  ///< Messages of mimoprocessor_file_io()
+  file_io_statistics statistics;
+};
+
+/** Process many files in parallel, one processor per worker thread.
+ * The processors are created once, one after another in the calling thread
+ * (e.g. FFTW planning is not thread-safe), before the workers are started.
+ * Each worker uses its processor for all of its files, so expensive
+ * initialization (FFTW plans, loading filters, ...) is only done once per
+ * worker. The files are distributed dynamically, an idle worker takes the
+ * next unprocessed file.
+ * @param factory Function object which returns a (smart) pointer to a new,
+ *   fully initialized processor. It is called @p workers times in the
+ *   calling thread. Typically, the processors should use only one thread
+ *   each.
+ * @param jobs List of files. Results, messages and statistics are stored in
+ *   each job.
+ * @param workers Number of worker threads
+ * @param queue_depth see mimoprocessor_file_io()
+ * @return Wall-clock time in seconds
+ * @throw anything that's thrown by @p factory or by the processors
+ * @see print_batch_statistics(), internal::run_batch()
+ **/
+template<typename Factory>
+double mimoprocessor_batch_file_io(Factory factory
+    , std::vector<batch_file_io_job>& jobs, size_t workers
+    , size_t queue_depth = 4)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  internal::run_batch(factory, jobs.size(), workers
+      , [&jobs, queue_depth] (decltype(*factory())& processor, size_t i)
+      {
+        auto& job = jobs[i];
+        std::ostringstream log;
+        job.result = mimoprocessor_file_io(processor, job.infilename
+            , job.outfilename, job.statistics, log, queue_depth);
+        job.log = log.str();
+      });
+
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
 
-    m_out.set_channels(m_out_transpose.slices);
+/// Print results of mimoprocessor_batch_file_io().
+/// @param jobs List of processed files
+/// @param seconds Wall-clock time of the whole batch
+/// @param out Output stream
+inline void print_batch_statistics(const std::vector<batch_file_io_job>& jobs
+    , double seconds, std::ostream& out = std::cout)
+{
+  size_t failed = 0;
+  double audio_seconds = 0;
 
-    out.writef(m_out.data(), actual_frames);
+  for (const auto& job: jobs)
+  {
+    out << job.infilename << ": ";
+    if (job.result != 0)
+    {
+      ++failed;
+      out << "FAILED (" << job.result << ")\n" << job.log;
+      continue;
+    }
+    auto duration = double(job.statistics.frames)
+      / double(job.statistics.sample_rate);
+    audio_seconds += duration;
+    out << duration << " seconds of audio, realtime factor "
+      << job.statistics.realtime_factor() << "\n";
   }
 
-  //out.writeSync();  // write cache buffers to disk
-
-  processor.deactivate();
-
-  return 0;
+  out << jobs.size() << " files (" << failed << " failed) in " << seconds
+    << " seconds (" << double(jobs.size()) / seconds << " files/second)\n";
+  out << audio_seconds << " seconds of audio, overall realtime factor "
+    << audio_seconds / seconds << std::endl;
 }
 
 }  // namespace apf
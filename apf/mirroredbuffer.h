@@ -0,0 +1,198 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Ring buffer storage which is mapped twice into virtual memory.
+
+#ifndef APF_MIRROREDBUFFER_H
+#define APF_MIRROREDBUFFER_H
+
+#include <algorithm>  // for std::fill()
+#include <cstddef>  // for std::size_t, std::ptrdiff_t
+#include <type_traits>  // for std::is_trivially_copyable
+#include <vector>  // for fallback storage
+
+#if defined(__linux__) && !defined(APF_NO_MIRRORED_BUFFER)
+#define APF_MIRRORED_BUFFER_MMAP
+#include <sys/mman.h>  // for memfd_create(), mmap(), munmap()
+#include <unistd.h>  // for sysconf(), ftruncate(), close()
+#endif
+
+namespace apf
+{
+
+/** Fixed-size storage whose memory is mapped twice, back to back.
+ * The element at position @c size() + i is the same (in physical memory) as
+ * the element at position @c i, for @c i from 0 to <tt>size() - 1</tt>.
+ * Therefore, any range of at most size() elements starting within
+ * [begin(), end()) can be accessed with plain pointers, even if it "wraps
+ * around" the end.
+ *
+ * This can be used as @c Container for BlockDelayLine.
+ *
+ * If mirrored() returns @b false, the memory is not mapped twice, the buffer
+ * behaves like a fixed-size array and all wrap-around must be handled by the
+ * user. This happens if the operating system doesn't support it (currently
+ * only Linux is supported, it can be disabled with APF_NO_MIRRORED_BUFFER),
+ * if the mapping fails or if size() is not a multiple of granularity().
+ * @tparam T Trivially copyable element type
+ **/
+template<typename T>
+class MirroredBuffer
+{
+  static_assert(std::is_trivially_copyable<T>::value
+      , "MirroredBuffer only works with trivially copyable types!");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    explicit MirroredBuffer(size_type size);
+    ~MirroredBuffer();
+
+    MirroredBuffer(const MirroredBuffer&) = delete;
+    MirroredBuffer& operator=(const MirroredBuffer&) = delete;
+
+    iterator begin() const { return _begin; }
+    iterator end() const { return _begin + _size; }
+    pointer data() const { return _begin; }
+    size_type size() const { return _size; }
+    reference operator[](size_type n) const { return _begin[n]; }
+
+    /// @b true if the memory is actually mapped twice.
+    bool mirrored() const { return _mirrored; }
+
+    static size_type granularity();
+
+  private:
+    bool _map();
+
+    const size_type _size;
+    pointer _begin = nullptr;
+    bool _mirrored = false;
+    std::vector<T> _fallback;  ///< Only used if mapping is not possible
+};
+
+/** Constructor.
+ * All elements are initialized with @c T().
+ * @param size Number of elements, should be a multiple of granularity()
+ **/
+template<typename T>
+MirroredBuffer<T>::MirroredBuffer(size_type size)
+  : _size(size)
+{
+  if (this->_map())
+  {
+    std::fill(this->begin(), this->end(), T());
+  }
+  else
+  {
+    _fallback.resize(_size);
+    _begin = _fallback.data();
+  }
+}
+
+template<typename T>
+MirroredBuffer<T>::~MirroredBuffer()
+{
+#ifdef APF_MIRRORED_BUFFER_MMAP
+  if (_mirrored) munmap(_begin, 2 * _size * sizeof(T));
+#endif
+}
+
+/** Minimum number of elements for mirrored memory.
+ * The size must be a multiple of this.
+ * This corresponds to the page size of the virtual memory.
+ **/
+template<typename T>
+typename MirroredBuffer<T>::size_type
+MirroredBuffer<T>::granularity()
+{
+#ifdef APF_MIRRORED_BUFFER_MMAP
+  auto page_size = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+  auto n = size_type(1);
+  while ((n * sizeof(T)) % page_size != 0) n *= 2;
+  return n;
+#else
+  return 1;
+#endif
+}
+
+/** Create an anonymous file and map it twice into a reserved address range.
+ * @return @b true on success
+ **/
+template<typename T>
+bool
+MirroredBuffer<T>::_map()
+{
+#ifdef APF_MIRRORED_BUFFER_MMAP
+  const auto bytes = _size * sizeof(T);
+  if (bytes == 0 || _size % granularity() != 0) return false;
+
+  int fd = memfd_create("apf::MirroredBuffer", MFD_CLOEXEC);
+  if (fd == -1) return false;
+
+  void* address = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+  {
+    // Reserve address range for both copies
+    address = mmap(nullptr, 2 * bytes, PROT_NONE
+        , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  if (address != MAP_FAILED)
+  {
+    auto first = static_cast<char*>(address);
+    auto second = first + bytes;
+    if (mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED
+          , fd, 0) == MAP_FAILED
+        || mmap(second, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED
+          , fd, 0) == MAP_FAILED)
+    {
+      munmap(address, 2 * bytes);
+      address = MAP_FAILED;
+    }
+  }
+  close(fd);  // the mappings keep the memory alive
+  if (address == MAP_FAILED) return false;
+
+  _begin = static_cast<pointer>(address);
+  _mirrored = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace apf
+
+#endif
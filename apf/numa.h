@@ -0,0 +1,128 @@
+/******************************************************************************
+ Copyright (c) 2012-2016 Institut für Nachrichtentechnik, Universität Rostock
+ Copyright (c) 2006-2012 Quality & Usability Lab
+                         Deutsche Telekom Laboratories, TU Berlin
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*******************************************************************************/
+
+// https://AudioProcessingFramework.github.io/
+
+/// @file
+/// Helpers for NUMA (non-uniform memory access) systems.
+///
+/// Memory is only placed on specific NUMA nodes if APF_USE_NUMA is defined
+/// (this needs libnuma, link with @c -lnuma).  Otherwise, the default
+/// allocation is used and the Linux "first touch" policy applies.
+
+#ifndef APF_NUMA_H
+#define APF_NUMA_H
+
+#include <cstddef>  // for size_t
+#include <cstdlib>  // for posix_memalign(), free()
+#include <new>  // for std::bad_alloc
+#include <unistd.h>  // for sysconf()
+
+#ifdef APF_USE_NUMA
+#include <numa.h>
+#endif
+
+namespace apf
+{
+
+/// NUMA node of a CPU, -1 if unknown.
+inline int numa_node_of_cpu(unsigned cpu)
+{
+#ifdef APF_USE_NUMA
+  if (numa_available() < 0) return -1;
+  return ::numa_node_of_cpu(static_cast<int>(cpu));
+#else
+  (void)cpu;
+  return -1;
+#endif
+}
+
+/** Allocator which places memory on a given NUMA node.
+ * With a negative node number (or without APF_USE_NUMA, or if NUMA is not
+ * available), page-aligned memory is allocated with @c posix_memalign().
+ * @note The memory is always page-aligned (and therefore also suitable for
+ *   SIMD and FFTW), this is only sensible for large buffers (e.g. delay lines
+ *   or convolution spectra).
+ **/
+template<typename T>
+struct numa_allocator
+{
+  using value_type = T;
+
+  explicit numa_allocator(int node_ = -1) noexcept : node(node_) {}
+
+  template<typename U>
+  numa_allocator(const numa_allocator<U>& other) noexcept : node(other.node) {}
+
+  T* allocate(size_t n)
+  {
+#ifdef APF_USE_NUMA
+    if (this->node >= 0 && numa_available() >= 0)
+    {
+      auto p = numa_alloc_onnode(n * sizeof(T), this->node);
+      if (!p) throw std::bad_alloc();
+      return static_cast<T*>(p);
+    }
+#endif
+    void* p = nullptr;
+    if (posix_memalign(&p, static_cast<size_t>(sysconf(_SC_PAGESIZE))
+          , n * sizeof(T)) != 0)
+    {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t n) noexcept
+  {
+#ifdef APF_USE_NUMA
+    if (this->node >= 0 && numa_available() >= 0)
+    {
+      numa_free(p, n * sizeof(T));
+      return;
+    }
+#else
+    (void)n;
+#endif
+    free(p);
+  }
+
+  int node;  ///< NUMA node, -1 means no specific node
+};
+
+template<typename T, typename U>
+bool operator==(const numa_allocator<T>& a, const numa_allocator<U>& b)
+{
+  return a.node == b.node;
+}
+
+template<typename T, typename U>
+bool operator!=(const numa_allocator<T>& a, const numa_allocator<U>& b)
+{
+  return !(a == b);
+}
+
+}  // namespace apf
+
+#endif
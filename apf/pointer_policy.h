@@ -31,6 +31,8 @@
 #define APF_POINTER_POLICY_H
 
 #include <cassert>  // for assert()
+#include <algorithm>  // for std::copy()
+#include <vector>
 #include "apf/parameter_map.h"
 #include "apf/iterator.h"  // for has_begin_and_end
 
@@ -59,6 +61,7 @@ class pointer_policy<T*>
     class Output;
 
     void audio_callback(size_t n, T* const* in, T* const* out);
+    void flush(size_t n, T* const* in, T* const* out);
 
     // for now, do nothing:
     bool activate() const { return true; }
@@ -78,6 +81,7 @@ class pointer_policy<T*>
       , _next_output_id(0)
       , _in(0)
       , _out(0)
+      , _offset(0)
     {}
 
     virtual ~pointer_policy() = default;
@@ -99,16 +103,24 @@ class pointer_policy<T*>
     int _next_output_id;
     T* const* _in;
     T* const* _out;
+    size_t _offset;  ///< Position of the current block within _in and _out
+
+    /// Zero-padded copies of the last (incomplete) block, see flush()
+    std::vector<T> _remainder_data;
+    std::vector<T*> _remainder_in, _remainder_out;
 };
 
 /** This has to be called for each audio block.
+ * For offline processing, @p n can also be a multiple of block_size(), the
+ * data is then processed in several blocks of size block_size().
+ * A last incomplete block can be processed with flush().
  * @attention You must make sure that there is enough memory available for input
  *   and output data. Inputs and outputs can be added, but @p in and @p out must
  *   be enlarged accordingly.
  * @warning @p in and @p out can only grow bigger, if inputs/outputs are @em
  *   removed, the corresponding pointer of @p in/@p out must remain at its
  *   place!
- * @param n block size
+ * @param n number of samples, normally the block size
  * @param in pointer to an array of pointers to input channels
  * @param out pointer to an array of pointers to output channels
  **/
@@ -116,12 +128,63 @@ template<typename T>
 void
 pointer_policy<T*>::audio_callback(size_t n, T* const* in, T* const* out)
 {
-  assert(n == this->block_size());
-  (void)n;  // avoid "unused parameter" warning
+  assert(n >= this->block_size());
+  assert(n % this->block_size() == 0);
 
   _in = in;
   _out = out;
+  for (_offset = 0; _offset + this->block_size() <= n
+      ; _offset += this->block_size())
+  {
+    this->process();
+  }
+  _offset = 0;
+}
+
+/** Process the last incomplete block (e.g. at the end of a file).
+ * The @p n samples are zero-padded to a whole block, the padded part of the
+ * output is discarded.  Since the padding is processed like normal input
+ * (and moves all processing state ahead by a whole block), this should only
+ * be used for the very last call.
+ * @attention This allocates memory, it's not meant for realtime use!
+ * @param n number of samples, less than block_size()
+ * @param in pointer to an array of pointers to input channels
+ * @param out pointer to an array of pointers to output channels
+ **/
+template<typename T>
+void
+pointer_policy<T*>::flush(size_t n, T* const* in, T* const* out)
+{
+  assert(n < this->block_size());
+  if (n == 0) return;
+
+  auto in_channels = static_cast<size_t>(this->in_channels());
+  auto out_channels = static_cast<size_t>(this->out_channels());
+  auto block_size = this->block_size();
+
+  _remainder_data.assign((in_channels + out_channels) * block_size, T());
+  _remainder_in.resize(in_channels);
+  _remainder_out.resize(out_channels);
+  auto ptr = _remainder_data.data();
+  for (size_t i = 0; i < in_channels; ++i, ptr += block_size)
+  {
+    _remainder_in[i] = ptr;
+    std::copy(in[i], in[i] + n, ptr);
+  }
+  for (size_t i = 0; i < out_channels; ++i, ptr += block_size)
+  {
+    _remainder_out[i] = ptr;
+  }
+
+  _in = _remainder_in.data();
+  _out = _remainder_out.data();
+  _offset = 0;
   this->process();
+
+  for (size_t i = 0; i < out_channels; ++i)
+  {
+    std::copy(_remainder_out[i], _remainder_out[i] + n, out[i]);
+  }
 }
 
 template<typename T>
@@ -134,7 +197,7 @@ class pointer_policy<T*>::Input
 
     void fetch_buffer()
     {
-      this->buffer._begin = _parent._in[_id];
+      this->buffer._begin = _parent._in[_id] + _parent._offset;
       this->buffer._end   = this->buffer._begin + _parent.block_size();
     }
 
@@ -165,7 +228,7 @@ class pointer_policy<T*>::Output
 
     void fetch_buffer()
     {
-      this->buffer._begin = _parent._out[_id];
+      this->buffer._begin = _parent._out[_id] + _parent._offset;
       this->buffer._end   = this->buffer._begin + _parent.block_size();
     }
 
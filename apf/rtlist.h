@@ -30,8 +30,12 @@
 #ifndef APF_RTLIST_H
 #define APF_RTLIST_H
 
+#include <cassert>
 #include <list>
-#include <algorithm>  // for std::find()
+#include <stdexcept>  // for std::logic_error
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "apf/commandqueue.h"
 
@@ -51,6 +55,10 @@ template<typename T> class RtList; // no implementation, use <T*>!
  * Before the realtime thread can access the list elements, it has to call
  * CommandQueue::process_commands() to synchronize.
  *
+ * The non-realtime thread keeps an iterator to each element (iterators of
+ * @c std::list stay valid when elements are spliced).  Therefore, removing
+ * elements in the realtime thread takes constant time per element.
+ *
  * TODO: more information about which functions are allowed in which thread.
  **/
 template<typename T>
@@ -88,10 +96,14 @@ class RtList<T*> : NonCopyable
     /// @param item Pointer to the list item
     /// @return the same pointer
     /// @note Ownership is passed to the list!
+    /// @throw std::logic_error if the element is already in the list
     template<typename X>
     X* add(X* item)
     {
-      _fifo.push(new AddCommand(_the_actual_list, item));
+      assert(item != nullptr);
+      list_t elements(1, item);
+      _register(elements);
+      _fifo.push(new AddCommand(_the_actual_list, std::move(elements)));
       return item;
     }
 
@@ -99,34 +111,64 @@ class RtList<T*> : NonCopyable
     /// @param first Begin of range to be added
     /// @param last End of range to be added
     /// @note Ownership is passed to the list!
+    /// @throw std::logic_error if an element is already in the list or if
+    ///   the range contains an element more than once
     template<typename ForwardIterator>
     void add(ForwardIterator first, ForwardIterator last)
     {
-      _fifo.push(new AddCommand(_the_actual_list, first, last));
+      list_t elements(first, last);
+      _register(elements);
+      _fifo.push(new AddCommand(_the_actual_list, std::move(elements)));
     }
 
     /// Remove an element from the list.
+    /// @throw std::logic_error if the element is not in the list
     void rem(T* to_rem)
     {
-      _fifo.push(new RemCommand(_the_actual_list, to_rem));
+      _fifo.push(new RemCommand(_the_actual_list
+            , std::vector<iterator>(1, _unregister(to_rem))));
     }
 
     /// Remove a range of elements from the list.
     /// @param first Iterator to the first item
     /// @param last Past-the-end iterator
+    /// @throw std::logic_error if an element is not in the list or if the
+    ///   range contains an element more than once.  In this case, no element
+    ///   is removed.
     template<typename ForwardIterator>
     void rem(ForwardIterator first, ForwardIterator last)
     {
-      _fifo.push(new RemCommand(_the_actual_list, first, last));
+      std::unordered_set<T*> seen;
+      for (auto i = first; i != last; ++i)
+      {
+        if (_handles.find(*i) == _handles.end())
+        {
+          throw std::logic_error("RtList::rem(): Item not found!");
+        }
+        if (!seen.insert(*i).second)
+        {
+          throw std::logic_error("RtList::rem(): Duplicate item!");
+        }
+      }
+      std::vector<iterator> delinquents;
+      for (; first != last; ++first)
+      {
+        delinquents.push_back(_unregister(*first));
+      }
+      _fifo.push(new RemCommand(_the_actual_list, std::move(delinquents)));
     }
 
     /// Remove all elements from the list.
     void clear()
     {
+      _handles.clear();
       _fifo.push(new ClearCommand(_the_actual_list));
     }
 
     /// Splice another RtList into the RtList. @see @c std::list::splice()
+    /// @note This is meant for temporarily joining lists in the realtime
+    ///   thread.  The elements must be spliced back to their original list
+    ///   before the next CommandQueue::process_commands()!
     void splice(iterator position, RtList& x)
     {
       assert(&_fifo == &x._fifo);
@@ -150,8 +192,45 @@ class RtList<T*> : NonCopyable
     ///@}
 
   private:
+    /// Store iterators to new elements (before they are spliced into the
+    /// actual list).
+    void _register(list_t& elements)
+    {
+      std::unordered_set<T*> seen;
+      for (auto& element: elements)
+      {
+        if (_handles.find(element) != _handles.end())
+        {
+          throw std::logic_error("RtList::add(): Item already in list!");
+        }
+        if (!seen.insert(element).second)
+        {
+          throw std::logic_error("RtList::add(): Duplicate item!");
+        }
+      }
+      for (auto it = elements.begin(); it != elements.end(); ++it)
+      {
+        _handles.emplace(*it, it);
+      }
+    }
+
+    iterator _unregister(T* element)
+    {
+      auto handle = _handles.find(element);
+      if (handle == _handles.end())
+      {
+        throw std::logic_error("RtList::rem(): Item not found!");
+      }
+      auto result = handle->second;
+      _handles.erase(handle);
+      return result;
+    }
+
     CommandQueue& _fifo;
     list_t _the_actual_list;
+
+    /// Iterators to all elements, only used in the non-realtime thread.
+    std::unordered_map<T*, iterator> _handles;
 };
 
 /// Command to add an element to a list.
@@ -179,6 +258,15 @@ class RtList<T*>::AddCommand : public CommandQueue::Command
       , _dst_list(dst_list)
     {}
 
+    /// Constructor to add the elements of an existing list.
+    /// Iterators to these elements stay valid.
+    /// @param dst_list List to which the elements will be added
+    /// @param elements List of elements, will be empty afterwards
+    AddCommand(list_t& dst_list, list_t&& elements)
+      : _splice_list(std::move(elements))
+      , _dst_list(dst_list)
+    {}
+
     virtual void execute()
     {
       _dst_list.splice(_dst_list.end(), _splice_list);
@@ -192,45 +280,29 @@ class RtList<T*>::AddCommand : public CommandQueue::Command
     list_t& _dst_list;  // Destination list
 };
 
-/// Command to remove an element from a list.
+/// Command to remove elements from a list.
 template<typename T>
 class RtList<T*>::RemCommand : public CommandQueue::Command
 {
   public:
-    /// Constructor to remove a single item.
-    /// @param dst_list List from which the item will be removed
-    /// @param delinquent Pointer to the item which will be removed
-    RemCommand(list_t& dst_list, T* delinquent)
-      : _dst_list(dst_list)
-      , _delinquents(1, delinquent)
-    {}
-
-    /// Constructor to remove a bunch of items at once.
+    /// Constructor.
     /// @param dst_list List from which the elements will be removed
-    /// @param first Iterator to first item to be removed
-    /// @param last Past-the-end iterator
-    template<typename InputIterator>
-    RemCommand(list_t& dst_list, InputIterator first, InputIterator last)
+    /// @param delinquents Iterators to the elements which will be removed.
+    ///   They must be valid iterators into @p dst_list when execute() is
+    ///   called.
+    RemCommand(list_t& dst_list, std::vector<iterator>&& delinquents)
       : _dst_list(dst_list)
-      , _delinquents(first, last)
+      , _delinquents(std::move(delinquents))
     {}
 
     /// The actual implementation of the command.
-    /// @throw std::logic_error if item(s) is/are not found
+    /// This takes constant time per element.
     virtual void execute()
     {
-      for (auto& i: _delinquents)
+      for (auto& delinquent: _delinquents)
       {
-        auto delinquent = std::find(_dst_list.begin(), _dst_list.end(), i);
-        if (delinquent != _dst_list.end())
-        {
-          // Note: destruction order is reverse
-          _splice_list.splice(_splice_list.begin(), _dst_list, delinquent);
-        }
-        else
-        {
-          throw std::logic_error("RemCommand: Item not found!");
-        }
+        // Note: destruction order is reverse
+        _splice_list.splice(_splice_list.begin(), _dst_list, delinquent);
       }
     }
 
@@ -246,7 +318,7 @@ class RtList<T*>::RemCommand : public CommandQueue::Command
   private:
     list_t _splice_list;  // List of elements to be removed
     list_t& _dst_list;  // Destination list
-    list_t _delinquents;  // Temporary list of elements to be removed
+    std::vector<iterator> _delinquents;  // Elements to be removed
 };
 
 /// Command to remove all elements from a list.
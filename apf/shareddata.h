@@ -30,7 +30,11 @@
 #ifndef APF_SHAREDDATA_H
 #define APF_SHAREDDATA_H
 
+#include <atomic>
+#include <cmath>  // for std::abs(), std::exp()
+
 #include "apf/commandqueue.h"
+#include "apf/math.h"  // for linear_interpolator
 
 namespace apf
 {
@@ -111,6 +115,152 @@ class SharedData<X>::SetCommand : public CommandQueue::Command
     X _data;  ///< copy of data or moved-to data
 };
 
+/** Parameter which is set from any thread and smoothed in the audio thread.
+ * In contrast to SharedData, no Command is allocated and the CommandQueue is
+ * not involved. New values are written to a single atomic slot, if several
+ * values are written before the next audio block, only the last one is used.
+ *
+ * In the audio thread, update() has to be called exactly once per block.
+ * Afterwards, old() is the value at the beginning of the block and get() is
+ * the value at the beginning of the next block, within the block the value
+ * is interpolated linearly (see interpolator() and ramp()).
+ * The interface is similar to BlockParameter, so it can be used for
+ * CombineChannelsInterpolation.
+ *
+ * There are two kinds of smoothing:
+ * - @c linear: the target value is reached after a given number of blocks,
+ * - @c exponential: in each block, the distance to the target value is
+ *   reduced by a constant factor (given by a time constant in blocks).
+ *   After 12 time constants (when the remaining distance is about 6e-6 of
+ *   the original distance, i.e. -104 dB), the target value is used.  This
+ *   doesn't depend on the magnitude of the values, so it works for large
+ *   values and for very small gains alike.
+ * @tparam T Value type, @c std::atomic<T> should be lock-free
+ **/
+template<typename T>
+class SmoothedParameter
+{
+  public:
+    enum smoothing_type { linear, exponential };
+
+    /// Constructor.
+    /// @param block_size Audio block size
+    /// @param value Initial value
+    /// @param smoothing Linear or exponential smoothing
+    /// @param blocks Duration of a linear ramp (or time constant of the
+    ///   exponential smoothing) in blocks. 1 means the target is reached
+    ///   within one block (with linear smoothing).
+    explicit SmoothedParameter(size_t block_size, T value = T()
+        , smoothing_type smoothing = linear, T blocks = T(1))
+      : _block_size(static_cast<T>(block_size))
+      , _smoothing(smoothing)
+      , _blocks(blocks)
+      , _coefficient(std::exp(-T(1) / blocks))
+      , _target(value)
+      , _destination(value)
+      , _step()
+      , _remaining()
+      , _current(value)
+      , _old(value)
+      , _interpolator(value, value, _block_size)
+    {
+      assert(blocks > T(0));
+    }
+
+    /// Set new target value. This can be called from any thread.
+    void set(T value)
+    {
+      // Only the value itself is published, no other memory is involved
+      _target.store(value, std::memory_order_relaxed);
+    }
+
+    SmoothedParameter& operator=(T value) { this->set(value); return *this; }
+
+    /// Latest target value (not necessarily reached yet).
+    T target() const { return _target.load(std::memory_order_relaxed); }
+
+    /// Fetch target value and calculate the ramp for the current block.
+    /// This has to be called in the audio thread, once per block.
+    void update()
+    {
+      auto target = _target.load(std::memory_order_relaxed);
+      if (target != _destination)
+      {
+        _destination = target;
+        _step = (_destination - _current) / _blocks;
+        _remaining = _blocks * T(12);
+      }
+
+      _old = _current;
+      if (_current != _destination)
+      {
+        if (_smoothing == linear)
+        {
+          _current += _step;
+          if (std::abs(_destination - _old) <= std::abs(_step))
+          {
+            _current = _destination;
+          }
+        }
+        else
+        {
+          _current = _destination + _coefficient * (_current - _destination);
+          _remaining -= T(1);
+          if (_remaining <= T(0))
+          {
+            _current = _destination;
+          }
+        }
+      }
+      _interpolator.set(_old, _current, _block_size);
+    }
+
+    /// Value at the beginning of the next block.
+    T get() const { return _current; }
+    operator T() const { return this->get(); }
+
+    /// Value at the beginning of the current block.
+    T old() const { return _old; }
+
+    /// Check if the value changes within the current block.
+    bool changed() const { return _current != _old; }
+
+    /// Interpolator for the current block. Argument: sample index.
+    const math::linear_interpolator<T>& interpolator() const
+    {
+      return _interpolator;
+    }
+
+    /// Write the values for each sample of the current block.
+    /// @return Iterator past the last written element
+    template<typename Out>
+    Out ramp(Out first) const
+    {
+      const auto increment = (_current - _old) / _block_size;
+      for (size_t i = 0; i < static_cast<size_t>(_block_size); ++i)
+      {
+        *first = _old + static_cast<T>(i) * increment;
+        ++first;
+      }
+      return first;
+    }
+
+  private:
+    const T _block_size;
+    const smoothing_type _smoothing;
+    const T _blocks;
+    const T _coefficient;  ///< for exponential smoothing
+
+    std::atomic<T> _target;  ///< written by any thread
+
+    // only used in the audio thread:
+    T _destination;  ///< target value as seen by the audio thread
+    T _step;  ///< increment per block (for linear smoothing)
+    T _remaining;  ///< blocks until the target is used (exponential smoothing)
+    T _current, _old;
+    math::linear_interpolator<T> _interpolator;
+};
+
 }  // namespace apf
 
 #endif
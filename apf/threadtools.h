@@ -32,6 +32,14 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <stdexcept>  // for std::logic_error
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>  // for pthread_setaffinity_np(), pthread_setschedparam()
+#include <sched.h>  // for cpu_set_t, SCHED_FIFO, SCHED_OTHER
+#endif
 
 #include "apf/misc.h"  // for NonCopyable
 
@@ -105,6 +113,93 @@ class Semaphore : NonCopyable
     int _count;
 };
 
+/** Parse a list of CPU numbers, e.g. "0-3,8,10-11".
+ * @return CPU numbers in the given order (empty for an empty string)
+ * @throw std::logic_error on syntax errors and on CPU numbers which are too
+ *   large (at least @c CPU_SETSIZE, 1024 on non-Linux platforms)
+ **/
+inline std::vector<unsigned> parse_cpu_list(const std::string& list)
+{
+#ifdef __linux__
+  const unsigned max_cpus = CPU_SETSIZE;
+#else
+  const unsigned max_cpus = 1024;
+#endif
+
+  std::vector<unsigned> result;
+  size_t pos = 0;
+  auto number = [&list, &pos, max_cpus]()
+  {
+    auto start = pos;
+    unsigned n = 0;
+    while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9')
+    {
+      n = 10 * n + static_cast<unsigned>(list[pos++] - '0');
+      if (n >= max_cpus)
+      {
+        throw std::logic_error("CPU number too large: " + list);
+      }
+    }
+    if (pos == start) throw std::logic_error("Invalid CPU list: " + list);
+    return n;
+  };
+
+  if (list.empty()) return result;
+  for (;;)
+  {
+    auto first = number(), last = first;
+    if (pos < list.size() && list[pos] == '-')
+    {
+      ++pos;
+      last = number();
+      if (last < first) throw std::logic_error("Invalid CPU list: " + list);
+    }
+    for (auto cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+    if (pos == list.size()) return result;
+    if (list[pos++] != ',') throw std::logic_error("Invalid CPU list: " + list);
+  }
+}
+
+/** Restrict a thread to run only on the given CPU.
+ * @return @b false if not successful or not supported on this platform.
+ **/
+inline bool set_thread_affinity(std::thread::native_handle_type thread
+    , unsigned cpu)
+{
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+  (void)thread;
+  (void)cpu;
+  return false;
+#endif
+}
+
+/** Set the scheduling priority of a thread.
+ * @param priority realtime priority (@c SCHED_FIFO), 0 means a normal
+ *   non-realtime thread (@c SCHED_OTHER).
+ * @return @b false if not successful (e.g. if the user is not allowed to use
+ *   realtime scheduling) or not supported on this platform.
+ **/
+inline bool set_thread_priority(std::thread::native_handle_type thread
+    , int priority)
+{
+#ifdef __linux__
+  struct sched_param param;
+  param.sched_priority = priority > 0 ? priority : 0;
+  return pthread_setschedparam(thread, priority > 0 ? SCHED_FIFO : SCHED_OTHER
+      , &param) == 0;
+#else
+  (void)thread;
+  (void)priority;
+  return false;
+#endif
+}
+
 }  // namespace apf
 
 #endif
@@ -0,0 +1,62 @@
+// Usage example for processing many audio files in parallel with one
+// MimoProcessor per worker thread.
+
+#include <memory>  // for std::make_unique()
+#include <thread>  // for std::thread::hardware_concurrency()
+
+#include "apf/mimoprocessor_file_io.h"
+
+// First the policy ...
+#include "apf/pointer_policy.h"
+// ... then the SimpleProcessor.
+#include "simpleprocessor.h"
+
+int main(int argc, char *argv[])
+{
+  const size_t blocksize = 65536;
+
+  if (argc < 5)
+  {
+    std::cerr << "Error: too few arguments!" << std::endl;
+    std::cout << "Usage: " << argv[0]
+      << " outdir outchannels workers infilename [infilename ...]\n"
+      "  workers = 0 means one worker per CPU core.\n"
+      "  All input files must have the same sample rate and number of"
+      " channels." << std::endl;
+    return 42;
+  }
+
+  std::string outdir = argv[1];
+  auto workers = apf::str::S2RV<size_t>(argv[3]);
+  if (workers == 0) workers = std::thread::hardware_concurrency();
+
+  std::vector<apf::batch_file_io_job> jobs;
+  for (int i = 4; i < argc; ++i)
+  {
+    std::string infilename = argv[i];
+    auto basename = infilename.substr(infilename.find_last_of('/') + 1);
+    jobs.emplace_back(infilename, outdir + "/" + basename);
+  }
+
+  apf::parameter_map e;
+  e.set("threads", 1);  // parallelism is achieved with several workers
+
+  SndfileHandle in(jobs.front().infilename, SFM_READ);
+  e.set("in_channels", in.channels());
+  e.set("out_channels", apf::str::S2RV<int>(argv[2]));
+
+  e.set("block_size", blocksize);
+  e.set("sample_rate", in.samplerate());
+
+  auto seconds = apf::mimoprocessor_batch_file_io(
+      [&e] () { return std::make_unique<SimpleProcessor>(e); }
+      , jobs, workers);
+
+  apf::print_batch_statistics(jobs, seconds);
+
+  for (const auto& job: jobs)
+  {
+    if (job.result != 0) return 1;
+  }
+  return 0;
+}
@@ -15,7 +15,7 @@ class MyProcessor : public apf::MimoProcessor<MyProcessor
     using Input = MimoProcessorBase::DefaultInput;
 
     template<typename In>
-    MyProcessor(In first, In last);
+    MyProcessor(In first, In last, const apf::parameter_map& p);
 
     ~MyProcessor() { this->deactivate(); }
 
@@ -27,6 +27,26 @@ class MyProcessor : public apf::MimoProcessor<MyProcessor
       virtual void process() {}
     };
 
+    /// One step of a split convolution, see apf::conv::OutputBase
+    struct SplitStep : SplitItem
+    {
+      using step_t = void (apf::conv::OutputBase::*)(size_t);
+
+      SplitStep(apf::conv::Convolver& convolver, step_t step)
+        : _convolver(convolver)
+        , _step(step)
+      {}
+
+      virtual void process(unsigned part, unsigned)
+      {
+        // There may be less parts than threads
+        if (part < _convolver.parts()) (_convolver.*_step)(part);
+      }
+
+      apf::conv::Convolver& _convolver;
+      step_t _step;
+    };
+
     APF_PROCESS(MyProcessor, MimoProcessorBase)
     {
       _convolver.add_block(_input->begin());
@@ -45,7 +65,18 @@ class MyProcessor : public apf::MimoProcessor<MyProcessor
         }
         _old_reverb = this->reverb;
       }
-      float* result = _convolver.convolve();
+      float* result;
+      if (_convolver.parts() > 1)
+      {
+        // Long filter: all threads share the work
+        _process_split(_multiply);
+        _process_split(_reduce);
+        result = _convolver.finish();
+      }
+      else
+      {
+        result = _convolver.convolve();
+      }
 
       // This is necessary because _output is used before _output_list is
       // processed:
@@ -66,17 +97,28 @@ class MyProcessor : public apf::MimoProcessor<MyProcessor
     apf::conv::Convolver _convolver;
 
     apf::conv::Filter _dirac;
+
+    SplitStep _multiply, _reduce;
 };
 
 template<typename In>
-MyProcessor::MyProcessor(In first, In last)
-  : MimoProcessorBase()
+MyProcessor::MyProcessor(In first, In last, const apf::parameter_map& p)
+  : MimoProcessorBase(p)
   , reverb(_fifo, true)
   , _old_reverb(false)
   , _filter(this->block_size(), first, last)
-  , _convolver(this->block_size(), _filter.partitions())
+  // The input spectra are written by the audio thread
+  , _convolver(this->block_size(), _filter.partitions(), this->thread_node(0))
   , _dirac(this->block_size(), 1)
+  , _multiply(_convolver, &apf::conv::OutputBase::multiply_part)
+  , _reduce(_convolver, &apf::conv::OutputBase::reduce_part)
 {
+  // Splitting is only worth it if each thread gets enough partitions
+  auto parts = _convolver.split(this->threads()
+      , p.get("split_partitions", size_t(128)));
+  std::cout << "Convolution is split into " << parts << " part(s)"
+    << std::endl;
+
   // Load Dirac
   float one = 1.0f;
   _convolver.prepare_filter(&one, (&one)+1, _dirac);
@@ -90,12 +132,16 @@ MyProcessor::MyProcessor(In first, In last)
 
 int main(int argc, char *argv[])
 {
-  if (argc != 2)
+  if (argc != 2 && argc != 3)
   {
-    std::cerr << "Usage: " << argv[0] << " <IR filename>" << std::endl;
+    std::cerr << "Usage: " << argv[0]
+      << " <IR filename> [minimum partitions per thread]" << std::endl;
     return 1;
   }
 
+  apf::parameter_map params;
+  if (argc == 3) params.set("split_partitions", argv[2]);
+
   SndfileHandle in(argv[1], SFM_READ);
 
   if (in.error()) throw std::runtime_error(in.strError());
@@ -112,7 +158,7 @@ int main(int argc, char *argv[])
     throw std::runtime_error("Couldn't load audio file!");
   }
 
-  MyProcessor processor(ir.begin(), ir.end());
+  MyProcessor processor(ir.begin(), ir.end(), params);
 
   if (in.samplerate() != int(processor.sample_rate()))
   {
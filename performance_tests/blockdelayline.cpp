@@ -0,0 +1,155 @@
+// Performance tests for reading many taps from one BlockDelayLine.
+
+#include <cstdlib>  // for random()
+#include <vector>
+
+#include "apf/blockdelayline.h"
+#include "apf/container.h"  // for fixed_matrix
+#include "apf/mirroredbuffer.h"
+#include "apf/stopwatch.h"
+
+int main()
+{
+  // TODO: check for input arguments
+
+  size_t block_size = 512;
+  size_t max_delay = 48000;
+  size_t taps = 200;
+  int repetitions = 200;
+
+  apf::BlockDelayLine<float> delayline(block_size, max_delay);
+  apf::fixed_matrix<float> out(taps, block_size);
+  std::vector<float> in(block_size);
+
+  // WARNING: this is not really a meaningful audio signal:
+  std::generate(in.begin(), in.end(), random);
+
+  std::vector<float> delays(taps);
+  for (size_t i = 0; i < taps; ++i)
+  {
+    delays[i] = float(max_delay - 10) * float(i) / float(taps) + 1.3f;
+  }
+
+  auto mirrored_name = apf::MirroredBuffer<float>::granularity() > 1
+    ? "integer delay, batched, mirrored"
+    : "integer delay, batched, mirrored (not available)";
+
+  using linear = apf::linear_interpolation<float>;
+  using lagrange = apf::lagrange_interpolation<float>;
+
+  {
+    apf::StopWatch watch("integer delay");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block(channel->begin(), size_t(delay), 0.5f);
+        ++channel;
+      }
+    }
+  }
+
+  {
+    std::vector<size_t> int_delays(delays.begin(), delays.end());
+    std::vector<float> weights(taps, 0.5f);
+    apf::StopWatch watch("integer delay, batched");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      delayline.read_blocks(int_delays.begin(), int_delays.end()
+          , weights.begin(), out.get_channel_ptrs());
+    }
+  }
+
+  {
+    apf::BlockDelayLine<float, apf::MirroredBuffer<float>> mirrored(
+        block_size, max_delay);
+    std::vector<size_t> int_delays(delays.begin(), delays.end());
+    std::vector<float> weights(taps, 0.5f);
+    apf::StopWatch watch(mirrored_name);
+    for (int i = 0; i < repetitions; ++i)
+    {
+      mirrored.write_block(in.begin());
+      mirrored.read_blocks(int_delays.begin(), int_delays.end()
+          , weights.begin(), out.get_channel_ptrs());
+    }
+  }
+
+  {
+    apf::StopWatch watch("linear interpolation");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block_fractional<linear>(channel->begin(), delay, 0.5f);
+        ++channel;
+      }
+    }
+  }
+
+  {
+    apf::StopWatch watch("Lagrange interpolation");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block_fractional<lagrange>(channel->begin(), delay
+            , 0.5f);
+        ++channel;
+      }
+    }
+  }
+
+  {
+    apf::StopWatch watch("linear interpolation, delay ramp");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block_ramp<linear>(channel->begin(), delay, delay + 3.7f
+            , 0.5f);
+        ++channel;
+      }
+    }
+  }
+
+  {
+    apf::StopWatch watch("Lagrange interpolation, delay ramp");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block_ramp<lagrange>(channel->begin(), delay
+            , delay + 3.7f, 0.5f);
+        ++channel;
+      }
+    }
+  }
+
+  {
+    std::vector<apf::BlockDelayLine<float>::allpass_state> states(taps);
+    apf::StopWatch watch("allpass interpolation, delay ramp");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      delayline.write_block(in.begin());
+      auto channel = out.channels.begin();
+      auto state = states.begin();
+      for (auto delay: delays)
+      {
+        delayline.read_block_allpass(channel->begin(), delay, delay + 3.7f
+            , *state++, 0.5f);
+        ++channel;
+      }
+    }
+  }
+}
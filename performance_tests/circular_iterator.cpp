@@ -0,0 +1,69 @@
+// Performance tests for copying blocks through a circular_iterator.
+
+#include <algorithm>  // for std::copy(), std::transform()
+#include <cstdlib>  // for random()
+#include <vector>
+
+#include "apf/iterator.h"  // for circular_iterator, apf::copy()
+#include "apf/stopwatch.h"
+
+int main()
+{
+  // TODO: check for input arguments
+
+  size_t block_size = 512;
+  size_t ring_size = 48000;
+  int repetitions = 20000;
+
+  std::vector<float> ring(ring_size);
+  std::vector<float> out(block_size);
+
+  // WARNING: this is not really a meaningful audio signal:
+  std::generate(ring.begin(), ring.end(), random);
+
+  auto start = apf::make_circular_iterator(ring.begin(), ring.end());
+  auto block = static_cast<std::ptrdiff_t>(block_size);
+  auto half = [] (float x) { return 0.5f * x; };
+
+  {
+    apf::StopWatch watch("std::copy()");
+    auto first = start;
+    for (int i = 0; i < repetitions; ++i)
+    {
+      std::copy(first, first + block, out.begin());
+      first += block;
+    }
+  }
+
+  {
+    apf::StopWatch watch("apf::copy()");
+    auto first = start;
+    for (int i = 0; i < repetitions; ++i)
+    {
+      apf::copy(first, first + block, out.begin());
+      first += block;
+    }
+  }
+
+  {
+    apf::StopWatch watch("std::transform()");
+    auto first = start;
+    for (int i = 0; i < repetitions; ++i)
+    {
+      std::transform(first, first + block, out.begin(), half);
+      first += block;
+    }
+  }
+
+  {
+    apf::StopWatch watch("apf::transform()");
+    auto first = start;
+    for (int i = 0; i < repetitions; ++i)
+    {
+      apf::transform(first, first + block, out.begin(), half);
+      first += block;
+    }
+  }
+
+  return out[0] > 0 ? 0 : 1;
+}
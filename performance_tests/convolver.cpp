@@ -0,0 +1,279 @@
+// Performance tests for the partitioned convolution.
+
+#include <algorithm>  // for std::generate()
+#include <chrono>
+#include <cmath>  // for std::pow()
+#include <cstdlib>  // for random()
+#include <iostream>
+#include <thread>  // for std::this_thread::sleep_until()
+#include <utility>  // for std::pair
+#include <vector>
+
+#include "apf/convolver.h"
+#include "apf/stopwatch.h"
+
+float noise()
+{
+  return static_cast<float>(random() % 2001) / 1000.0f - 1.0f;
+}
+
+/// Average time (in microseconds) of one convolve() with a static filter.
+double time_per_block(size_t block_size, size_t partitions)
+{
+  std::vector<float> signal(block_size);
+  std::vector<float> coefficients(block_size * partitions);
+  std::generate(coefficients.begin(), coefficients.end(), noise);
+
+  auto filter = apf::conv::Filter(block_size
+      , coefficients.begin(), coefficients.end());
+
+  apf::conv::Convolver conv(block_size, partitions);
+  conv.set_filter(filter);
+
+  // Fill all input partitions before measuring
+  for (size_t i = 0; i < partitions; ++i)
+  {
+    std::generate(signal.begin(), signal.end(), noise);
+    conv.add_block(signal.begin());
+    if (!conv.queues_empty()) conv.rotate_queues();
+  }
+
+  // Roughly the same amount of work for each combination
+  auto blocks = std::max(size_t(10), (size_t(1) << 26) / (block_size * partitions));
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < blocks; ++i)
+  {
+    conv.add_block(signal.begin());
+    conv.convolve();
+  }
+  std::chrono::duration<double, std::micro> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(blocks);
+}
+
+/// Average time (in microseconds) of transforming one block of all channels
+/// with separate Inputs and with one MultiInput.
+std::pair<double, double> input_stage(size_t block_size, size_t channels)
+{
+  std::vector<std::vector<float>> signals(channels
+      , std::vector<float>(block_size));
+  std::vector<float*> blocks;
+  for (auto& signal: signals)
+  {
+    std::generate(signal.begin(), signal.end(), noise);
+    blocks.push_back(signal.data());
+  }
+
+  std::vector<apf::conv::Input> inputs;
+  inputs.reserve(channels);
+  for (size_t i = 0; i < channels; ++i) inputs.emplace_back(block_size, 2);
+  apf::conv::MultiInput multi(block_size, 2, channels);
+
+  auto repetitions = std::max(size_t(10), (size_t(1) << 24)
+      / (block_size * channels));
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < repetitions; ++n)
+  {
+    for (size_t i = 0; i < channels; ++i) inputs[i].add_block(blocks[i]);
+  }
+  std::chrono::duration<double, std::micro> separate
+    = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < repetitions; ++n)
+  {
+    multi.add_blocks(blocks.begin());
+  }
+  std::chrono::duration<double, std::micro> batched
+    = std::chrono::steady_clock::now() - start;
+
+  auto reps = static_cast<double>(repetitions);
+  return { separate.count() / reps, batched.count() / reps };
+}
+
+/// Average time (in microseconds) of one convolve() with a static filter
+/// which decays exponentially (like a room impulse response).
+/// The filter is truncated at @p threshold_db, see Filter::truncate().
+double time_with_decay(size_t block_size, size_t length, float rt60
+    , float threshold_db, size_t& partitions)
+{
+  std::vector<float> signal(block_size);
+  std::vector<float> coefficients(length);
+  for (size_t i = 0; i < length; ++i)
+  {
+    // -60 dB after rt60 seconds (at 48 kHz)
+    auto t = static_cast<float>(i) / 48000.0f;
+    coefficients[i] = noise() * std::pow(10.0f, -3.0f * t / rt60);
+  }
+
+  auto filter = apf::conv::Filter(block_size
+      , coefficients.begin(), coefficients.end());
+  filter.truncate(threshold_db);
+  partitions = filter.effective_partitions();
+
+  apf::conv::StaticConvolver conv(filter, partitions);
+
+  for (size_t i = 0; i < partitions; ++i)
+  {
+    std::generate(signal.begin(), signal.end(), noise);
+    conv.add_block(signal.begin());
+  }
+
+  size_t blocks = 2000;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < blocks; ++i)
+  {
+    conv.add_block(signal.begin());
+    conv.convolve();
+  }
+  std::chrono::duration<double, std::micro> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(blocks);
+}
+
+/// Audio thread time (in microseconds) per block, average and maximum.
+/// The block period (at 48 kHz) is simulated, to give the background thread
+/// of a two-stage convolution time to work.
+struct callback_time
+{
+  double average, maximum;
+  size_t misses;
+};
+
+callback_time time_in_callback(size_t block_size, size_t partitions
+    , size_t head_partitions)
+{
+  std::vector<float> signal(block_size);
+  std::vector<float> coefficients(block_size * partitions);
+  std::generate(coefficients.begin(), coefficients.end(), noise);
+
+  auto filter = apf::conv::Filter(block_size
+      , coefficients.begin(), coefficients.end());
+
+  apf::conv::Convolver conv(block_size, partitions);
+  conv.two_stage(head_partitions);
+  conv.set_filter(filter);
+
+  auto period = std::chrono::microseconds(block_size * 1000000 / 48000);
+  auto deadline = std::chrono::steady_clock::now();
+  size_t blocks = partitions + 100;
+  callback_time result{0.0, 0.0, 0};
+
+  for (size_t i = 0; i < blocks; ++i)
+  {
+    std::this_thread::sleep_until(deadline += period);
+    std::generate(signal.begin(), signal.end(), noise);
+
+    auto start = std::chrono::steady_clock::now();
+    conv.add_block(signal.begin());
+    if (!conv.queues_empty()) conv.rotate_queues();
+    conv.convolve();
+    std::chrono::duration<double, std::micro> elapsed
+      = std::chrono::steady_clock::now() - start;
+
+    // The first blocks fill the queues
+    if (i < partitions) continue;
+    result.average += elapsed.count();
+    result.maximum = std::max(result.maximum, elapsed.count());
+  }
+  result.average /= static_cast<double>(blocks - partitions);
+  result.misses = conv.deadline_misses();
+  return result;
+}
+
+int main()
+{
+  // TODO: check for input arguments
+
+  size_t block_size = 64;
+  size_t partitions = 1000;
+  int blocks = 2000;
+
+  // WARNING: this is not really a meaningful audio signal:
+  std::vector<float> signal(block_size * 16);
+  std::generate(signal.begin(), signal.end(), noise);
+  std::vector<float> coefficients(block_size * partitions);
+  std::generate(coefficients.begin(), coefficients.end(), noise);
+
+  auto filter1 = apf::conv::Filter(block_size
+      , coefficients.begin(), coefficients.end());
+  auto filter2 = apf::conv::Filter(block_size
+      , coefficients.rbegin(), coefficients.rend());
+
+  apf::conv::Convolver conv(block_size, partitions);
+  conv.set_filter(filter1);
+
+  auto next_block = [&signal, block_size] (int i)
+  {
+    return signal.begin() + static_cast<std::ptrdiff_t>(
+        (static_cast<size_t>(i) % 16) * block_size);
+  };
+
+  {
+    apf::StopWatch watch("static filter");
+    for (int i = 0; i < blocks; ++i)
+    {
+      conv.add_block(next_block(i));
+      if (!conv.queues_empty()) conv.rotate_queues();
+      conv.convolve();
+    }
+  }
+
+  {
+    apf::StopWatch watch("filter change every 4 blocks");
+    for (int i = 0; i < blocks; ++i)
+    {
+      conv.add_block(next_block(i));
+      if (!conv.queues_empty()) conv.rotate_queues();
+      if (i % 4 == 0) conv.set_filter(i % 8 ? filter1 : filter2);
+      conv.convolve();
+    }
+  }
+
+  std::cout << "\nmicroseconds per block (static filter):\n";
+  std::cout << "block size  partitions  time\n";
+  for (size_t bs: {64, 256, 1024, 4096})
+  {
+    for (size_t p: {1, 16, 256, 4096})
+    {
+      // Limit the filter length to 2^22 samples (16 MiB)
+      if (bs * p > (size_t(1) << 22)) continue;
+      std::cout << bs << "\t    " << p << "\t\t" << time_per_block(bs, p)
+        << std::endl;
+    }
+  }
+
+  std::cout << "\nmicroseconds per block of 64 channels (Input/MultiInput):\n";
+  for (size_t bs: {64, 256, 1024, 4096})
+  {
+    auto times = input_stage(bs, 64);
+    std::cout << bs << "\t" << times.first << "\t" << times.second
+      << std::endl;
+  }
+
+  std::cout << "\nmicroseconds per block, 4 s filter with RT60 = 1 s:\n";
+  std::cout << "threshold  partitions  time\n";
+  for (float threshold: {-1000.0f, -120.0f, -100.0f, -80.0f})
+  {
+    size_t effective;
+    auto time = time_with_decay(256, 4 * 48000, 1.0f, threshold, effective);
+    std::cout << threshold << "\t   " << effective << "\t\t" << time
+      << std::endl;
+  }
+
+  std::cout << "\nmicroseconds in audio thread per block (two-stage):\n";
+  std::cout << "block size  partitions  head  average  maximum  misses\n";
+  for (auto config: {std::make_pair(256, 256), std::make_pair(1024, 32)})
+  {
+    auto bs = size_t(config.first);
+    auto p = size_t(config.second);
+    for (size_t head: {p, size_t(4), size_t(1)})
+    {
+      auto t = time_in_callback(bs, p, head);
+      std::cout << bs << "\t    " << p << "\t\t" << head << "\t"
+        << t.average << "\t" << t.maximum << "\t" << t.misses << std::endl;
+    }
+  }
+}
@@ -0,0 +1,4 @@
+// Same as convolver.cpp, but with the built-in FFT instead of FFTW.
+
+#define APF_CONVOLVER_BUILTIN_FFT
+#include "convolver.cpp"
@@ -0,0 +1,101 @@
+// Performance tests for the DirectionIndex.
+
+#include <chrono>
+#include <cstdlib>  // for random()
+#include <iostream>
+#include <vector>
+
+#include "apf/directionindex.h"
+
+using vector_t = apf::DirectionIndex::vector_t;
+
+float random_angle(float range)
+{
+  return static_cast<float>(random() % 100000) / 100000.0f * range;
+}
+
+/// Regular grid with the given number of elevations (like many HRTF sets).
+std::vector<vector_t> grid(size_t elevations, size_t azimuths)
+{
+  std::vector<vector_t> result;
+  for (size_t e = 0; e < elevations; ++e)
+  {
+    auto el = -90.0f + 180.0f * (float(e) + 0.5f) / float(elevations);
+    for (size_t a = 0; a < azimuths; ++a)
+    {
+      auto az = 360.0f * float(a) / float(azimuths);
+      result.push_back(apf::DirectionIndex::from_degrees(az, el));
+    }
+  }
+  return result;
+}
+
+/// Reference: nearest direction by comparing all of them.
+size_t linear_search(const std::vector<vector_t>& directions
+    , const vector_t& query)
+{
+  size_t best = 0;
+  float best_dot = -2.0f;
+  for (size_t i = 0; i < directions.size(); ++i)
+  {
+    auto d = directions[i][0] * query[0] + directions[i][1] * query[1]
+      + directions[i][2] * query[2];
+    if (d > best_dot)
+    {
+      best_dot = d;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/// Average time (in microseconds) of one query
+template<typename F>
+double time_per_query(const std::vector<vector_t>& queries, F query)
+{
+  size_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& q: queries) checksum += query(q);
+  std::chrono::duration<double, std::micro> elapsed
+    = std::chrono::steady_clock::now() - start;
+  if (checksum == 42) std::cout << "";  // don't optimize away
+  return elapsed.count() / static_cast<double>(queries.size());
+}
+
+int main()
+{
+  std::vector<vector_t> queries;
+  for (size_t i = 0; i < 100000; ++i)
+  {
+    queries.push_back(apf::DirectionIndex::from_degrees(random_angle(360.0f)
+          , random_angle(180.0f) - 90.0f));
+  }
+
+  std::cout << "microseconds per query:\n";
+  std::cout << "directions  setup [ms]  linear  nearest  weights\n";
+  for (size_t elevations: {9, 18, 36, 72})
+  {
+    auto directions = grid(elevations, 2 * elevations);
+
+    auto start = std::chrono::steady_clock::now();
+    apf::DirectionIndex index(directions.begin(), directions.end());
+    std::chrono::duration<double, std::milli> setup
+      = std::chrono::steady_clock::now() - start;
+
+    auto linear = time_per_query(queries, [&directions](const vector_t& q)
+        {
+          return linear_search(directions, q);
+        });
+    auto nearest = time_per_query(queries, [&index](const vector_t& q)
+        {
+          return index.nearest(q);
+        });
+    auto weights = time_per_query(queries, [&index](const vector_t& q)
+        {
+          return index.weights(q)[0].first;
+        });
+
+    std::cout << directions.size() << "\t    " << setup.count() << "\t\t"
+      << linear << "\t" << nearest << "\t " << weights << std::endl;
+  }
+}
@@ -0,0 +1,62 @@
+// Performance tests for the FFT backends of the convolver.
+// See also convolver_builtin for a comparison of the whole convolution.
+
+#include <algorithm>  // for std::generate()
+#include <chrono>
+#include <cstdlib>  // for random()
+#include <iostream>
+
+#include "apf/convolver.h"  // for conv::internal::fftw_fft
+#include "apf/fft.h"  // for fft::real_fft
+
+float noise()
+{
+  return static_cast<float>(random() % 2001) / 1000.0f - 1.0f;
+}
+
+/// Average time (in microseconds) of one forward and one inverse FFT,
+/// including sorting (see conv::OutputBase).
+template<typename Forward, typename Inverse>
+double time_per_transform(size_t size, const Forward& forward
+    , const Inverse& inverse)
+{
+  apf::fixed_vector<float, apf::fft::aligned_allocator<float>> data(size);
+  std::generate(data.begin(), data.end(), noise);
+
+  auto repetitions = std::max(size_t(10), (size_t(1) << 24) / size);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < repetitions; ++n)
+  {
+    forward(data.data());
+    inverse(data.data());
+    // keep the values in range
+    for (auto& x: data) x *= 1.0f / static_cast<float>(size);
+  }
+  std::chrono::duration<double, std::micro> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(repetitions);
+}
+
+int main()
+{
+  std::cout << "microseconds per FFT + IFFT:\n";
+  std::cout << "size\tFFTW\tbuilt-in\n";
+  for (size_t size = 16; size <= 16384; size *= 2)
+  {
+    apf::fixed_vector<float, apf::fftw_allocator<float>> planning_space(size);
+    apf::conv::internal::fftw_fft::forward fftw_forward(size, 1
+        , planning_space.data());
+    apf::conv::internal::fftw_fft::inverse fftw_inverse(size
+        , planning_space.data());
+
+    apf::fft::real_fft builtin(size);
+    auto builtin_forward = [&builtin](float* data) { builtin.forward(data); };
+    auto builtin_inverse = [&builtin](float* data) { builtin.inverse(data); };
+
+    std::cout << size
+      << "\t" << time_per_transform(size, fftw_forward, fftw_inverse)
+      << "\t" << time_per_transform(size, builtin_forward, builtin_inverse)
+      << std::endl;
+  }
+}
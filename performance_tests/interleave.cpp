@@ -0,0 +1,52 @@
+// Performance tests for (de-)interleaving audio data.
+
+#include <algorithm>  // for std::generate()
+#include <cstdlib>  // for random()
+#include <string>
+
+#include "apf/interleave.h"
+#include "apf/container.h"  // for fixed_matrix
+#include "apf/stopwatch.h"
+
+void run(size_t channels)
+{
+  size_t frames = 1024;
+  int repetitions = 20000;
+
+  apf::fixed_matrix<float> interleaved(frames, channels);
+  apf::fixed_matrix<float> separate(channels, frames);
+
+  // WARNING: this is not really a meaningful audio signal:
+  std::generate(interleaved.begin(), interleaved.end(), random);
+
+  auto name = std::to_string(channels) + " channels, ";
+
+  {
+    apf::StopWatch watch(name + "fixed_matrix::set_channels()");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      separate.set_channels(interleaved.slices);
+      interleaved.set_channels(separate.slices);
+    }
+  }
+
+  {
+    apf::StopWatch watch(name + "deinterleave() and interleave()");
+    for (int i = 0; i < repetitions; ++i)
+    {
+      apf::deinterleave(interleaved.data(), channels, frames
+          , separate.get_channel_ptrs());
+      apf::interleave(separate.get_channel_ptrs(), channels, frames
+          , interleaved.data());
+    }
+  }
+}
+
+int main()
+{
+  // TODO: check for input arguments
+
+  run(2);
+  run(4);
+  run(6);
+}
@@ -0,0 +1,62 @@
+// Performance tests for reading audio files with libsndfile vs. mmap().
+
+#include <algorithm>  // for std::min()
+#include <cstdio>  // for std::remove()
+#include <numeric>  // for std::accumulate()
+#include <string>
+#include <vector>
+
+#include <sndfile.hh>
+
+#include "apf/mappedaudiofile.h"
+#include "apf/stopwatch.h"
+
+int main()
+{
+  // TODO: check for input arguments
+
+  const std::string name = "mappedaudiofile.tmp.wav";
+  const int channels = 8;
+  const sf_count_t frames = 4 * 1024 * 1024;
+  const size_t block_size = 1024;
+
+  {
+    SndfileHandle out(name, SFM_WRITE, SF_FORMAT_WAV | SF_FORMAT_FLOAT
+        , channels, 44100);
+    std::vector<float> block(block_size * channels, 0.5f);
+    for (sf_count_t i = 0; i < frames; i += sf_count_t(block_size))
+    {
+      out.writef(block.data(), sf_count_t(block_size));
+    }
+  }
+
+  float sum = 0.0f;
+
+  {
+    apf::StopWatch watch("SndfileHandle::readf()");
+    SndfileHandle in(name);
+    std::vector<float> block(block_size * channels);
+    sf_count_t n;
+    while ((n = in.readf(block.data(), sf_count_t(block_size))) > 0)
+    {
+      sum = std::accumulate(block.begin()
+          , block.begin() + n * channels, sum);
+    }
+  }
+
+  {
+    apf::StopWatch watch("MappedAudioFile");
+    apf::MappedAudioFile in(name);
+    for (size_t frame = 0; frame < in.frames(); frame += block_size)
+    {
+      // In real applications, the block would be used with
+      // interleaved_policy::audio_callback()
+      const float* block = in.block(frame);
+      auto n = std::min(block_size, in.frames() - frame) * in.channels();
+      sum = std::accumulate(block, block + n, sum);
+    }
+  }
+
+  std::remove(name.c_str());
+  return sum > 0.0f ? 0 : 1;
+}
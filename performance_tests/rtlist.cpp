@@ -0,0 +1,50 @@
+// Performance tests for bulk removal from an RtList.
+// Only the part which is done in the realtime thread is measured.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "apf/rtlist.h"
+
+struct Item
+{
+  float data[16];
+};
+
+int main()
+{
+  // TODO: check for input arguments
+
+  int repetitions = 20;
+
+  for (size_t size: { 500, 1000, 2000, 4000, 8000, 16000 })
+  {
+    apf::CommandQueue fifo(16);
+    std::chrono::steady_clock::duration duration{};
+
+    for (int r = 0; r < repetitions; ++r)
+    {
+      apf::RtList<Item*> list(fifo);
+      std::vector<Item*> items;
+      for (size_t i = 0; i < size; ++i) items.push_back(new Item);
+      list.add(items.begin(), items.end());
+      fifo.process_commands();
+
+      // Remove every 4th item in one go, like in a scene change
+      std::vector<Item*> delinquents;
+      for (size_t i = 0; i < size; i += 4) delinquents.push_back(items[i]);
+      list.rem(delinquents.begin(), delinquents.end());
+
+      auto start = std::chrono::steady_clock::now();
+      fifo.process_commands();
+      duration += std::chrono::steady_clock::now() - start;
+
+      fifo.cleanup_commands();
+    }
+
+    std::cout << "removing " << size / 4 << " of " << size << " items took "
+      << std::chrono::duration<double, std::micro>(duration).count()
+         / repetitions << " microseconds." << std::endl;
+  }
+}
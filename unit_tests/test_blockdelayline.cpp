@@ -1,4 +1,7 @@
 #include "apf/blockdelayline.h"
+#include "apf/mirroredbuffer.h"
+
+#include <vector>
 
 #include "catch/catch.hpp"
 
@@ -96,3 +99,276 @@ SECTION("non-causal delay line", "")
 }
 
 } // TEST_CASE
+
+TEST_CASE("fractional delay", "Test interpolating reads")
+{
+
+// a linear ramp can be interpolated exactly
+float src[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+float target[4] = { 0 };
+
+apf::BlockDelayLine<float> d(4, 8);
+d.write_block(src);
+d.write_block(src+4);
+d.write_block(src+8);
+
+using linear = apf::linear_interpolation<float>;
+using lagrange = apf::lagrange_interpolation<float>;
+
+SECTION("valid delays", "")
+{
+  CHECK(d.fractional_delay_is_valid<linear>(0.0f));
+  CHECK(d.fractional_delay_is_valid<linear>(7.5f));
+  CHECK_FALSE(d.fractional_delay_is_valid<linear>(8.0f));
+  CHECK_FALSE(d.fractional_delay_is_valid<linear>(-0.5f));
+
+  CHECK(d.fractional_delay_is_valid<lagrange>(1.0f));
+  CHECK(d.fractional_delay_is_valid<lagrange>(6.9f));
+  CHECK_FALSE(d.fractional_delay_is_valid<lagrange>(0.5f));
+  CHECK_FALSE(d.fractional_delay_is_valid<lagrange>(7.0f));
+
+  CHECK_FALSE(d.read_block_fractional<linear>(target, 8.0f));
+  CHECK_FALSE(d.read_block_ramp<lagrange>(target, 2.0f, 7.0f));
+}
+
+SECTION("linear", "")
+{
+  CHECK(d.read_block_fractional<linear>(target, 2.5f));
+  float expected[4] = { 6.5f, 7.5f, 8.5f, 9.5f };
+  CHECK_RANGE(target, expected, 4);
+
+  CHECK(d.read_block_fractional<linear>(target, 7.25f, 2.0f));
+  float expected2[4] = { 3.5f, 5.5f, 7.5f, 9.5f };
+  CHECK_RANGE(target, expected2, 4);
+}
+
+SECTION("lagrange", "")
+{
+  CHECK(d.read_block_fractional<lagrange>(target, 2.5f));
+  float expected[4] = { 6.5f, 7.5f, 8.5f, 9.5f };
+  CHECK_RANGE(target, expected, 4);
+}
+
+SECTION("ramp", "")
+{
+  CHECK(d.read_block_ramp<linear>(target, 2.0f, 4.0f));
+  float expected[4] = { 7.0f, 7.5f, 8.0f, 8.5f };
+  CHECK_RANGE(target, expected, 4);
+
+  CHECK(d.read_block_ramp<lagrange>(target, 2.0f, 4.0f, 2.0f));
+  float expected2[4] = { 14.0f, 15.0f, 16.0f, 17.0f };
+  CHECK_RANGE(target, expected2, 4);
+}
+
+SECTION("allpass", "")
+{
+  // With a fractional part of 1, the allpass becomes a plain delay
+  apf::BlockDelayLine<float>::allpass_state state;
+  CHECK(d.read_block_allpass(target, 3.0f, state));
+  float expected[4] = { 0.0f, 7.0f, 8.0f, 9.0f };
+  CHECK_RANGE(target, expected, 4);
+
+  float more[] = { 13, 14, 15, 16 };
+  d.write_block(more);
+  CHECK(d.read_block_allpass(target, 3.0f, state, 2.0f));
+  float expected2[4] = { 20.0f, 22.0f, 24.0f, 26.0f };
+  CHECK_RANGE(target, expected2, 4);
+
+  CHECK_FALSE(d.read_block_allpass(target, 0.4f, state));
+  CHECK_FALSE(d.read_block_allpass(target, 9.5f, state));
+}
+
+SECTION("allpass, fractional delay", "")
+{
+  // After the transient, a ramp is delayed exactly by the phase delay at DC
+  apf::BlockDelayLine<float> line(4, 8);
+  apf::NonCausalBlockDelayLine<float> nc(4, 8, 2);
+  apf::BlockDelayLine<float>::allpass_state state, nc_state;
+  float ramp[4], nc_target[4];
+  for (int block = 0; block < 10; ++block)
+  {
+    for (int i = 0; i < 4; ++i) ramp[i] = static_cast<float>(block * 4 + i);
+    line.write_block(ramp);
+    nc.write_block(ramp);
+    CHECK(line.read_block_allpass(target, 2.5f, state));
+    CHECK(nc.read_block_allpass(nc_target, 0.5f, nc_state));
+    CHECK_RANGE(nc_target, target, 4);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    CHECK(target[i] == Approx(ramp[i] - 2.5f));
+  }
+}
+
+SECTION("non-causal", "")
+{
+  apf::NonCausalBlockDelayLine<float> nc(4, 8, 2);
+  nc.write_block(src);
+  nc.write_block(src+4);
+  nc.write_block(src+8);
+
+  CHECK(nc.fractional_delay_is_valid<linear>(-2.0f));
+  CHECK_FALSE(nc.fractional_delay_is_valid<linear>(-2.5f));
+  CHECK(nc.read_block_fractional<linear>(target, 0.5f));
+  float expected[4] = { 6.5f, 7.5f, 8.5f, 9.5f };
+  CHECK_RANGE(target, expected, 4);
+}
+
+} // TEST_CASE
+
+TEST_CASE("multi-tap read", "Test read_blocks()")
+{
+
+int src[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+apf::BlockDelayLine<int> d(3, 5);
+d.write_block(src);
+d.write_block(src+3);
+d.write_block(src+6);
+d.write_block(src);  // the storage wraps around at least once
+
+int target[4][3] = {};
+int* destinations[] = { target[0], target[1], target[2], target[3] };
+
+SECTION("valid delays", "")
+{
+  size_t delays[] = { 0, 1, 4, 5 };
+  int weights[] = { 1, 2, 1, 3 };
+
+  CHECK(d.read_blocks(delays, delays + 4, weights, destinations));
+
+  int expected[4][3];
+  for (int tap = 0; tap < 4; ++tap)
+  {
+    d.read_block(expected[tap], delays[tap], weights[tap]);
+    INFO("tap " << tap);
+    CHECK_RANGE(target[tap], expected[tap], 3);
+  }
+  int expected0[3] = { 1, 2, 3 };
+  CHECK_RANGE(target[0], expected0, 3);
+  int expected3[3] = { 15, 18, 21 };
+  CHECK_RANGE(target[3], expected3, 3);
+}
+
+SECTION("invalid delay", "")
+{
+  size_t delays[] = { 2, 6 };
+  int weights[] = { 1, 1 };
+
+  CHECK_FALSE(d.read_blocks(delays, delays + 2, weights, destinations));
+
+  int expected0[3] = { 8, 9, 1 };
+  CHECK_RANGE(target[0], expected0, 3);
+  int expected1[3] = { 0, 0, 0 };
+  CHECK_RANGE(target[1], expected1, 3);
+}
+
+SECTION("non-causal", "")
+{
+  apf::NonCausalBlockDelayLine<int> nc(3, 4, 1);
+  nc.write_block(src);
+  nc.write_block(src+3);
+
+  apf::NonCausalBlockDelayLine<int>::difference_type delays[] = { -1, 2, -2 };
+  int weights[] = { 1, 1, 1 };
+
+  CHECK_FALSE(nc.read_blocks(delays, delays + 3, weights, destinations));
+
+  int expected0[3] = { 4, 5, 6 };
+  CHECK_RANGE(target[0], expected0, 3);
+  int expected1[3] = { 1, 2, 3 };
+  CHECK_RANGE(target[1], expected1, 3);
+}
+
+} // TEST_CASE
+
+TEST_CASE("mirrored block delay line"
+    , "Test BlockDelayLine with MirroredBuffer")
+{
+
+using mirrored = apf::MirroredBuffer<float>;
+auto granularity = mirrored::granularity();
+
+float src[] = { 1, 2, 3, 4, 5, 6 };
+float target[3] = { 0 };
+
+// The storage is rounded up, so we can't rely on the wrap-around happening
+// at a certain position. Therefore, we write enough blocks to fill the whole
+// storage at least once.
+auto blocks = static_cast<int>(granularity / 3 + 3);
+
+SECTION("read_block", "")
+{
+  apf::BlockDelayLine<float, mirrored> d(3, 5);
+  float expected[3] = { 4, 5, 6 };
+  for (int block = 0; block < blocks; ++block)
+  {
+    d.write_block(src + 3 * (block % 2));
+    CHECK(d.read_block(target, 0));
+    CHECK_RANGE(target, src + 3 * (block % 2), 3);
+    if (block == 0) continue;
+    // One sample from the previous block, two samples from the current one
+    CHECK(d.read_block(target, 1));
+    expected[0] = src[3 * ((block + 1) % 2) + 2];
+    expected[1] = src[3 * (block % 2)];
+    expected[2] = src[3 * (block % 2) + 1];
+    CHECK_RANGE(target, expected, 3);
+  }
+}
+
+SECTION("read_blocks", "")
+{
+  apf::BlockDelayLine<float, mirrored> d(3, 5);
+  size_t delays[] = { 2, 3 };
+  float weights[] = { 1, 2 };
+  float target2[3] = { 0 };
+  float* destinations[] = { target, target2 };
+  for (int block = 0; block < blocks; ++block)
+  {
+    d.write_block(src + 3 * (block % 2));
+  }
+  CHECK(d.read_blocks(delays, delays + 2, weights, destinations));
+  auto current = src + 3 * ((blocks - 1) % 2);
+  auto previous = src + 3 * (blocks % 2);
+  float expected[] = { previous[1], previous[2], current[0] };
+  CHECK_RANGE(target, expected, 3);
+  float expected2[] = { 2 * previous[0], 2 * previous[1], 2 * previous[2] };
+  CHECK_RANGE(target2, expected2, 3);
+}
+
+SECTION("fractional", "")
+{
+  apf::BlockDelayLine<float, mirrored> d(3, 5);
+  for (int block = 0; block < blocks; ++block)
+  {
+    d.write_block(src + 3 * (block % 2));
+  }
+  CHECK(d.read_block_fractional<apf::linear_interpolation<float>>(target
+        , 0.5f));
+  auto current = src + 3 * ((blocks - 1) % 2);
+  auto previous = src + 3 * (blocks % 2);
+  float expected[] = { (previous[2] + current[0]) / 2
+    , (current[0] + current[1]) / 2, (current[1] + current[2]) / 2 };
+  CHECK_RANGE(target, expected, 3);
+}
+
+SECTION("odd block size", "")
+{
+  // Rounding would need too much memory, the storage is not mirrored
+  const size_t block_size = 441;
+  apf::BlockDelayLine<float, mirrored> d(block_size, 48000);
+  std::vector<float> input(block_size), output(block_size);
+  for (int block = 0; block < 200; ++block)
+  {
+    for (size_t i = 0; i < block_size; ++i)
+    {
+      input[i] = static_cast<float>(size_t(block) * block_size + i);
+    }
+    d.write_block(input.begin());
+  }
+  CHECK(d.read_block(output.begin(), 1000));
+  CHECK(output[0] == input[0] - 1000.0f);
+  CHECK(output[440] == input[440] - 1000.0f);
+}
+
+} // TEST_CASE
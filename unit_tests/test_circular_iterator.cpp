@@ -251,3 +251,61 @@ TEST_CASE("iterators/circular_iterator/3"
   CHECK(*it == 0);
 
 } // TEST_CASE
+
+TEST_CASE("iterators/circular_iterator/4"
+    , "Test contiguous spans, apf::copy() and apf::transform()")
+{
+
+int a[] = { 0, 1, 2, 3, 4 };
+int target[5] = { 0 };
+
+SECTION("spans without wrap-around", "")
+{
+  ci iter(&a[0], &a[5], &a[1]);
+  auto spans = iter.spans(3);
+  CHECK(spans.first.begin() == &a[1]);
+  CHECK(spans.first.end() == &a[4]);
+  CHECK(spans.second.begin() == spans.second.end());
+
+  spans = iter.spans(4);
+  CHECK(spans.first.end() == &a[5]);
+  CHECK(spans.second.begin() == spans.second.end());
+}
+
+SECTION("spans with wrap-around", "")
+{
+  ci iter(&a[0], &a[5], &a[3]);
+  auto spans = iter.spans(5);
+  CHECK(spans.first.begin() == &a[3]);
+  CHECK(spans.first.end() == &a[5]);
+  CHECK(spans.second.begin() == &a[0]);
+  CHECK(spans.second.end() == &a[3]);
+
+  spans = iter.spans(0);
+  CHECK(spans.first.begin() == spans.first.end());
+  CHECK(spans.second.begin() == spans.second.end());
+}
+
+SECTION("copy", "")
+{
+  ci iter(&a[0], &a[5], &a[3]);
+  CHECK(apf::copy(iter, iter + 4, target) == &target[4]);
+  CHECK(target[0] == 3);
+  CHECK(target[1] == 4);
+  CHECK(target[2] == 0);
+  CHECK(target[3] == 1);
+  CHECK(target[4] == 0);
+}
+
+SECTION("transform", "")
+{
+  ci iter(&a[0], &a[5], &a[4]);
+  CHECK(apf::transform(iter, iter + 3, target, [] (int x) { return 2 * x; })
+      == &target[3]);
+  CHECK(target[0] == 8);
+  CHECK(target[1] == 0);
+  CHECK(target[2] == 2);
+  CHECK(target[3] == 0);
+}
+
+} // TEST_CASE
@@ -1,5 +1,11 @@
 #include "apf/convolver.h"
 
+#include <chrono>
+#include <cmath>  // for std::pow()
+#include <list>
+#include <thread>
+#include <vector>
+
 #include "catch/catch.hpp"
 
 #define CHECK_RANGE(left, right, range) \
@@ -212,6 +218,467 @@ SECTION("combinations", "")
   CHECK_RANGE(result, zeros, 8);
 }
 
+SECTION("overlapping filter changes", "")
+{
+  // Each input block is convolved with the filter which was set when the
+  // block arrived.  Filters with gain g have an impulse at the beginning of
+  // each partition, the input is an impulse at the beginning of each block.
+  const size_t p = 4;
+  auto make_filter = [](float g)
+  {
+    float data[32] = { 0.0f };
+    for (int i = 0; i < 32; i += 8) data[i] = g;
+    return c::Filter(8, data, data + 32);
+  };
+  auto conv = c::Convolver(8, p);
+  float input[8] = { 1.0f };
+
+  // Gains of new filters per block (4 is overwritten in the same block)
+  std::vector<std::vector<float>> changes{
+    {1}, {2}, {}, {4, 8}, {}, {}, {16}, {}, {}, {}, {} };
+  std::list<c::Filter> filters;  // must be kept alive
+  std::vector<float> gains;  // current gain per block
+
+  for (size_t n = 0; n < changes.size(); ++n)
+  {
+    conv.add_block(input);
+    if (!conv.queues_empty()) conv.rotate_queues();
+    for (auto g: changes[n])
+    {
+      filters.push_back(make_filter(g));
+      conv.set_filter(filters.back());
+    }
+    gains.push_back(changes[n].empty() ? gains.back() : changes[n].back());
+
+    float expected = 0.0f;
+    for (size_t k = 0; k < p && k <= n; ++k) expected += gains[n - k];
+
+    INFO("n = " << n);
+    CHECK(conv.convolve()[0] == Approx(expected));
+  }
+  CHECK(conv.queues_empty());
+}
+
+SECTION("split convolution", "")
+{
+  const size_t p = 16;
+  std::vector<float> coefficients(8 * p);
+  for (size_t i = 0; i < coefficients.size(); ++i)
+  {
+    coefficients[i] = float(i % 7) - 3.0f;
+  }
+  auto filter1 = c::Filter(8, coefficients.begin(), coefficients.end());
+  auto filter2 = c::Filter(8, coefficients.rbegin(), coefficients.rend());
+
+  auto reference = c::Convolver(8, p);
+  auto split = c::Convolver(8, p);
+
+  CHECK(split.parts() == 1);
+  CHECK(split.split(8, 4) == 4);
+  CHECK(split.split(2, 9) == 1);
+  CHECK(split.split(3) == 3);
+  CHECK(split.parts() == 3);
+
+  reference.set_filter(filter1);
+  split.set_filter(filter1);
+
+  for (size_t n = 0; n < 40; ++n)
+  {
+    // some silent blocks to check the handling of all-zero parts
+    float input[8] = { 0.0f };
+    if (n < 4 || (n > 20 && n % 3 == 0))
+    {
+      for (size_t i = 0; i < 8; ++i) input[i] = float((n + i) % 5) - 2.0f;
+    }
+
+    reference.add_block(input);
+    split.add_block(input);
+    if (!reference.queues_empty()) reference.rotate_queues();
+    if (!split.queues_empty()) split.rotate_queues();
+    if (n == 10)
+    {
+      reference.set_filter(filter2);
+      split.set_filter(filter2);
+    }
+
+    // The order of the parts within one step doesn't matter
+    for (size_t part = split.parts(); part > 0; --part)
+    {
+      split.multiply_part(part - 1);
+    }
+    for (size_t part = split.parts(); part > 0; --part)
+    {
+      split.reduce_part(part - 1);
+    }
+
+    float* expected = reference.convolve(0.5f);
+    result = split.finish(0.5f);
+
+    INFO("n = " << n);
+    CHECK_RANGE(result, expected, 8);
+  }
+}
+
+SECTION("prepare_filter() during add_block()", "")
+{
+  std::vector<float> coefficients(8 * 20);
+  for (size_t i = 0; i < coefficients.size(); ++i)
+  {
+    coefficients[i] = float(i % 7) - 3.0f;
+  }
+  auto expected = c::Filter(8, coefficients.begin(), coefficients.end());
+
+  auto conv = c::Convolver(8, 4);
+  auto prepared = c::Filter(8, expected.partitions());
+  std::thread preparer([&]()
+      {
+        for (int i = 0; i < 20; ++i)
+        {
+          conv.prepare_filter(coefficients.begin(), coefficients.end()
+              , prepared);
+        }
+      });
+  float input[8] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+  for (int i = 0; i < 200; ++i)
+  {
+    conv.add_block(input);
+  }
+  preparer.join();
+
+  for (size_t p = 0; p < expected.partitions(); ++p)
+  {
+    INFO("p = " << p);
+    CHECK_RANGE(prepared[p].data(), expected[p].data(), 16);
+  }
+}
+
+SECTION("MultiInput", "")
+{
+  const size_t channels = 3, p = 2;
+  auto filter1 = c::Filter(8, filter_data, filter_data + 16);
+
+  auto multi = c::MultiInput(8, p, channels);
+  CHECK(multi.channels() == channels);
+
+  std::vector<c::Input> inputs;
+  std::vector<c::StaticOutput> outputs, multi_outputs;
+  inputs.reserve(channels);
+  outputs.reserve(channels);
+  multi_outputs.reserve(channels);
+  for (size_t i = 0; i < channels; ++i)
+  {
+    inputs.emplace_back(8, p);
+    outputs.emplace_back(inputs.back(), filter1);
+    multi_outputs.emplace_back(multi[i], filter1);
+  }
+
+  float data[channels][8];
+  for (size_t n = 0; n < 12; ++n)
+  {
+    // all channels, one channel (not batched) and no channel active
+    for (size_t i = 0; i < channels; ++i)
+    {
+      bool active = n < 4 || (n < 8 && i == 1);
+      for (size_t k = 0; k < 8; ++k)
+      {
+        data[i][k] = active ? float((n + 3 * i + k) % 7) - 3.0f : 0.0f;
+      }
+    }
+
+    float* blocks[channels] = { data[0], data[1], data[2] };
+    multi.add_blocks(blocks);
+
+    for (size_t ch = 0; ch < channels; ++ch)
+    {
+      inputs[ch].add_block(data[ch]);
+      float* expected = outputs[ch].convolve();
+      result = multi_outputs[ch].convolve();
+
+      INFO("n = " << n << ", channel = " << ch);
+      CHECK_RANGE(result, expected, 8);
+    }
+  }
+}
+
+SECTION("two-stage convolution", "")
+{
+  const size_t p = 16;
+  std::vector<float> coefficients(8 * p);
+  for (size_t i = 0; i < coefficients.size(); ++i)
+  {
+    coefficients[i] = float(i % 5) - 2.0f;
+  }
+  auto filter1 = c::Filter(8, coefficients.begin(), coefficients.end());
+  auto filter2 = c::Filter(8, coefficients.rbegin(), coefficients.rend());
+
+  auto reference = c::Convolver(8, p);
+  auto two_stage = c::Convolver(8, p);
+  auto static_reference = c::StaticConvolver(filter1);
+  auto static_two_stage = c::StaticConvolver(filter1);
+
+  CHECK(two_stage.head_partitions() == p);
+  CHECK(two_stage.two_stage(p) == 0);
+  CHECK(two_stage.two_stage(3) == p - 3);
+  CHECK(two_stage.head_partitions() == 3);
+  CHECK(two_stage.split(4) == 3);  // only head partitions are split
+  // Realtime priority, the results must be the same if that's not permitted
+  CHECK(static_two_stage.two_stage(1, 1) == p - 1);
+
+  reference.set_filter(filter1);
+  two_stage.set_filter(filter1);
+
+  for (size_t n = 0; n < 60; ++n)
+  {
+    // some silent blocks to check the handling of all-zero partitions
+    float input[8] = { 0.0f };
+    if (n < 4 || (n > 20 && n % 3 == 0))
+    {
+      for (size_t i = 0; i < 8; ++i) input[i] = float((n + i) % 7) - 3.0f;
+    }
+
+    reference.add_block(input);
+    two_stage.add_block(input);
+    static_reference.add_block(input);
+    static_two_stage.add_block(input);
+    if (!reference.queues_empty()) reference.rotate_queues();
+    if (!two_stage.queues_empty()) two_stage.rotate_queues();
+    // overlapping filter changes
+    if (n == 10 || n == 40 || n == 45)
+    {
+      auto& next = n == 40 ? filter1 : filter2;
+      reference.set_filter(next);
+      two_stage.set_filter(next);
+    }
+
+    INFO("n = " << n);
+    float* expected = reference.convolve();
+    result = two_stage.convolve();
+    CHECK_RANGE(result, expected, 8);
+    expected = static_reference.convolve();
+    result = static_two_stage.convolve();
+    CHECK_RANGE(result, expected, 8);
+
+    // The results must be the same, regardless of the background thread
+    // being in time or not
+    if (n % 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(two_stage.deadline_misses() <= 60);
+
+  // Switch off
+  CHECK(two_stage.two_stage(p) == 0);
+  CHECK(two_stage.deadline_misses() == 0);
+}
+
+SECTION("two-stage convolution, filter change after convolve()", "")
+{
+  const size_t p = 6;
+  std::vector<float> coefficients(8 * p);
+  for (size_t i = 0; i < coefficients.size(); ++i)
+  {
+    coefficients[i] = float(i % 3) - 1.0f;
+  }
+  auto filter1 = c::Filter(8, coefficients.begin(), coefficients.end());
+  auto filter2 = c::Filter(8, coefficients.rbegin(), coefficients.rend());
+
+  auto reference = c::Convolver(8, p);
+  auto two_stage = c::Convolver(8, p);
+
+  reference.set_filter(filter1);
+  two_stage.set_filter(filter1);
+
+  for (size_t n = 0; n < 30; ++n)
+  {
+    float input[8];
+    for (size_t i = 0; i < 8; ++i) input[i] = float((n + i) % 5) - 2.0f;
+
+    // Switched on when the input spectra aren't empty anymore
+    if (n == 3) CHECK(two_stage.two_stage(1) == p - 1);
+
+    reference.add_block(input);
+    two_stage.add_block(input);
+    if (!reference.queues_empty()) reference.rotate_queues();
+    if (!two_stage.queues_empty()) two_stage.rotate_queues();
+
+    INFO("n = " << n);
+    float* expected = reference.convolve();
+    result = two_stage.convolve();
+    CHECK_RANGE(result, expected, 8);
+
+    // The tail of the next block has already been dispatched
+    if (n == 8 || n == 20)
+    {
+      auto& next = n == 8 ? filter2 : filter1;
+      reference.set_filter(next);
+      two_stage.set_filter(next);
+    }
+  }
+}
+
+SECTION("truncation", "")
+{
+  // Exponential decay, 20 dB per partition, partition 2 is silent
+  const size_t p = 8;
+  std::vector<float> coefficients(8 * p);
+  for (size_t i = 0; i < coefficients.size(); ++i)
+  {
+    coefficients[i] = std::pow(10.0f, -float(i) / 8.0f)
+      * (i % 2 ? 1.0f : -0.5f);
+  }
+  std::fill(coefficients.begin() + 16, coefficients.begin() + 24, 0.0f);
+
+  auto full = c::Filter(8, coefficients.begin(), coefficients.end());
+  auto truncated = c::Filter(8, coefficients.begin(), coefficients.end());
+
+  // Parseval
+  float energy = 0.0f;
+  for (size_t i = 0; i < 8; ++i) energy += coefficients[i] * coefficients[i];
+  CHECK(c::Filter::energy(full[0]) == Approx(energy));
+  CHECK(c::Filter::energy(full[2]) == 0.0f);
+
+  CHECK(truncated.active_partitions() == p - 1);
+  CHECK(truncated.effective_partitions() == p);
+  CHECK(truncated.truncate(-200.0f) == 0);
+  // partitions 0, 1, 3 are within 70 dB (energy decays 20 dB per partition)
+  CHECK(truncated.truncate(-70.0f) == 4);
+  CHECK(truncated.active_partitions() == 3);
+  CHECK(truncated.effective_partitions() == 4);
+
+  auto reference = c::StaticConvolver(full, p);
+  // By default, only effective_partitions() are used
+  auto conv = c::StaticConvolver(truncated);
+  CHECK(conv.head_partitions() == 4);
+
+  // With all partitions, the zero ones are skipped.  All tail partitions are
+  // zero, so the background thread has nothing to do and is never late.
+  auto two_stage = c::Convolver(8, p);
+  CHECK(two_stage.two_stage(4) == p - 4);
+  two_stage.set_filter(truncated);
+
+  for (size_t n = 0; n < 12; ++n)
+  {
+    float input[8] = { 0.0f };
+    if (n < 2) input[n * 3] = 1.0f;
+    reference.add_block(input);
+    conv.add_block(input);
+    two_stage.add_block(input);
+    if (!two_stage.queues_empty()) two_stage.rotate_queues();
+
+    INFO("n = " << n);
+    float* expected = reference.convolve();
+    result = conv.convolve();
+    for (size_t i = 0; i < 8; ++i)
+    {
+      CHECK(result[i] == Approx(expected[i]).margin(1e-3));
+    }
+    result = two_stage.convolve();
+    for (size_t i = 0; i < 8; ++i)
+    {
+      CHECK(result[i] == Approx(expected[i]).margin(1e-3));
+    }
+    // Input partitions contain two blocks, the impulses are in 3 of them.
+    // Filter partition 2 is zero.
+    size_t active[] = { 1, 2, 2, 2, 1, 1, 0 };
+    CHECK(conv.active_partitions() == active[std::min(n, size_t(6))]);
+    CHECK(two_stage.active_partitions() == active[std::min(n, size_t(6))]);
+  }
+  CHECK(two_stage.deadline_misses() == 0);
+}
+
+SECTION("NUMA node", "")
+{
+  // Without APF_USE_NUMA (or without NUMA support), the node is only stored
+  auto reference = c::Convolver(8, 4);
+  auto local = c::Convolver(8, 4, 0);
+  auto static_local = c::StaticConvolver(filter, 0, 0);
+  CHECK(reference.spectra.numa_node() == -1);
+  CHECK(local.spectra.numa_node() == 0);
+  CHECK(static_local.spectra.numa_node() == 0);
+  CHECK(local.two_stage(1) == 3);
+
+  reference.set_filter(filter);
+  local.set_filter(filter);
+
+  for (size_t n = 0; n < 4; ++n)
+  {
+    INFO("n = " << n);
+    reference.add_block(test_signal + 2 * n);
+    local.add_block(test_signal + 2 * n);
+    static_local.add_block(test_signal + 2 * n);
+    if (!reference.queues_empty()) reference.rotate_queues();
+    if (!local.queues_empty()) local.rotate_queues();
+    float* expected = reference.convolve();
+    result = local.convolve();
+    CHECK_RANGE(result, expected, 8);
+    result = static_local.convolve();
+    CHECK_RANGE(result, expected, 8);
+  }
+}
+
+SECTION("FilterDatabase", "")
+{
+  // +x, -x, +y, -y, +z, -z
+  std::vector<c::FilterDatabase::vector_t> directions{
+    {{ 1.0f, 0.0f, 0.0f }}, {{ -1.0f, 0.0f, 0.0f }}
+    , {{ 0.0f, 1.0f, 0.0f }}, {{ 0.0f, -1.0f, 0.0f }}
+    , {{ 0.0f, 0.0f, 1.0f }}, {{ 0.0f, 0.0f, -1.0f }} };
+  // Impulse with amplitude k + 1 at position 2 * k
+  std::vector<std::vector<float>> irs;
+  for (size_t k = 0; k < directions.size(); ++k)
+  {
+    irs.emplace_back(2 * k + 1, 0.0f);
+    irs.back().back() = float(k + 1);
+  }
+
+  auto db = c::FilterDatabase(8, directions.begin(), directions.end()
+      , irs.begin());
+  CHECK(db.size() == 6);
+  CHECK(db.block_size() == 8);
+  CHECK(db.partitions() == 2);  // longest impulse response: 11
+  CHECK(db.index().triangles() == 8);
+
+  CHECK(&db.nearest({{ 1.0f, 0.1f, -0.2f }}) == &db[0]);
+  CHECK(&db.nearest({{ 0.1f, 0.1f, -2.0f }}) == &db[5]);
+
+  auto w = db.weights({{ 1.0f, 1.0f, 1.0f }});
+  float total = 0.0f;
+  for (auto& item: w)
+  {
+    CHECK((item.first == &db[0] || item.first == &db[2]
+          || item.first == &db[4]));
+    CHECK(item.second == Approx(1.0f / 3.0f));
+    total += item.second;
+  }
+  CHECK(total == Approx(1.0f));
+
+  auto interpolated = c::Filter(8, db.partitions());
+  db.interpolate({{ 1.0f, 1.0f, 1.0f }}, interpolated);
+  auto conv = c::StaticConvolver(interpolated);
+
+  float impulse[8] = { 1.0f };
+  float expected[16] = { 0.0f };
+  expected[0] = 1.0f / 3.0f;
+  expected[4] = 1.0f;
+  expected[8] = 5.0f / 3.0f;
+
+  conv.add_block(impulse);
+  result = conv.convolve();
+  CHECK_RANGE(result, expected, 8);
+  conv.add_block(zeros);
+  result = conv.convolve();
+  CHECK_RANGE(result, expected + 8, 8);
+
+  // Exactly at one of the directions.
+  // A new filter is used, because the first one is still used by conv.
+  auto interpolated2 = c::Filter(8, db.partitions());
+  db.interpolate({{ 0.0f, -3.0f, 0.0f }}, interpolated2);
+  auto conv2 = c::StaticConvolver(interpolated2);
+  std::fill(expected, expected + 16, 0.0f);
+  expected[6] = 4.0f;
+  conv2.add_block(impulse);
+  result = conv2.convolve();
+  CHECK_RANGE(result, expected, 8);
+}
+
 // TODO: test copy_nested() and transform_nested()!
 
 } // TEST_CASE
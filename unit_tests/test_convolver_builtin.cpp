@@ -0,0 +1,4 @@
+// Same tests as in test_convolver.cpp, but with the built-in FFT.
+
+#define APF_CONVOLVER_BUILTIN_FFT
+#include "test_convolver.cpp"
@@ -0,0 +1,186 @@
+#include "apf/directionindex.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "catch/catch.hpp"
+
+using vector_t = apf::DirectionIndex::vector_t;
+
+namespace
+{
+
+float dot(const vector_t& a, const vector_t& b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/// Regular grid of azimuth and elevation angles (plus both poles).
+std::vector<vector_t> grid(float azimuth_step, float elevation_step)
+{
+  std::vector<vector_t> result;
+  result.push_back({{ 0.0f, 0.0f, 1.0f }});
+  result.push_back({{ 0.0f, 0.0f, -1.0f }});
+  for (float el = -90.0f + elevation_step; el < 90.0f; el += elevation_step)
+  {
+    for (float az = 0.0f; az < 360.0f; az += azimuth_step)
+    {
+      result.push_back(apf::DirectionIndex::from_degrees(az, el));
+    }
+  }
+  return result;
+}
+
+}  // unnamed namespace
+
+TEST_CASE("DirectionIndex", "Test DirectionIndex")
+{
+
+SECTION("invalid directions", "")
+{
+  std::vector<vector_t> none;
+  CHECK_THROWS_AS(apf::DirectionIndex(none.begin(), none.end())
+      , std::logic_error);
+  std::vector<vector_t> zero{{{ 0.0f, 0.0f, 0.0f }}};
+  CHECK_THROWS_AS(apf::DirectionIndex(zero.begin(), zero.end())
+      , std::logic_error);
+}
+
+SECTION("from_degrees", "")
+{
+  auto v = apf::DirectionIndex::from_degrees(90.0f, 0.0f);
+  CHECK(v[0] == Approx(0.0f).margin(1e-6));
+  CHECK(v[1] == Approx(1.0f));
+  CHECK(v[2] == Approx(0.0f).margin(1e-6));
+  CHECK(apf::DirectionIndex::from_degrees(0.0f, 90.0f)[2] == Approx(1.0f));
+}
+
+SECTION("few directions", "")
+{
+  // not normalized, no triangulation possible
+  std::vector<vector_t> dirs{{{ 2.0f, 0.0f, 0.0f }}, {{ 0.0f, 3.0f, 0.0f }}};
+  apf::DirectionIndex index(dirs.begin(), dirs.end());
+  CHECK(index.size() == 2);
+  CHECK(index[0][0] == 1.0f);
+  CHECK(index.triangles() == 0);
+  CHECK(index.nearest({{ 1.0f, 0.9f, 0.0f }}) == 0);
+  CHECK(index.nearest({{ 0.0f, 1.0f, 0.5f }}) == 1);
+
+  auto w = index.weights({{ 0.1f, 1.0f, 0.0f }});
+  CHECK(w[0].first == 1);
+  CHECK(w[0].second == 1.0f);
+  CHECK(w[1].second == 0.0f);
+}
+
+SECTION("nearest", "")
+{
+  auto dirs = grid(5.0f, 10.0f);
+  apf::DirectionIndex index(dirs.begin(), dirs.end());
+
+  for (size_t n = 0; n < 1000; ++n)
+  {
+    auto query = apf::DirectionIndex::from_degrees(float(n) * 1.37f
+        , float(n % 181) - 90.0f);
+
+    size_t expected = 0;
+    for (size_t i = 1; i < dirs.size(); ++i)
+    {
+      if (dot(dirs[i], query) > dot(dirs[expected], query)) expected = i;
+    }
+    auto result = index.nearest(query);
+    // with equal distances, any of them is fine
+    CHECK(dot(dirs[result], query) == Approx(dot(dirs[expected], query)));
+  }
+}
+
+SECTION("weights", "")
+{
+  auto dirs = grid(15.0f, 15.0f);
+  apf::DirectionIndex index(dirs.begin(), dirs.end());
+
+  // closed polyhedron: 2 * vertices - 4 triangles
+  CHECK(index.triangles() == 2 * dirs.size() - 4);
+
+  // exact direction
+  auto w = index.weights(dirs[42]);
+  for (auto& item: w)
+  {
+    if (item.first == 42) CHECK(item.second == Approx(1.0f));
+    else CHECK(item.second == Approx(0.0f).margin(1e-5));
+  }
+
+  for (size_t n = 0; n < 1000; ++n)
+  {
+    auto query = apf::DirectionIndex::from_degrees(float(n) * 2.71f
+        , float(n % 179) - 89.0f);
+    w = index.weights(query);
+
+    // Weighted sum points in the same direction as the query
+    vector_t sum{{ 0.0f, 0.0f, 0.0f }};
+    float total = 0.0f;
+    for (auto& item: w)
+    {
+      CHECK(item.second >= 0.0f);
+      total += item.second;
+      for (size_t k = 0; k < 3; ++k)
+      {
+        sum[k] += item.second * dirs[item.first][k];
+      }
+    }
+    CHECK(total == Approx(1.0f));
+    CHECK(dot(sum, query) / std::sqrt(dot(sum, sum)) == Approx(1.0f));
+
+    // The triangle is close to the query
+    for (auto& item: w)
+    {
+      CHECK(dot(dirs[item.first], query) > std::cos(0.5f));
+    }
+  }
+}
+
+SECTION("duplicate directions", "")
+{
+  // All azimuths at the poles (the vectors differ slightly)
+  std::vector<vector_t> dirs;
+  for (float el = -90.0f; el <= 90.0f; el += 30.0f)
+  {
+    for (float az = 0.0f; az < 360.0f; az += 30.0f)
+    {
+      dirs.push_back(apf::DirectionIndex::from_degrees(az, el));
+    }
+  }
+  apf::DirectionIndex index(dirs.begin(), dirs.end());
+
+  auto unique = dirs.size() - 2 * 11;
+  CHECK(index.triangles() == 2 * unique - 4);
+
+  for (size_t n = 0; n < 100; ++n)
+  {
+    auto query = apf::DirectionIndex::from_degrees(float(n) * 7.3f
+        , float(n % 179) - 89.0f);
+    auto w = index.weights(query);
+    CHECK(w[0].second < 1.0f);  // no fallback
+    CHECK(w[0].second + w[1].second + w[2].second == Approx(1.0f));
+  }
+}
+
+SECTION("hemisphere", "")
+{
+  // Only directions above the horizon, the rest falls back to nearest
+  std::vector<vector_t> dirs;
+  for (auto& dir: grid(30.0f, 30.0f))
+  {
+    if (dir[2] >= 0.0f) dirs.push_back(dir);
+  }
+  apf::DirectionIndex index(dirs.begin(), dirs.end());
+
+  auto w = index.weights({{ 1.0f, 0.2f, 0.4f }});
+  CHECK(w[0].second + w[1].second + w[2].second == Approx(1.0f));
+  CHECK(w[1].second > 0.0f);
+
+  w = index.weights({{ 0.0f, 0.0f, -1.0f }});
+  CHECK(w[0].second + w[1].second + w[2].second == Approx(1.0f));
+}
+
+} // TEST_CASE
@@ -0,0 +1,119 @@
+// Tests for PlaybackStream, RecordStream and DiskStreamer.
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "apf/diskstream.h"
+
+#include "catch/catch.hpp"
+
+#define CHECK_RANGE(left, right, range) \
+  for (int i = 0; i < range; ++i) { \
+    INFO("i = " << i); \
+    CHECK((left)[i] == (right)[i]); }
+
+// In-memory "file" with interleaved data
+struct MemoryFile
+{
+  std::vector<float>* data;
+  size_t channels;
+  size_t position = 0;
+
+  long readf(float* ptr, size_t frames)
+  {
+    size_t i = 0;
+    for (; i < frames && position < data->size(); ++i)
+    {
+      for (size_t c = 0; c < channels; ++c) *ptr++ = (*data)[position++];
+    }
+    return static_cast<long>(i);
+  }
+
+  long writef(const float* ptr, size_t frames)
+  {
+    data->insert(data->end(), ptr, ptr + frames * channels);
+    return static_cast<long>(frames);
+  }
+};
+
+TEST_CASE("disk streaming", "Test PlaybackStream and RecordStream")
+{
+
+SECTION("playback", "")
+{
+  // 2 channels, 5 frames
+  std::vector<float> file{1, 10, 2, 20, 3, 30, 4, 40, 5, 50};
+  apf::PlaybackStream<MemoryFile> stream(MemoryFile{&file, 2}, 2, 2, 2);
+  CHECK(stream.channels() == 2);
+  CHECK_FALSE(stream.end_of_file());
+
+  stream.process();
+  float left1[] = { 1, 2 };
+  float right1[] = { 10, 20 };
+  CHECK_RANGE(stream.channel(0).begin(), left1, 2);
+  CHECK_RANGE(stream.channel(1).begin(), right1, 2);
+
+  stream.process();
+  CHECK(*stream.channel(1).begin() == 30.0f);
+  CHECK(stream.xruns() == 0);
+
+  // The disk thread didn't do anything
+  stream.process();
+  CHECK(stream.xruns() == 1);
+  CHECK(*stream.channel(0).begin() == 0.0f);
+
+  CHECK(stream.service());
+  CHECK(stream.end_of_file());
+  CHECK(stream.service());
+  CHECK_FALSE(stream.service());
+
+  stream.process();
+  float left3[] = { 5, 0 };
+  CHECK_RANGE(stream.channel(0).begin(), left3, 2);
+  stream.process();
+  CHECK(*stream.channel(0).begin() == 0.0f);
+  CHECK(stream.xruns() == 1);
+}
+
+SECTION("record", "")
+{
+  std::vector<float> file;
+  {
+    apf::RecordStream<MemoryFile> stream(MemoryFile{&file, 2}, 2, 2, 2);
+    for (int block = 0; block < 3; ++block)
+    {
+      auto left = stream.channel(0).begin();
+      auto right = stream.channel(1).begin();
+      left[0] = float(block); left[1] = float(block) + 0.5f;
+      right[0] = -float(block); right[1] = -float(block) - 0.5f;
+      stream.process();
+    }
+    CHECK(stream.xruns() == 1);
+    CHECK(file.empty());
+    CHECK(stream.service());
+  }
+  // The rest is written in the destructor
+  std::vector<float> expected{0, 0, 0.5f, -0.5f, 1, -1, 1.5f, -1.5f};
+  REQUIRE(file.size() == expected.size());
+  CHECK_RANGE(file, expected, 8);
+}
+
+SECTION("DiskStreamer", "")
+{
+  std::vector<float> file(2 * 1000);
+  for (size_t i = 0; i < file.size(); ++i) file[i] = float(i);
+  apf::PlaybackStream<MemoryFile> stream(MemoryFile{&file, 1}, 1, 10, 4);
+  apf::DiskStreamer streamer(100);
+  streamer.add(stream);
+  for (int block = 0; block < 20; ++block)
+  {
+    stream.process();
+    CHECK(*stream.channel(0).begin() == float(block * 10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  streamer.remove(stream);
+  CHECK(stream.xruns() == 0);
+}
+
+} // TEST_CASE
@@ -0,0 +1,78 @@
+#include "apf/fft.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <stdint.h>  // for uintptr_t
+#include <vector>
+
+#include "catch/catch.hpp"
+
+using fft_vector = std::vector<float, apf::fft::aligned_allocator<float>>;
+
+TEST_CASE("real_fft", "Test real_fft")
+{
+
+SECTION("aligned_allocator", "")
+{
+  apf::fixed_vector<float, apf::fft::aligned_allocator<float>> v(42);
+  CHECK((uintptr_t(v.data()) & 0x1F) == 0);
+}
+
+SECTION("invalid sizes", "")
+{
+  CHECK_THROWS_AS(apf::fft::real_fft(8), std::logic_error);
+  CHECK_THROWS_AS(apf::fft::real_fft(48), std::logic_error);
+  CHECK(apf::fft::real_fft(16).size() == 16);
+}
+
+SECTION("compare with DFT", "")
+{
+  // odd and even number of radix-4 stages, with and without radix-2 stage
+  for (size_t n: {16, 32, 64, 128, 512})
+  {
+    auto fft = apf::fft::real_fft(n);
+    fft_vector signal(n), data(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      signal[i] = float((i * i) % 11) - 5.0f + (i == 3 ? 20.0f : 0.0f);
+    }
+    data = signal;
+    fft.forward(data.data());
+
+    const double pi = 3.14159265358979323846;
+    for (size_t k = 0; k <= n / 2; ++k)
+    {
+      double re = 0.0, im = 0.0;
+      for (size_t i = 0; i < n; ++i)
+      {
+        auto phase = -2.0 * pi * double((k * i) % n) / double(n);
+        re += signal[i] * std::cos(phase);
+        im += signal[i] * std::sin(phase);
+      }
+      // sorted format, see real_fft
+      float real, imag;
+      if (k == n / 2)
+      {
+        real = data[4];
+        imag = 0.0f;
+      }
+      else
+      {
+        real = data[2 * k - k % 4];
+        imag = k == 0 ? 0.0f : data[2 * k - k % 4 + 4];
+      }
+      INFO("n = " << n << ", k = " << k);
+      CHECK(real == Approx(re).epsilon(1e-4).scale(100));
+      CHECK(imag == Approx(im).epsilon(1e-4).scale(100));
+    }
+
+    fft.inverse(data.data());
+    for (size_t i = 0; i < n; ++i)
+    {
+      INFO("n = " << n << ", i = " << i);
+      CHECK(data[i] / float(n) == Approx(signal[i]).scale(1));
+    }
+  }
+}
+
+} // TEST_CASE
@@ -0,0 +1,206 @@
+// Tests for file_io_pipeline() and internal::run_batch().
+
+#include "apf/file_io_pipeline.h"
+
+#include <memory>  // for std::unique_ptr
+#include <stdexcept>  // for std::runtime_error
+#include <vector>
+
+#include "catch/catch.hpp"
+
+#include "apf/mimoprocessor.h"
+#include "apf/pointer_policy.h"
+
+// Output = 2 * input (interleaved), can be told to fail
+struct InterleavedDoubler
+{
+  size_t block_size() const { return 4; }
+  size_t sample_rate() const { return 1000; }
+  int in_channels() const { return 2; }
+  int out_channels() const { return 2; }
+  void activate() { active = true; }
+  void deactivate() { active = false; }
+
+  void audio_callback(size_t n, const float* in, float* out)
+  {
+    if (blocks++ == fail_at) throw std::runtime_error("processor");
+    for (size_t i = 0; i < n * 2; ++i) out[i] = 2.0f * in[i];
+  }
+
+  size_t blocks = 0;
+  size_t fail_at = size_t(-1);
+  bool active = false;
+};
+
+// Output = sum of inputs, using de-interleaved channels
+struct SummingProcessor : public apf::MimoProcessor<SummingProcessor
+                          , apf::pointer_policy<float*>>
+{
+  using Input = MimoProcessorBase::DefaultInput;
+
+  class Output : public MimoProcessorBase::DefaultOutput
+  {
+    public:
+      explicit Output(const Params& p) : MimoProcessorBase::DefaultOutput(p) {}
+
+      APF_PROCESS(Output, MimoProcessorBase::DefaultOutput)
+      {
+        std::fill(this->begin(), this->end(), 0.0f);
+        for (const auto& in: rtlist_proxy<Input>(
+              this->parent.get_input_list()))
+        {
+          std::transform(in.begin(), in.end(), this->begin(), this->begin()
+              , [] (float x, float y) { return x + y; });
+        }
+      }
+  };
+
+  SummingProcessor(const apf::parameter_map& p)
+    : MimoProcessorBase(p)
+  {
+    this->add<Input>();
+    this->add<Input>();
+    this->add<Output>();
+  }
+};
+
+// Reads interleaved frames from a vector
+struct VectorReader
+{
+  size_t operator()(float* data, size_t frames)
+  {
+    if (position == fail_at) throw std::runtime_error("reader");
+    frames = std::min(frames, (source.size() - position) / channels);
+    std::copy(source.begin() + long(position)
+        , source.begin() + long(position + frames * channels), data);
+    position += frames * channels;
+    return frames;
+  }
+
+  const std::vector<float>& source;
+  size_t channels;
+  size_t position = 0;
+  size_t fail_at = size_t(-1);
+};
+
+TEST_CASE("file_io_pipeline", "Test file_io_pipeline()")
+{
+
+std::vector<float> input;
+for (int i = 0; i < 2 * 21; ++i) input.push_back(float(i));
+
+std::vector<float> output;
+auto writer = [&output] (const float* data, size_t frames)
+{
+  output.insert(output.end(), data, data + frames * 2);
+};
+
+apf::file_io_statistics statistics;
+
+SECTION("interleaved", "")
+{
+  InterleavedDoubler processor;
+  apf::file_io_pipeline(processor, VectorReader{input, 2}, writer
+      , statistics, 2);
+
+  CHECK(statistics.blocks == 6);
+  CHECK(statistics.frames == 21);
+  CHECK(statistics.sample_rate == 1000);
+  CHECK_FALSE(processor.active);
+  REQUIRE(output.size() == input.size());
+  for (size_t i = 0; i < input.size(); ++i)
+  {
+    INFO("i = " << i);
+    CHECK(output[i] == 2.0f * input[i]);
+  }
+}
+
+SECTION("de-interleaved", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 8);
+  SummingProcessor processor(p);
+
+  std::vector<float> mono;
+  auto mono_writer = [&mono] (const float* data, size_t frames)
+  {
+    mono.insert(mono.end(), data, data + frames);
+  };
+  apf::file_io_pipeline(processor, VectorReader{input, 2}, mono_writer
+      , statistics);
+
+  CHECK(statistics.blocks == 3);
+  REQUIRE(mono.size() == 21);
+  for (size_t i = 0; i < mono.size(); ++i)
+  {
+    INFO("i = " << i);
+    CHECK(mono[i] == input[2 * i] + input[2 * i + 1]);
+  }
+}
+
+SECTION("exceptions", "")
+{
+  // All threads are stopped and joined, the exception is re-thrown
+  InterleavedDoubler processor;
+  processor.fail_at = 2;
+  CHECK_THROWS_AS(apf::file_io_pipeline(processor, VectorReader{input, 2}
+        , writer, statistics, 2), std::runtime_error);
+  CHECK_FALSE(processor.active);
+
+  processor.fail_at = size_t(-1);
+  auto reader = VectorReader{input, 2};
+  reader.fail_at = 16;
+  CHECK_THROWS_AS(apf::file_io_pipeline(processor, reader, writer
+        , statistics, 2), std::runtime_error);
+
+  auto failing_writer = [] (const float*, size_t)
+  {
+    throw std::runtime_error("writer");
+  };
+  CHECK_THROWS_AS(apf::file_io_pipeline(processor, VectorReader{input, 2}
+        , failing_writer, statistics, 2), std::runtime_error);
+}
+
+SECTION("run_batch", "")
+{
+  const size_t jobs = 10;
+  std::vector<std::vector<float>> outputs(jobs);
+  std::vector<InterleavedDoubler*> used(jobs);
+  size_t created = 0;
+  auto factory = [&created] ()
+  {
+    ++created;
+    return std::unique_ptr<InterleavedDoubler>(new InterleavedDoubler);
+  };
+
+  apf::internal::run_batch(factory, jobs, 3
+      , [&] (InterleavedDoubler& processor, size_t i)
+      {
+        used[i] = &processor;
+        apf::file_io_statistics s;
+        apf::file_io_pipeline(processor, VectorReader{input, 2}
+            , [&outputs, i] (const float* data, size_t frames)
+            {
+              outputs[i].insert(outputs[i].end(), data, data + frames * 2);
+            }
+            , s);
+      });
+
+  CHECK(created == 3);
+  for (size_t i = 0; i < jobs; ++i)
+  {
+    INFO("i = " << i);
+    CHECK(outputs[i].size() == input.size());
+    CHECK(used[i] != nullptr);
+  }
+
+  // An exception in one of the workers is re-thrown
+  CHECK_THROWS_AS(apf::internal::run_batch(factory, jobs, 3
+        , [] (InterleavedDoubler&, size_t i)
+        {
+          if (i == 5) throw std::runtime_error("job");
+        }), std::runtime_error);
+}
+
+} // TEST_CASE file_io_pipeline
@@ -0,0 +1,175 @@
+#include "apf/instrumentation.h"
+
+#include "catch/catch.hpp"
+
+#include "apf/mimoprocessor.h"
+#include "apf/pointer_policy.h"
+
+template<typename instrumentation_policy>
+struct TimedProcessor : public apf::MimoProcessor<
+                        TimedProcessor<instrumentation_policy>
+                        , apf::pointer_policy<float*>, apf::disable_queries
+                        , instrumentation_policy>
+{
+  using base = apf::MimoProcessor<TimedProcessor<instrumentation_policy>
+    , apf::pointer_policy<float*>, apf::disable_queries
+    , instrumentation_policy>;
+  using Input = typename base::DefaultInput;
+  using Output = typename base::DefaultOutput;
+
+  TimedProcessor(const apf::parameter_map& p)
+    : base(p)
+  {
+    this->template add<Input>();
+    this->template add<Output>();
+    this->template add<Output>();
+    this->template add<Output>();
+    this->activate();
+  }
+
+  ~TimedProcessor() { this->deactivate(); }
+};
+
+TEST_CASE("instrumentation", "Test enable_instrumentation")
+{
+
+using stage = apf::instrumentation_stage;
+
+SECTION("MimoProcessor", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 2);
+  p.set("timing_blocks", 2);
+  TimedProcessor<apf::enable_instrumentation> processor(p);
+
+  CHECK(processor.block_period() == 0.004);
+
+  float data[12] = { 0 };
+  float* in[] = { data };
+  float* out[] = { data, data, data };
+
+  processor.item_timing(true);
+  // 3 blocks, but only 2 can be stored
+  processor.audio_callback(12, in, out);
+  CHECK(processor.dropped_timings() == 1);
+
+  std::vector<apf::block_timing> timings;
+  CHECK(processor.read_timings([&timings](const apf::block_timing& t)
+        {
+          timings.push_back(t);
+        }) == 2);
+  CHECK(processor.read_timings([](const apf::block_timing&) {}) == 0);
+
+  for (const auto& t: timings)
+  {
+    double sum = 0;
+    for (auto s: t.stages) { CHECK(s >= 0); sum += s; }
+    CHECK(t.total == Approx(sum));
+    CHECK(t.load == Approx(t.total / 0.004));
+    REQUIRE(t.threads.size() == 2);
+    CHECK(t.threads[0].busy > 0);
+    CHECK(t.threads[1].busy > 0);
+    CHECK(t.threads[0].slowest_item != nullptr);
+    CHECK(t.threads[0].busy <= t.stage(stage::inputs) + t.stage(stage::outputs));
+  }
+
+  processor.item_timing(false);
+  processor.audio_callback(4, in, out);
+  CHECK(processor.read_timings([](const apf::block_timing& t)
+        {
+          CHECK(t.threads[0].slowest_item == nullptr);
+        }) == 1);
+}
+
+SECTION("item profiling", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 2);
+  TimedProcessor<apf::enable_item_profiling> processor(p);
+
+  float data[12] = { 0 };
+  float* in[] = { data };
+  float* out[] = { data, data, data };
+
+  processor.audio_callback(12, in, out);
+
+  auto items = processor.most_expensive_items(10);
+  // 1 input, 3 outputs
+  REQUIRE(items.size() == 4);
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    INFO("i = " << i);
+    CHECK(items[i].item != nullptr);
+    CHECK(items[i].count == 3);
+    CHECK(items[i].max <= items[i].total);
+    CHECK(items[i].mean() == Approx(items[i].total / 3));
+    if (i > 0) CHECK(items[i].total <= items[i - 1].total);
+  }
+  CHECK(processor.most_expensive_items(2).size() == 2);
+  CHECK(processor.untracked_items() == 0);
+
+  processor.reset_item_profile();
+  processor.audio_callback(4, in, out);
+  items = processor.most_expensive_items(10);
+  REQUIRE(items.size() == 4);
+  CHECK(items[0].count == 1);
+
+  // Commands are executed immediately when the processor is not active
+  processor.deactivate();
+  CHECK_NOTHROW(processor.balance_threads());
+}
+
+SECTION("item profiling with too many items", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 1);
+  p.set("profiled_items", 1);  // space for 2 items
+  TimedProcessor<apf::enable_item_profiling> processor(p);
+
+  float data[4] = { 0 };
+  float* in[] = { data };
+  float* out[] = { data, data, data };
+
+  processor.audio_callback(4, in, out);
+  CHECK(processor.most_expensive_items(10).size() == 2);
+  CHECK(processor.untracked_items() == 2);
+}
+
+SECTION("timing_statistics", "")
+{
+  apf::timing_statistics stats;
+  CHECK(stats.blocks() == 0);
+  CHECK(stats.load().max == 0);
+
+  apf::block_timing t;
+  t.threads.resize(1);
+  for (int i = 1; i <= 200; ++i)
+  {
+    t.load = i / 100.0;
+    t.stages[static_cast<size_t>(stage::process)] = i;
+    t.threads[0].busy = 2 * i;
+    stats.add(t);
+  }
+
+  CHECK(stats.blocks() == 200);
+  CHECK(stats.overloads() == 100);
+  CHECK(stats.stage(stage::process).p50 == 100);
+  CHECK(stats.stage(stage::process).p99 == 198);
+  CHECK(stats.stage(stage::process).max == 200);
+  CHECK(stats.stage(stage::inputs).max == 0);
+  CHECK(stats.load().max == 2.0);
+  REQUIRE(stats.threads() == 1);
+  CHECK(stats.thread(0).p50 == 200);
+
+  stats.clear();
+  CHECK(stats.blocks() == 0);
+  CHECK(stats.overloads() == 0);
+}
+
+} // TEST_CASE instrumentation
@@ -0,0 +1,62 @@
+// Tests for deinterleave() and interleave().
+
+#include <vector>
+
+#include "apf/interleave.h"
+
+#include "catch/catch.hpp"
+
+#define CHECK_RANGE(left, right, range) \
+  for (int i = 0; i < range; ++i) { \
+    INFO("i = " << i); \
+    CHECK((left)[i] == (right)[i]); }
+
+template<typename T>
+void check_roundtrip(size_t channels, size_t frames)
+{
+  std::vector<T> interleaved(channels * frames);
+  for (size_t i = 0; i < interleaved.size(); ++i)
+  {
+    interleaved[i] = static_cast<T>(i);
+  }
+
+  std::vector<std::vector<T>> separate(channels, std::vector<T>(frames));
+  std::vector<T*> ptrs;
+  for (auto& channel: separate) ptrs.push_back(channel.data());
+
+  apf::deinterleave(interleaved.data(), channels, frames, ptrs.data());
+  for (size_t c = 0; c < channels; ++c)
+  {
+    for (size_t i = 0; i < frames; ++i)
+    {
+      INFO("channel " << c << ", frame " << i);
+      CHECK(separate[c][i] == static_cast<T>(i * channels + c));
+    }
+  }
+
+  std::vector<T> result(channels * frames);
+  apf::interleave(ptrs.data(), channels, frames, result.data());
+  CHECK_RANGE(result, interleaved, static_cast<int>(result.size()));
+}
+
+TEST_CASE("interleave", "Test deinterleave() and interleave()")
+{
+
+SECTION("float", "")
+{
+  for (size_t channels = 1; channels <= 5; ++channels)
+  {
+    INFO("channels = " << channels);
+    check_roundtrip<float>(channels, 0);
+    check_roundtrip<float>(channels, 3);
+    check_roundtrip<float>(channels, 17);
+  }
+}
+
+SECTION("int", "")
+{
+  check_roundtrip<int>(2, 9);
+  check_roundtrip<int>(3, 5);
+}
+
+} // TEST_CASE
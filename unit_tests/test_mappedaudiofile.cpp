@@ -0,0 +1,156 @@
+// Tests for MappedAudioFile.
+
+#include <cstdint>  // for uint64_t
+#include <cstdio>  // for std::remove()
+#include <cstring>  // for std::memcpy()
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "apf/mappedaudiofile.h"
+
+#include "catch/catch.hpp"
+
+namespace
+{
+
+struct file_writer
+{
+  std::string data;
+
+  void id(const char* s) { data.append(s, 4); }
+
+  void le(uint64_t value, int bytes)
+  {
+    for (int i = 0; i < bytes; ++i)
+    {
+      data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+
+  void be(uint64_t value, int bytes)
+  {
+    for (int i = bytes - 1; i >= 0; --i)
+    {
+      data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+
+  void samples(const std::vector<float>& samples)
+  {
+    data.append(reinterpret_cast<const char*>(samples.data())
+        , samples.size() * sizeof(float));
+  }
+
+  void save(const std::string& name)
+  {
+    std::ofstream(name, std::ios::binary) << data;
+  }
+};
+
+std::vector<float> samples{1, 10, 2, 20, 3, 30};
+
+void write_wav(const std::string& name, int format, bool rf64 = false)
+{
+  file_writer w;
+  w.id(rf64 ? "RF64" : "RIFF"); w.le(rf64 ? 0xFFFFFFFF : 0, 4); w.id("WAVE");
+  if (rf64)
+  {
+    w.id("ds64"); w.le(28, 4);
+    w.le(0, 8); w.le(samples.size() * 4, 8); w.le(3, 8); w.le(0, 4);
+  }
+  w.id("fmt "); w.le(16, 4);
+  w.le(static_cast<unsigned>(format), 2); w.le(2, 2); w.le(44100, 4);
+  w.le(44100 * 8, 4); w.le(8, 2); w.le(32, 2);
+  w.id("data"); w.le(rf64 ? 0xFFFFFFFF : samples.size() * 4, 4);
+  w.samples(samples);
+  w.save(name);
+}
+
+}  // unnamed namespace
+
+TEST_CASE("MappedAudioFile", "Test memory-mapped audio files")
+{
+
+const std::string name = "test_mappedaudiofile.tmp";
+
+SECTION("WAV", "")
+{
+  write_wav(name, 3);
+  apf::MappedAudioFile file(name);
+  CHECK(file.channels() == 2);
+  CHECK(file.sample_rate() == 44100);
+  CHECK(file.frames() == 3);
+  CHECK(file.data()[5] == 30.0f);
+  CHECK(file.block(1)[0] == 2.0f);
+  auto right = file.channel(1);
+  CHECK(right.end() - right.begin() == 3);
+  CHECK(*right.begin() == 10.0f);
+  CHECK(*(right.begin() + 2) == 30.0f);
+  file.will_need(0, 100);
+  file.dont_need(1, 1);
+  CHECK(file.data()[2] == 2.0f);
+}
+
+SECTION("RF64", "")
+{
+  write_wav(name, 3, true);
+  apf::MappedAudioFile file(name);
+  CHECK(file.channels() == 2);
+  CHECK(file.frames() == 3);
+  CHECK(file.data()[4] == 3.0f);
+}
+
+SECTION("WAV with integer samples", "")
+{
+  write_wav(name, 1);
+  CHECK_THROWS_AS(apf::MappedAudioFile{name}, std::logic_error);
+}
+
+SECTION("CAF", "")
+{
+  file_writer w;
+  w.id("caff"); w.be(1, 2); w.be(0, 2);
+  w.id("desc"); w.be(32, 8);
+  double sample_rate = 48000;
+  uint64_t sample_rate_bits;
+  std::memcpy(&sample_rate_bits, &sample_rate, 8);
+  w.be(sample_rate_bits, 8); w.id("lpcm"); w.be(3, 4);
+  w.be(8, 4); w.be(1, 4); w.be(2, 4); w.be(32, 4);
+  w.id("data"); w.be(4 + samples.size() * 4, 8); w.be(0, 4);
+  w.samples(samples);
+  w.save(name);
+
+  apf::MappedAudioFile file(name);
+  CHECK(file.channels() == 2);
+  CHECK(file.sample_rate() == 48000);
+  CHECK(file.frames() == 3);
+  CHECK(file.data()[1] == 10.0f);
+}
+
+SECTION("RAW", "")
+{
+  file_writer w;
+  w.le(0, 4);  // some header
+  w.samples(samples);
+  w.save(name);
+
+  apf::MappedAudioFile file(name, 3, 1000, 4);
+  CHECK(file.channels() == 3);
+  CHECK(file.frames() == 2);
+  CHECK(*(file.channel(2).begin() + 1) == 30.0f);
+}
+
+SECTION("errors", "")
+{
+  CHECK_THROWS_AS(apf::MappedAudioFile{"non-existing file"}, std::logic_error);
+  file_writer w;
+  w.id("blah");
+  w.samples(samples);
+  w.save(name);
+  CHECK_THROWS_AS(apf::MappedAudioFile{name}, std::logic_error);
+}
+
+std::remove(name.c_str());
+
+} // TEST_CASE
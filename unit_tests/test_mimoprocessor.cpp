@@ -3,6 +3,7 @@
 #include "catch/catch.hpp"
 
 #include "apf/pointer_policy.h"
+#include "apf/interleaved_policy.h"
 
 struct DummyProcessor :
   public apf::MimoProcessor<DummyProcessor, apf::pointer_policy<float*>>
@@ -14,6 +15,154 @@ struct DummyProcessor :
   void process() {}
 };
 
+// Output = 2 * sum of inputs
+struct DoublingProcessor :
+  public apf::MimoProcessor<DoublingProcessor, apf::pointer_policy<float*>>
+{
+  using Input = MimoProcessorBase::DefaultInput;
+
+  class Output : public MimoProcessorBase::DefaultOutput
+  {
+    public:
+      explicit Output(const Params& p) : MimoProcessorBase::DefaultOutput(p) {}
+
+      APF_PROCESS(Output, MimoProcessorBase::DefaultOutput)
+      {
+        std::fill(this->begin(), this->end(), 0.0f);
+        for (const auto& in: rtlist_proxy<Input>(
+              this->parent.get_input_list()))
+        {
+          std::transform(in.begin(), in.end(), this->begin(), this->begin()
+              , [] (float x, float y) { return 2.0f * x + y; });
+        }
+        ++this->parent.blocks;
+      }
+  };
+
+  DoublingProcessor(const apf::parameter_map& p)
+    : MimoProcessorBase(p)
+  {
+    this->add<Input>();
+    this->add<Output>();
+    this->activate();
+  }
+
+  ~DoublingProcessor() { this->deactivate(); }
+
+  int blocks = 0;
+};
+
+// Each output = 2 * sum of inputs, interleaved
+struct InterleavedProcessor : public apf::MimoProcessor<InterleavedProcessor
+                              , apf::interleaved_policy<float*>>
+{
+  using Input = MimoProcessorBase::DefaultInput;
+
+  class Output : public MimoProcessorBase::DefaultOutput
+  {
+    public:
+      explicit Output(const Params& p) : MimoProcessorBase::DefaultOutput(p) {}
+
+      APF_PROCESS(Output, MimoProcessorBase::DefaultOutput)
+      {
+        std::fill(this->begin(), this->end(), 0.0f);
+        for (const auto& in: rtlist_proxy<Input>(
+              this->parent.get_input_list()))
+        {
+          std::transform(in.begin(), in.end(), this->begin(), this->begin()
+              , [] (float x, float y) { return 2.0f * x + y; });
+        }
+      }
+  };
+
+  InterleavedProcessor(const apf::parameter_map& p)
+    : MimoProcessorBase(p)
+  {
+    this->add<Input>();
+    this->add<Input>();
+    this->add<Output>();
+    this->add<Output>();
+    this->activate();
+  }
+
+  ~InterleavedProcessor() { this->deactivate(); }
+};
+
+// Each output records the thread it was processed in
+struct ThreadRecordingProcessor : public apf::MimoProcessor<
+                                  ThreadRecordingProcessor
+                                  , apf::pointer_policy<float*>>
+{
+  class Output : public MimoProcessorBase::DefaultOutput
+  {
+    public:
+      explicit Output(const Params& p) : MimoProcessorBase::DefaultOutput(p) {}
+
+      APF_PROCESS(Output, MimoProcessorBase::DefaultOutput)
+      {
+        this->thread_id = std::this_thread::get_id();
+      }
+
+      std::thread::id thread_id;
+  };
+
+  ThreadRecordingProcessor(const apf::parameter_map& p)
+    : MimoProcessorBase(p)
+  {}
+};
+
+// Two successive split steps, the second one uses the results of the first
+struct SplitProcessor : public apf::MimoProcessor<SplitProcessor
+                        , apf::pointer_policy<float*>>
+{
+  struct Step : SplitItem
+  {
+    explicit Step(SplitProcessor& parent) : _parent(parent) {}
+
+    virtual void process(unsigned part, unsigned parts)
+    {
+      if (this == &_parent._first)
+      {
+        _parent.values[part] = static_cast<int>(part) + 1;
+        _parent.thread_ids[part] = std::this_thread::get_id();
+      }
+      else
+      {
+        int sum = 0;
+        for (unsigned i = 0; i < parts; ++i) sum += _parent.values[i];
+        _parent.sums[part] = sum;
+      }
+    }
+
+    SplitProcessor& _parent;
+  };
+
+  APF_PROCESS(SplitProcessor, MimoProcessorBase)
+  {
+    _process_split(_first);
+    _process_split(_second);
+  }
+
+  SplitProcessor(const apf::parameter_map& p)
+    : MimoProcessorBase(p)
+    , values(this->threads())
+    , sums(this->threads())
+    , thread_ids(this->threads())
+    , _first(*this)
+    , _second(*this)
+  {
+    this->activate();
+  }
+
+  ~SplitProcessor() { this->deactivate(); }
+
+  std::vector<int> values, sums;
+  std::vector<std::thread::id> thread_ids;
+
+  private:
+    Step _first, _second;
+};
+
 TEST_CASE("MimoProcessor", "Test MimoProcessor")
 {
 
@@ -26,6 +175,166 @@ SECTION("compilation", "does it compile?")
   DummyProcessor dummy(p);
 }
 
+SECTION("pointer_policy with large blocks", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  DoublingProcessor processor(p);
+
+  float in_data[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  float out_data[10] = { 0 };
+  float* in[] = { in_data };
+  float* out[] = { out_data };
+
+  processor.audio_callback(4, in, out);
+  CHECK(processor.blocks == 1);
+  CHECK(out_data[3] == 8.0f);
+  CHECK(out_data[4] == 0.0f);
+
+  processor.audio_callback(8, in, out);
+  CHECK(processor.blocks == 3);
+  CHECK(out_data[7] == 16.0f);
+  CHECK(out_data[8] == 0.0f);
+
+  // the last 2 samples are processed as a zero-padded block
+  processor.audio_callback(8, in, out);
+  float* in_rest[] = { in_data + 8 };
+  float* out_rest[] = { out_data + 8 };
+  processor.flush(2, in_rest, out_rest);
+  CHECK(processor.blocks == 6);
+  for (int i = 0; i < 10; ++i)
+  {
+    INFO("i = " << i);
+    CHECK(out_data[i] == 2.0f * in_data[i]);
+  }
+}
+
+SECTION("interleaved_policy", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 2);
+  InterleavedProcessor processor(p);
+
+  float in[] = { 1, 10, 2, 20, 3, 30, 4, 40, 5, 50 };
+  float out[10] = { 0 };
+  float expected[] = { 22, 22, 44, 44, 66, 66, 88, 88, 110, 110 };
+
+  processor.audio_callback(2, in, out);
+  CHECK(out[3] == 44.0f);
+  CHECK(out[4] == 0.0f);
+
+  // 2 blocks + zero-padded remainder
+  processor.audio_callback(4, in, out);
+  processor.flush(1, in + 8, out + 8);
+  for (int i = 0; i < 10; ++i)
+  {
+    INFO("i = " << i);
+    CHECK(out[i] == expected[i]);
+  }
+}
+
+SECTION("balance_threads", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 2);
+  ThreadRecordingProcessor processor(p);
+
+  // round-robin: thread 0 gets 4+1+1, thread 1 gets 1+1
+  std::vector<ThreadRecordingProcessor::Output*> outputs;
+  for (auto cost: { 4.0f, 1.0f, 1.0f, 1.0f, 1.0f })
+  {
+    ThreadRecordingProcessor::Output::Params op;
+    op.set("cost", cost);
+    outputs.push_back(processor.add(op));
+  }
+  CHECK(outputs[0]->cost == 4.0f);
+  processor.activate();
+
+  float data[4] = { 0 };
+  float* out[] = { data, data, data, data, data };
+  processor.audio_callback(4, nullptr, out);
+  CHECK(outputs[0]->thread_id == outputs[2]->thread_id);
+  CHECK(outputs[0]->thread_id != outputs[1]->thread_id);
+
+  bool first = false, second = true;
+  std::atomic<bool> done{false};
+  std::thread balancer([&]()
+      {
+        // 4 | 1+1+1+1
+        first = processor.balance_threads();
+        // no further improvement
+        second = processor.balance_threads();
+        done = true;
+      });
+  // This simulates the audio thread, balance_threads() has to wait for it
+  while (!done)
+  {
+    processor.audio_callback(4, nullptr, out);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  balancer.join();
+  CHECK(first);
+  CHECK_FALSE(second);
+  processor.audio_callback(4, nullptr, out);
+
+  for (int i = 2; i < 5; ++i)
+  {
+    INFO("i = " << i);
+    CHECK(outputs[i]->thread_id == outputs[1]->thread_id);
+  }
+  CHECK(outputs[0]->thread_id != outputs[1]->thread_id);
+
+  processor.deactivate();
+}
+
+SECTION("thread parameters", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 3);
+  {
+    ThreadRecordingProcessor processor(p);
+    CHECK(processor.thread_cpu(0) == -1);
+    CHECK(processor.thread_node(1) == -1);
+
+    ThreadRecordingProcessor::Output::Params op;
+    op.set("thread", 2);
+    CHECK(processor.add(op)->thread == 2);
+    op.set("thread", 3);
+    CHECK_THROWS_AS(processor.add(op), std::logic_error);
+  }
+
+  p.set("cpus", "0,0");
+  ThreadRecordingProcessor processor(p);
+  CHECK(processor.thread_cpu(0) == 0);
+  CHECK(processor.thread_cpu(2) == 0);
+
+  p.set("cpus", "0-");
+  CHECK_THROWS_AS(ThreadRecordingProcessor(p), std::logic_error);
+}
+
+SECTION("split items", "")
+{
+  apf::parameter_map p;
+  p.set("sample_rate", 1000);
+  p.set("block_size", 4);
+  p.set("threads", 3);
+  SplitProcessor processor(p);
+
+  processor.audio_callback(4, nullptr, nullptr);
+
+  CHECK(processor.values == std::vector<int>({1, 2, 3}));
+  CHECK(processor.sums == std::vector<int>({6, 6, 6}));
+  CHECK(processor.thread_ids[0] == std::this_thread::get_id());
+  CHECK(processor.thread_ids[0] != processor.thread_ids[1]);
+  CHECK(processor.thread_ids[1] != processor.thread_ids[2]);
+}
+
 // TODO: more tests!
 
 } // TEST_CASE MimoProcessor
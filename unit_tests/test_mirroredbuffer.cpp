@@ -0,0 +1,56 @@
+// Tests for MirroredBuffer.
+
+#include "apf/mirroredbuffer.h"
+
+#include "catch/catch.hpp"
+
+TEST_CASE("MirroredBuffer", "Test double-mapped memory")
+{
+
+SECTION("mirrored", "")
+{
+  auto size = apf::MirroredBuffer<float>::granularity();
+  apf::MirroredBuffer<float> buffer(size);
+  CHECK(buffer.size() == size);
+  CHECK(buffer.end() - buffer.begin() == static_cast<std::ptrdiff_t>(size));
+  CHECK(buffer[0] == 0.0f);
+  CHECK(buffer[size - 1] == 0.0f);
+
+#if defined(__linux__) && !defined(APF_NO_MIRRORED_BUFFER)
+  REQUIRE(buffer.mirrored());
+#endif
+
+  if (buffer.mirrored())
+  {
+    buffer[1] = 42.0f;
+    CHECK(buffer.end()[1] == 42.0f);
+    buffer.end()[size - 1] = 23.0f;
+    CHECK(buffer[size - 1] == 23.0f);
+  }
+}
+
+SECTION("two pages", "")
+{
+  auto size = 2 * apf::MirroredBuffer<double>::granularity();
+  apf::MirroredBuffer<double> buffer(size);
+  buffer[size - 1] = 1.0;
+  if (buffer.mirrored())
+  {
+    CHECK(buffer.begin()[2 * size - 1] == 1.0);
+  }
+}
+
+SECTION("fallback", "")
+{
+  apf::MirroredBuffer<int> buffer(3);
+  if (apf::MirroredBuffer<int>::granularity() > 3)
+  {
+    CHECK_FALSE(buffer.mirrored());
+  }
+  CHECK(buffer.size() == 3);
+  buffer[2] = 5;
+  CHECK(buffer.data()[2] == 5);
+  CHECK(buffer[0] == 0);
+}
+
+} // TEST_CASE
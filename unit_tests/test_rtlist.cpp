@@ -0,0 +1,109 @@
+#include "apf/rtlist.h"
+
+#include <vector>
+
+#include "catch/catch.hpp"
+
+struct Counted
+{
+  explicit Counted(int v) : value(v) { ++instances; }
+  ~Counted() { --instances; }
+  int value;
+  static int instances;
+};
+
+int Counted::instances = 0;
+
+using list_t = apf::RtList<Counted*>;
+
+static std::vector<int> values(const list_t& l)
+{
+  std::vector<int> result;
+  for (const auto* i: l) result.push_back(i->value);
+  return result;
+}
+
+TEST_CASE("RtList", "Test RtList")
+{
+
+using v = std::vector<int>;
+
+SECTION("add and rem", "")
+{
+  {
+    apf::CommandQueue fifo(16);
+    list_t l(fifo);
+
+    std::vector<Counted*> items;
+    for (int i = 0; i < 6; ++i) items.push_back(new Counted(i));
+    l.add(items[0]);
+    l.add(items.begin() + 1, items.end());
+    CHECK(l.empty());  // not yet synchronized
+    fifo.process_commands();
+    CHECK(values(l) == (v{0, 1, 2, 3, 4, 5}));
+
+    l.rem(items[3]);
+    l.rem(items.begin(), items.begin() + 2);
+    fifo.process_commands();
+    CHECK(values(l) == (v{2, 4, 5}));
+    fifo.cleanup_commands();
+    CHECK(Counted::instances == 3);
+
+    CHECK_THROWS_AS(l.rem(items[3]), std::logic_error);
+    CHECK_THROWS_AS(l.add(items[2]), std::logic_error);
+    // Nothing is removed if one of the items is unknown
+    CHECK_THROWS_AS(l.rem(items.begin() + 1, items.begin() + 3)
+        , std::logic_error);
+    // ... or if an item is given twice
+    Counted* twice[] = { items[4], items[4] };
+    CHECK_THROWS_AS(l.rem(twice, twice + 2), std::logic_error);
+    auto extra = new Counted(8);
+    Counted* extra_twice[] = { extra, extra };
+    CHECK_THROWS_AS(l.add(extra_twice, extra_twice + 2), std::logic_error);
+    delete extra;
+
+    l.rem(items[5]);
+    l.add(new Counted(6));
+    fifo.process_commands();
+    CHECK(values(l) == (v{2, 4, 6}));
+
+    // items[4] is still registered
+    l.rem(items[4]);
+    fifo.process_commands();
+    CHECK(values(l) == (v{2, 6}));
+
+    l.clear();
+    fifo.process_commands();
+    fifo.cleanup_commands();
+    CHECK(l.empty());
+    CHECK(Counted::instances == 0);
+
+    // The same address can be added again after clear()
+    l.add(new Counted(7));
+    fifo.process_commands();
+    CHECK(values(l) == v{7});
+  }
+  CHECK(Counted::instances == 0);
+}
+
+SECTION("rem after splice", "")
+{
+  apf::CommandQueue fifo(16);
+  list_t l1(fifo), l2(fifo);
+  auto a = l1.add(new Counted(1));
+  l2.add(new Counted(2));
+  fifo.process_commands();
+
+  // Temporarily join lists, like MimoProcessor::_process_list()
+  auto temp = l2.begin();
+  l2.splice(temp, l1);
+  CHECK(values(l2) == (v{1, 2}));
+  l1.splice(l1.end(), l2, l2.begin(), temp);
+
+  l1.rem(a);
+  fifo.process_commands();
+  CHECK(l1.empty());
+  CHECK(values(l2) == v{2});
+}
+
+} // TEST_CASE RtList
@@ -0,0 +1,119 @@
+// Tests for SmoothedParameter.
+
+#include "apf/shareddata.h"
+
+#include "catch/catch.hpp"
+
+TEST_CASE("SmoothedParameter", "")
+{
+
+SECTION("initial value", "")
+{
+  apf::SmoothedParameter<float> p(4, 0.5f);
+  CHECK(p.get() == 0.5f);
+  CHECK(p.old() == 0.5f);
+  p.update();
+  CHECK(p.get() == 0.5f);
+  CHECK_FALSE(p.changed());
+}
+
+SECTION("linear, one block", "")
+{
+  apf::SmoothedParameter<float> p(4);
+  p = 1.0f;
+  CHECK(p.target() == 1.0f);
+  CHECK(p.get() == 0.0f);
+  p.update();
+  CHECK(p.old() == 0.0f);
+  CHECK(p.get() == 1.0f);
+  CHECK(p.changed());
+
+  auto interpolator = p.interpolator();
+  CHECK(interpolator(0.0f) == 0.0f);
+  CHECK(interpolator(2.0f) == 0.5f);
+
+  float ramp[4];
+  CHECK(p.ramp(ramp) == ramp + 4);
+  CHECK(ramp[0] == 0.0f);
+  CHECK(ramp[1] == 0.25f);
+  CHECK(ramp[3] == 0.75f);
+
+  p.update();
+  CHECK_FALSE(p.changed());
+  CHECK(p.get() == 1.0f);
+}
+
+SECTION("linear, several blocks, last writer wins", "")
+{
+  apf::SmoothedParameter<float> p(4, 0.0f
+      , apf::SmoothedParameter<float>::linear, 4.0f);
+  p = 8.0f;
+  p = 4.0f;
+  p.update();
+  CHECK(p.get() == 1.0f);
+  p.update();
+  CHECK(p.old() == 1.0f);
+  CHECK(p.get() == 2.0f);
+  p.update();
+  p.update();
+  CHECK(p.get() == 4.0f);
+  p.update();
+  CHECK(p.get() == 4.0f);
+  CHECK_FALSE(p.changed());
+}
+
+SECTION("exponential", "")
+{
+  apf::SmoothedParameter<double> p(4, 0.0
+      , apf::SmoothedParameter<double>::exponential, 1.0);
+  p = 1.0;
+  p.update();
+  CHECK(p.get() == Approx(1.0 - std::exp(-1.0)));
+  p.update();
+  CHECK(p.get() == Approx(1.0 - std::exp(-2.0)));
+  CHECK(p.changed());
+  for (int i = 0; i < 20; ++i) p.update();
+  CHECK(p.get() == 1.0);
+  CHECK_FALSE(p.changed());
+}
+
+SECTION("exponential, large values", "")
+{
+  // The distance never gets below 1e-5, the spacing of floats around 1000 is
+  // larger than that
+  apf::SmoothedParameter<float> p(4, 0.0f
+      , apf::SmoothedParameter<float>::exponential, 2.0f);
+  p = 1000.0f;
+  for (int i = 0; i < 23; ++i) p.update();
+  CHECK(p.get() != 1000.0f);
+  p.update();
+  CHECK(p.get() == 1000.0f);
+  CHECK(p.changed());
+  p.update();
+  CHECK_FALSE(p.changed());
+}
+
+SECTION("exponential, small values", "")
+{
+  // -100 dB: the whole distance is only 1e-5, this is smoothed as well
+  apf::SmoothedParameter<float> p(4, 0.0f
+      , apf::SmoothedParameter<float>::exponential, 2.0f);
+  p = 1e-5f;
+  p.update();
+  CHECK(p.get() == Approx(1e-5f * (1.0f - std::exp(-0.5f))).scale(0));
+  CHECK(p.changed());
+  for (int i = 0; i < 23; ++i) p.update();
+  CHECK(p.get() == 1e-5f);
+
+  // Towards zero, the relative distance stays the same
+  p = 0.0f;
+  p.update();
+  CHECK(p.get() == Approx(1e-5f * std::exp(-0.5f)).scale(0));
+  for (int i = 0; i < 23; ++i) p.update();
+  CHECK(p.get() == 0.0f);
+  CHECK(p.changed());
+  p.update();
+  CHECK_FALSE(p.changed());
+}
+
+} // TEST_CASE
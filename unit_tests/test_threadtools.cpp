@@ -0,0 +1,88 @@
+#include "apf/threadtools.h"
+
+#include <cstdint>  // for uintptr_t
+#include <vector>
+
+#include "catch/catch.hpp"
+
+#include "apf/numa.h"
+
+TEST_CASE("threadtools", "Test threadtools and numa")
+{
+
+SECTION("parse_cpu_list", "")
+{
+  using v = std::vector<unsigned>;
+  CHECK(apf::parse_cpu_list("") == v());
+  CHECK(apf::parse_cpu_list("3") == v{3});
+  CHECK(apf::parse_cpu_list("0-3,8,10-11") == (v{0, 1, 2, 3, 8, 10, 11}));
+  CHECK(apf::parse_cpu_list("5,1") == (v{5, 1}));
+  CHECK_THROWS_AS(apf::parse_cpu_list("x"), std::logic_error);
+  CHECK_THROWS_AS(apf::parse_cpu_list("1,"), std::logic_error);
+  CHECK_THROWS_AS(apf::parse_cpu_list("3-1"), std::logic_error);
+  CHECK_THROWS_AS(apf::parse_cpu_list("0-4000000000"), std::logic_error);
+  CHECK_THROWS_AS(apf::parse_cpu_list("99999999999999999999")
+      , std::logic_error);
+  CHECK_THROWS_AS(apf::parse_cpu_list("1 2"), std::logic_error);
+}
+
+SECTION("set_thread_affinity", "")
+{
+  unsigned cpu = 0;
+#ifdef __linux__
+  cpu = static_cast<unsigned>(sched_getcpu());
+#endif
+  bool result = false;
+  std::thread t([&result, cpu]()
+      {
+        result = apf::set_thread_affinity(pthread_self(), cpu);
+      });
+  t.join();
+#ifdef __linux__
+  CHECK(result);
+#else
+  CHECK_FALSE(result);
+#endif
+}
+
+SECTION("set_thread_priority", "")
+{
+  bool result = false;
+  int policy = -1;
+  std::thread t([&result, &policy]()
+      {
+        result = apf::set_thread_priority(pthread_self(), 0);
+#ifdef __linux__
+        struct sched_param param;
+        pthread_getschedparam(pthread_self(), &policy, &param);
+#endif
+      });
+  t.join();
+#ifdef __linux__
+  CHECK(result);
+  CHECK(policy == SCHED_OTHER);
+#else
+  CHECK_FALSE(result);
+#endif
+}
+
+SECTION("numa_allocator", "")
+{
+  std::vector<float, apf::numa_allocator<float>> a(1000, 1.0f);
+  CHECK(a.get_allocator().node == -1);
+  CHECK(a[999] == 1.0f);
+
+  std::vector<float, apf::numa_allocator<float>> b(1000, 2.0f
+      , apf::numa_allocator<float>(0));
+  CHECK(b.get_allocator().node == 0);
+  CHECK(b[999] == 2.0f);
+  CHECK(a.get_allocator() != b.get_allocator());
+  CHECK(a.get_allocator() == apf::numa_allocator<double>());
+
+  // The memory is always page-aligned
+  auto page_size = uintptr_t(sysconf(_SC_PAGESIZE));
+  CHECK(reinterpret_cast<uintptr_t>(a.data()) % page_size == 0);
+  CHECK(reinterpret_cast<uintptr_t>(b.data()) % page_size == 0);
+}
+
+} // TEST_CASE threadtools